@@ -0,0 +1,381 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    hd44780_sim.c
+
+  @Summary
+    Batched HD44780 simulator
+
+  @Description
+    Implements the structure of arrays controller model. A strobe is handled
+    in two passes over the range: the first assembles bytes from nibbles and
+    counts busy strobes without branching, the second executes the bytes
+    that completed, which in 4 bit mode is every other strobe.
+******************************************************************************/
+
+#include "hd44780_sim.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HD44780_SIM_PTHREADS
+#include <pthread.h>
+#endif
+
+#define SIM_LINE_LENGTH 40
+#define SIM_EXEC_US 37 // most instructions and data writes
+#define SIM_HOME_US 1520 // clear and return home
+#define SIM_CHUNK 256 // panels per pass, keeps the scratch arrays on the stack
+#define SIM_MAX_THREADS 64
+
+#ifdef HD44780_SIM_PTHREADS
+typedef struct {
+    hd44780_sim_t * sim;
+    uint32_t first;
+    uint32_t count;
+    const uint8_t * rs;
+    const uint8_t * nibble;
+    uint32_t stride;
+    uint32_t steps;
+    uint64_t start_us;
+    uint32_t step_us;
+} sim_job_t;
+
+static void * sim_job_run(void * arg);
+#endif
+
+static void sim_run(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+		    uint32_t stride, uint32_t steps, uint64_t start_us, uint32_t step_us);
+static void sim_execute(hd44780_sim_t * sim, uint32_t p, uint8_t rs, uint8_t value, uint64_t now_us);
+static uint8_t sim_ddram_step(uint8_t address, uint8_t forward);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Allocate a batch of controllers in their power on state
+
+    @param[out] sim Batch to set up
+
+    @param[in] count Number of panels
+
+    @return 0 if out of memory
+*/
+uint8_t hd44780_sim_init(hd44780_sim_t * sim, uint32_t count) {
+    memset(sim, 0, sizeof(*sim));
+    sim->count = count;
+    sim->ddram = malloc((size_t)count * HD44780_SIM_DDRAM);
+    sim->cgram = calloc((size_t)count, HD44780_SIM_CGRAM);
+    sim->ac = calloc(count, 1);
+    sim->in_cgram = calloc(count, 1);
+    sim->four_bit = calloc(count, 1);
+    sim->phase = calloc(count, 1);
+    sim->high = calloc(count, 1);
+    sim->entry = malloc(count);
+    sim->control = calloc(count, 1);
+    sim->shift = calloc(count, 1);
+    sim->busy_until = calloc(count, sizeof(*sim->busy_until));
+    sim->strobes = calloc(count, sizeof(*sim->strobes));
+    sim->busy_strobes = calloc(count, sizeof(*sim->busy_strobes));
+
+    if(sim->ddram == NULL || sim->cgram == NULL || sim->ac == NULL || sim->in_cgram == NULL || sim->four_bit == NULL
+       || sim->phase == NULL || sim->high == NULL || sim->entry == NULL || sim->control == NULL || sim->shift == NULL
+       || sim->busy_until == NULL || sim->strobes == NULL || sim->busy_strobes == NULL) {
+	hd44780_sim_free(sim);
+	return 0;
+    }
+
+    // power on reset: display cleared, 8 bit interface, display off, increment
+    memset(sim->ddram, ' ', (size_t)count * HD44780_SIM_DDRAM);
+    memset(sim->entry, 0x02, count);
+    return 1;
+}
+
+/*
+    @brief Free a batch
+*/
+void hd44780_sim_free(hd44780_sim_t * sim) {
+    free(sim->ddram);
+    free(sim->cgram);
+    free(sim->ac);
+    free(sim->in_cgram);
+    free(sim->four_bit);
+    free(sim->phase);
+    free(sim->high);
+    free(sim->entry);
+    free(sim->control);
+    free(sim->shift);
+    free(sim->busy_until);
+    free(sim->strobes);
+    free(sim->busy_strobes);
+    memset(sim, 0, sizeof(*sim));
+}
+
+/*
+    @brief Strobe a nibble into a range of panels
+
+    @note what every panel sees when enable falls with D4-D7 and RS set as given, in 8 bit mode the nibble is the
+	  upper half of an instruction with the lower half low, like the wake up sequence
+
+    @param[in,out] sim Batch
+
+    @param[in] first First panel
+
+    @param[in] count Number of panels
+
+    @param[in] rs Register select of every panel, count entries
+
+    @param[in] nibble D7-D4 of every panel in the low 4 bits, count entries
+
+    @param[in] now_us Time of the strobe
+*/
+void hd44780_sim_strobe(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+			uint64_t now_us) {
+    uint8_t value[SIM_CHUNK];
+    uint8_t done[SIM_CHUNK];
+    uint32_t base;
+    uint32_t n;
+    uint32_t i;
+
+    for(base = 0; base < count; base += n) {
+	uint8_t * const four_bit = sim->four_bit + first + base;
+	uint8_t * const phase = sim->phase + first + base;
+	uint8_t * const high = sim->high + first + base;
+	uint64_t * const busy_until = sim->busy_until + first + base;
+	uint32_t * const strobes = sim->strobes + first + base;
+	uint32_t * const busy_strobes = sim->busy_strobes + first + base;
+	const uint8_t * const nib = nibble + base;
+
+	n = (count - base < SIM_CHUNK) ? count - base : SIM_CHUNK;
+
+	// pass 1, no branches: latch high nibbles, assemble the bytes that complete
+	for(i = 0; i < n; i++) {
+	    const uint8_t latch = four_bit[i] & (uint8_t)(phase[i] ^ 1); // 4 bit mode waiting for the high nibble
+	    const uint8_t low = nib[i] & 0x0F;
+
+	    strobes[i]++;
+	    busy_strobes[i] += (now_us < busy_until[i]);
+	    done[i] = latch ^ 1;
+	    value[i] = four_bit[i] ? (uint8_t)((high[i] << 4) | low) : (uint8_t)(low << 4);
+	    high[i] = latch ? low : high[i];
+	    phase[i] = latch;
+	}
+
+	// pass 2: execute the completed bytes
+	for(i = 0; i < n; i++)
+	    if(done[i])
+		sim_execute(sim, first + base + i, rs[base + i], value[i], now_us);
+    }
+}
+
+/*
+    @brief Replay a sequence of strobes into a range of panels, optionally on several threads
+
+    @note step s strobes rs + s * stride and nibble + s * stride at start_us + s * step_us, each thread takes an even
+	  share of the panels for the whole sequence so the threads never meet, without HD44780_SIM_PTHREADS it runs
+	  on the calling thread
+
+    @param[in,out] sim Batch
+
+    @param[in] first First panel
+
+    @param[in] count Number of panels
+
+    @param[in] rs Register select of every panel for every step
+
+    @param[in] nibble D7-D4 of every panel for every step
+
+    @param[in] stride Entries from one step to the next in rs and nibble, at least count
+
+    @param[in] steps Number of strobes
+
+    @param[in] start_us Time of the first strobe
+
+    @param[in] step_us Time between strobes
+
+    @param[in] threads Number of threads, 0 or 1 for the calling thread only
+*/
+void hd44780_sim_run(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+		     uint32_t stride, uint32_t steps, uint64_t start_us, uint32_t step_us, uint32_t threads) {
+#ifdef HD44780_SIM_PTHREADS
+    pthread_t tid[SIM_MAX_THREADS];
+    uint8_t started[SIM_MAX_THREADS];
+    sim_job_t job[SIM_MAX_THREADS];
+    uint32_t per;
+    uint32_t t;
+
+    if(threads > SIM_MAX_THREADS)
+	threads = SIM_MAX_THREADS;
+    if(threads > 1 && count >= threads * SIM_CHUNK) {
+	// split on chunk boundaries so no two threads share a cache line of state
+	per = ((count + threads - 1) / threads + SIM_CHUNK - 1) / SIM_CHUNK * SIM_CHUNK;
+	for(t = 0; t < threads; t++) {
+	    const uint32_t start = (t * per < count) ? t * per : count;
+
+	    job[t].sim = sim;
+	    job[t].first = first + start;
+	    job[t].count = (count - start < per) ? count - start : per;
+	    job[t].rs = rs + start;
+	    job[t].nibble = nibble + start;
+	    job[t].stride = stride;
+	    job[t].steps = steps;
+	    job[t].start_us = start_us;
+	    job[t].step_us = step_us;
+	}
+
+	// the calling thread takes the first share, and any share a thread could not be started for
+	for(t = 1; t < threads; t++)
+	    started[t] = (pthread_create(&tid[t], NULL, sim_job_run, &job[t]) == 0);
+	sim_job_run(&job[0]);
+	for(t = 1; t < threads; t++) {
+	    if(started[t])
+		pthread_join(tid[t], NULL);
+	    else
+		sim_job_run(&job[t]);
+	}
+	return;
+    }
+#else
+    (void)threads;
+#endif
+    sim_run(sim, first, count, rs, nibble, stride, steps, start_us, step_us);
+}
+
+/*
+    @brief Write a whole byte to one panel over an 8 bit interface
+
+    @param[in,out] sim Batch
+
+    @param[in] panel Panel
+
+    @param[in] rs Register select
+
+    @param[in] value Byte on D0-D7
+
+    @param[in] now_us Time of the strobe
+*/
+void hd44780_sim_byte(hd44780_sim_t * sim, uint32_t panel, uint8_t rs, uint8_t value, uint64_t now_us) {
+    sim->strobes[panel]++;
+    sim->busy_strobes[panel] += (now_us < sim->busy_until[panel]);
+    sim->phase[panel] = 0;
+    sim_execute(sim, panel, rs, value, now_us);
+}
+
+/*
+    @brief Read the visible characters of a line
+
+    @param[in] sim Batch
+
+    @param[in] panel Panel
+
+    @param[in] row Line, 0 or 1
+
+    @param[in] cols Visible columns
+
+    @param[out] text cols ROM codes and a terminating 0
+*/
+void hd44780_sim_line(const hd44780_sim_t * sim, uint32_t panel, uint8_t row, uint8_t cols, char * text) {
+    const uint8_t * const ddram = sim->ddram + (size_t)panel * HD44780_SIM_DDRAM + (row ? 0x40 : 0);
+    uint8_t col;
+
+    for(col = 0; col < cols; col++)
+	text[col] = (char)ddram[(col + sim->shift[panel]) % SIM_LINE_LENGTH];
+    text[cols] = 0;
+}
+
+/*
+    @brief Function for executing a byte on one controller
+*/
+static void sim_execute(hd44780_sim_t * sim, uint32_t p, uint8_t rs, uint8_t value, uint64_t now_us) {
+    uint32_t exec_us = SIM_EXEC_US;
+
+    if(rs) {
+	const uint8_t forward = (sim->entry[p] & 0x02) != 0;
+
+	if(sim->in_cgram[p]) {
+	    sim->cgram[(size_t)p * HD44780_SIM_CGRAM + sim->ac[p]] = value & 0x1F;
+	    sim->ac[p] = (sim->ac[p] + (forward ? 1 : 0x3F)) & 0x3F;
+	}
+	else {
+	    sim->ddram[(size_t)p * HD44780_SIM_DDRAM + sim->ac[p]] = value;
+	    sim->ac[p] = sim_ddram_step(sim->ac[p], forward);
+	    if(sim->entry[p] & 0x01)
+		sim->shift[p] = (sim->shift[p] + (forward ? 1 : SIM_LINE_LENGTH - 1)) % SIM_LINE_LENGTH;
+	}
+    }
+    else if(value & 0x80) {
+	sim->ac[p] = value & 0x7F;
+	sim->in_cgram[p] = 0;
+    }
+    else if(value & 0x40) {
+	sim->ac[p] = value & 0x3F;
+	sim->in_cgram[p] = 1;
+    }
+    else if(value & 0x20) {
+	sim->four_bit[p] = !(value & 0x10);
+	sim->phase[p] = 0;
+    }
+    else if(value & 0x10) {
+	const uint8_t right = (value & 0x04) != 0;
+
+	if(value & 0x08)
+	    sim->shift[p] = (sim->shift[p] + (right ? SIM_LINE_LENGTH - 1 : 1)) % SIM_LINE_LENGTH;
+	else if(sim->in_cgram[p])
+	    sim->ac[p] = (sim->ac[p] + (right ? 1 : 0x3F)) & 0x3F;
+	else
+	    sim->ac[p] = sim_ddram_step(sim->ac[p], right);
+    }
+    else if(value & 0x08) {
+	sim->control[p] = value & 0x07;
+    }
+    else if(value & 0x04) {
+	sim->entry[p] = value & 0x03;
+    }
+    else if(value) {
+	// clear also sets the entry mode to increment, return home leaves the text
+	if(value == 0x01) {
+	    memset(sim->ddram + (size_t)p * HD44780_SIM_DDRAM, ' ', HD44780_SIM_DDRAM);
+	    sim->entry[p] |= 0x02;
+	}
+	sim->ac[p] = 0;
+	sim->in_cgram[p] = 0;
+	sim->shift[p] = 0;
+	exec_us = SIM_HOME_US;
+    }
+
+    sim->busy_until[p] = now_us + exec_us;
+}
+
+/*
+    @brief Function for moving a DDRAM address one cell, wrapping between the two lines of 40
+*/
+static uint8_t sim_ddram_step(uint8_t address, uint8_t forward) {
+    if(forward)
+	return (address == 0x27) ? 0x40 : ((address == 0x67) ? 0x00 : address + 1);
+    return (address == 0x00) ? 0x67 : ((address == 0x40) ? 0x27 : address - 1);
+}
+
+/*
+    @brief Function for replaying a sequence of strobes on the calling thread
+*/
+static void sim_run(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+		    uint32_t stride, uint32_t steps, uint64_t start_us, uint32_t step_us) {
+    uint32_t s;
+
+    for(s = 0; s < steps; s++)
+	hd44780_sim_strobe(sim, first, count, rs + (size_t)s * stride, nibble + (size_t)s * stride,
+			   start_us + (uint64_t)s * step_us);
+}
+
+#ifdef HD44780_SIM_PTHREADS
+/*
+    @brief Function for running one thread's share of a sequence
+*/
+static void * sim_job_run(void * arg) {
+    const sim_job_t * job = arg;
+
+    if(job->count != 0)
+	sim_run(job->sim, job->first, job->count, job->rs, job->nibble, job->stride, job->steps, job->start_us,
+		job->step_us);
+    return NULL;
+}
+#endif
@@ -0,0 +1,148 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    hd44780_sim.h
+
+  @Summary
+    Batched HD44780 simulator
+
+  @Description
+    Simulates many HD44780 controllers at once for load testing on the host.
+    The state of every controller is kept as a structure of arrays, one array
+    per register, so a strobe on a range of panels is a few passes over
+    contiguous memory the compiler can vectorise. Only the writes a display
+    sees are modelled: DDRAM, CGRAM, address counter, entry mode, display
+    control and shift, the 4 bit nibble phase and the busy time of every
+    instruction. Strobes that arrive while a controller is busy are counted.
+
+    Build with -DHD44780_SIM_PTHREADS and link with -lpthread to split large
+    batches across threads.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef HD44780_SIM_H
+#define HD44780_SIM_H
+
+#define HD44780_SIM_DDRAM 128 // address space of DDRAM, 2 lines of 40 cells are used
+#define HD44780_SIM_CGRAM 64
+
+/*
+    @brief State of a batch of controllers, one array entry per panel
+*/
+typedef struct {
+    uint32_t count; // panels
+    uint8_t * ddram; // HD44780_SIM_DDRAM bytes per panel
+    uint8_t * cgram; // HD44780_SIM_CGRAM bytes per panel
+    uint8_t * ac; // address counter
+    uint8_t * in_cgram; // the address counter points into CGRAM
+    uint8_t * four_bit; // 4 bit interface
+    uint8_t * phase; // 1 once the high nibble of a byte has been latched
+    uint8_t * high; // latched high nibble
+    uint8_t * entry; // entry mode bits, I/D and S
+    uint8_t * control; // display control bits, D, C and B
+    uint8_t * shift; // display shift, 0 to 39 columns left
+    uint64_t * busy_until; // time the last instruction finishes, in microseconds
+    uint32_t * strobes; // enable strobes seen
+    uint32_t * busy_strobes; // strobes that arrived while busy
+} hd44780_sim_t;
+
+/*
+    @brief Allocate a batch of controllers in their power on state
+
+    @param[out] sim Batch to set up
+
+    @param[in] count Number of panels
+
+    @return 0 if out of memory
+*/
+uint8_t hd44780_sim_init(hd44780_sim_t * sim, uint32_t count);
+
+/*
+    @brief Free a batch
+*/
+void hd44780_sim_free(hd44780_sim_t * sim);
+
+/*
+    @brief Strobe a nibble into a range of panels
+
+    @note what every panel sees when enable falls with D4-D7 and RS set as given, in 8 bit mode the nibble is the
+	  upper half of an instruction with the lower half low, like the wake up sequence
+
+    @param[in,out] sim Batch
+
+    @param[in] first First panel
+
+    @param[in] count Number of panels
+
+    @param[in] rs Register select of every panel, count entries
+
+    @param[in] nibble D7-D4 of every panel in the low 4 bits, count entries
+
+    @param[in] now_us Time of the strobe
+*/
+void hd44780_sim_strobe(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+			uint64_t now_us);
+
+/*
+    @brief Replay a sequence of strobes into a range of panels, optionally on several threads
+
+    @note step s strobes rs + s * stride and nibble + s * stride at start_us + s * step_us, each thread takes an even
+	  share of the panels for the whole sequence so the threads never meet, without HD44780_SIM_PTHREADS it runs
+	  on the calling thread
+
+    @param[in,out] sim Batch
+
+    @param[in] first First panel
+
+    @param[in] count Number of panels
+
+    @param[in] rs Register select of every panel for every step
+
+    @param[in] nibble D7-D4 of every panel for every step
+
+    @param[in] stride Entries from one step to the next in rs and nibble, at least count
+
+    @param[in] steps Number of strobes
+
+    @param[in] start_us Time of the first strobe
+
+    @param[in] step_us Time between strobes
+
+    @param[in] threads Number of threads, 0 or 1 for the calling thread only
+*/
+void hd44780_sim_run(hd44780_sim_t * sim, uint32_t first, uint32_t count, const uint8_t * rs, const uint8_t * nibble,
+		     uint32_t stride, uint32_t steps, uint64_t start_us, uint32_t step_us, uint32_t threads);
+
+/*
+    @brief Write a whole byte to one panel over an 8 bit interface
+
+    @param[in,out] sim Batch
+
+    @param[in] panel Panel
+
+    @param[in] rs Register select
+
+    @param[in] value Byte on D0-D7
+
+    @param[in] now_us Time of the strobe
+*/
+void hd44780_sim_byte(hd44780_sim_t * sim, uint32_t panel, uint8_t rs, uint8_t value, uint64_t now_us);
+
+/*
+    @brief Read the visible characters of a line
+
+    @param[in] sim Batch
+
+    @param[in] panel Panel
+
+    @param[in] row Line, 0 or 1
+
+    @param[in] cols Visible columns
+
+    @param[out] text cols ROM codes and a terminating 0
+*/
+void hd44780_sim_line(const hd44780_sim_t * sim, uint32_t panel, uint8_t row, uint8_t cols, char * text);
+
+#endif
@@ -0,0 +1,178 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    hd44780_sim_bench.c
+
+  @Summary
+    Throughput of the batched HD44780 simulator
+
+  @Description
+    Wakes a batch of simulated panels up the way the driver does, then
+    replays full screen frames of different text into every panel and prints
+    the strobes simulated per second, per thread count. Every panel is
+    checked against the text it was sent at the end.
+
+    Build on the host with:
+      cc -O3 -march=native -DHD44780_SIM_PTHREADS -o hd44780_sim_bench hd44780_sim_bench.c hd44780_sim.c -lpthread
+
+    Usage:
+      hd44780_sim_bench [panels] [frames] [max threads]
+******************************************************************************/
+
+#include "hd44780_sim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_COLS 16
+#define BENCH_FRAME_BYTES (2 * (1 + BENCH_COLS)) // address and text of both lines
+#define BENCH_FRAME_STROBES (2 * BENCH_FRAME_BYTES)
+#define BENCH_STROBE_US 50 // longer than a data write takes to execute, so no strobe finds a panel busy
+
+static uint8_t * frame_rs;
+static uint8_t * frame_nibble;
+
+static void bench_put(uint32_t count, uint32_t panel, uint32_t step, uint8_t rs, uint8_t nibble);
+static char bench_char(uint32_t panel, uint32_t frame, uint8_t row, uint8_t col);
+static void bench_build(uint32_t count, uint32_t frame);
+static double wall_s(void);
+
+int main(int argc, char * argv[]) {
+    const uint32_t count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    const uint32_t frames = (argc > 2) ? strtoul(argv[2], NULL, 0) : 200;
+    const uint32_t max_threads = (argc > 3) ? strtoul(argv[3], NULL, 0) : 8;
+    static const uint8_t wake[] = {0x3, 0x3, 0x3, 0x2}; // 8 bit strobes, the last one switches to 4 bit
+    static const uint8_t setup[] = {0x28, 0x0C, 0x01, 0x06}; // 2 lines, display on, clear, increment
+    hd44780_sim_t sim;
+    uint8_t * rs;
+    uint8_t * nibble;
+    uint64_t now_us = 0;
+    uint32_t threads;
+    uint32_t panel;
+    uint32_t frame;
+    uint32_t bad = 0;
+    uint32_t i;
+    char line[BENCH_COLS + 1];
+
+    if(count == 0 || frames == 0) {
+	fprintf(stderr, "usage: %s [panels] [frames] [max threads]\n", argv[0]);
+	return 1;
+    }
+
+    rs = calloc(count, 1);
+    nibble = malloc(count);
+    frame_rs = malloc((size_t)count * BENCH_FRAME_STROBES);
+    frame_nibble = malloc((size_t)count * BENCH_FRAME_STROBES);
+    if(rs == NULL || nibble == NULL || frame_rs == NULL || frame_nibble == NULL || !hd44780_sim_init(&sim, count)) {
+	fprintf(stderr, "out of memory\n");
+	return 1;
+    }
+
+    // every panel takes the same wake up and setup
+    for(i = 0; i < sizeof(wake); i++) {
+	memset(nibble, wake[i], count);
+	hd44780_sim_strobe(&sim, 0, count, rs, nibble, now_us);
+	now_us += 5000;
+    }
+    for(i = 0; i < 2 * sizeof(setup); i++) {
+	memset(nibble, (i & 1) ? setup[i / 2] & 0x0F : setup[i / 2] >> 4, count);
+	hd44780_sim_strobe(&sim, 0, count, rs, nibble, now_us);
+	now_us += 2000;
+    }
+
+    printf("%u panels, %u frames of %u strobes\n", count, frames, BENCH_FRAME_STROBES);
+    printf("%8s %16s %16s\n", "threads", "strobes/s", "per thread");
+    for(threads = 1; threads <= max_threads; threads *= 2) {
+	double start;
+	double elapsed;
+	double rate;
+
+	// the frames are built outside the timing, the text changes every frame
+	for(frame = 0, elapsed = 0; frame < frames; frame++) {
+	    bench_build(count, frame);
+	    start = wall_s();
+	    hd44780_sim_run(&sim, 0, count, frame_rs, frame_nibble, count, BENCH_FRAME_STROBES, now_us, BENCH_STROBE_US, threads);
+	    elapsed += wall_s() - start;
+	    now_us += (uint64_t)BENCH_FRAME_STROBES * BENCH_STROBE_US;
+	}
+
+	rate = (double)count * frames * BENCH_FRAME_STROBES / elapsed;
+	printf("%8u %16.0f %16.0f\n", threads, rate, rate / threads);
+    }
+
+    // the last frame must be on every panel
+    for(panel = 0; panel < count; panel++) {
+	uint8_t row;
+	uint8_t col;
+
+	for(row = 0; row < 2; row++) {
+	    hd44780_sim_line(&sim, panel, row, BENCH_COLS, line);
+	    for(col = 0; col < BENCH_COLS; col++)
+		if(line[col] != bench_char(panel, frames - 1, row, col)) {
+		    bad++;
+		    break;
+		}
+	}
+	if(sim.busy_strobes[panel] != 0)
+	    bad++;
+    }
+    printf("panels wrong or strobed while busy: %u\n", bad);
+
+    hd44780_sim_free(&sim);
+    free(rs);
+    free(nibble);
+    free(frame_rs);
+    free(frame_nibble);
+    return bad != 0;
+}
+
+/*
+    @brief Function for setting what one panel sees on one step of the frame
+*/
+static void bench_put(uint32_t count, uint32_t panel, uint32_t step, uint8_t rs, uint8_t nibble) {
+    frame_rs[(size_t)step * count + panel] = rs;
+    frame_nibble[(size_t)step * count + panel] = nibble;
+}
+
+/*
+    @brief Function for the character a panel shows in a frame, different on every panel and frame
+*/
+static char bench_char(uint32_t panel, uint32_t frame, uint8_t row, uint8_t col) {
+    return (char)(' ' + (panel * 7 + frame * 3 + row * BENCH_COLS + col) % 95);
+}
+
+/*
+    @brief Function for building the strobes of one frame for every panel
+*/
+static void bench_build(uint32_t count, uint32_t frame) {
+    uint32_t panel;
+    uint32_t step;
+    uint8_t row;
+    uint8_t col;
+
+    for(panel = 0; panel < count; panel++) {
+	step = 0;
+	for(row = 0; row < 2; row++) {
+	    const uint8_t address = row ? 0xC0 : 0x80;
+
+	    bench_put(count, panel, step++, 0, address >> 4);
+	    bench_put(count, panel, step++, 0, address & 0x0F);
+	    for(col = 0; col < BENCH_COLS; col++) {
+		const uint8_t c = (uint8_t)bench_char(panel, frame, row, col);
+
+		bench_put(count, panel, step++, 1, c >> 4);
+		bench_put(count, panel, step++, 1, c & 0x0F);
+	    }
+	}
+    }
+}
+
+static double wall_s(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,172 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_bench.c
+
+  @Summary
+    Host baseline of the driver's cost per API
+
+  @Description
+    Runs the driver against the host shim and prints, for every API, the
+    mean and the longest bus time of a call on the virtual clock, the number
+    of gpio writes and the CPU time the host spent in the driver. Only the
+    API the driver started with is used, so the same bench builds against
+    the original lcd_16x2.c and against the current one, and the two tables
+    show what the later changes bought. The features added since are
+    measured by lcd_feature_bench.c.
+
+    Build on the host against the current driver with:
+      cc -O2 -I. -I../src -o lcd_bench lcd_bench.c nrf_shim.c ../src/lcd_16x2.c
+
+    and against the driver as it was in the first commit of the repository with:
+      mkdir -p baseline
+      git show $(git rev-list --max-parents=0 HEAD):src/lcd_16x2.h > baseline/lcd_16x2.h
+      git show $(git rev-list --max-parents=0 HEAD):src/lcd_16x2.c > baseline/lcd_16x2.c
+      cc -O2 -I. -Ibaseline -o lcd_bench_baseline lcd_bench.c nrf_shim.c baseline/lcd_16x2.c
+
+    The original file calls sprintf() without including stdio.h, expect a
+    warning about it.
+
+    Usage:
+      lcd_bench [iterations]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// pins of the bench wiring, all on port 0
+#define PIN_RS 1
+#define PIN_EN 2
+#define PIN_D4 3
+#define PIN_D5 4
+#define PIN_D6 5
+#define PIN_D7 6
+
+static char bench_line[] = "0123456789ABCDEF";
+
+static void bench_init(void) {
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+}
+
+static void bench_clear(void) {
+    lcd_clear();
+}
+
+static void bench_home(void) {
+    lcd_home();
+}
+
+static void bench_set_cursor(void) {
+    lcd_set_cursor(3, 1);
+}
+
+static void bench_display_on(void) {
+    lcd_display_on();
+}
+
+static void bench_write_char(void) {
+    lcd_write_char('A');
+}
+
+static void bench_write_string(void) {
+    lcd_set_cursor(0, 0);
+    lcd_write_string(bench_line);
+}
+
+static void bench_write_int(void) {
+    lcd_set_cursor(0, 1);
+    lcd_write_int(123456);
+}
+
+static void bench_write_float(void) {
+    lcd_set_cursor(0, 1);
+    lcd_write_float(21.5f);
+}
+
+static void bench_full_screen(void) {
+    lcd_set_cursor(0, 0);
+    lcd_write_string(bench_line);
+    lcd_set_cursor(0, 1);
+    lcd_write_string(bench_line);
+}
+
+static void bench_cell_by_cell(void) {
+    uint8_t col;
+
+    // the way many callers draw, a cursor move before every character
+    for(col = 0; col < 16; col++) {
+	lcd_set_cursor(col, 0);
+	lcd_write_char(bench_line[col]);
+    }
+}
+
+typedef struct {
+    const char * name;
+    void (*run)(void);
+} bench_t;
+
+static const bench_t benches[] = {
+    {"lcd_init", bench_init},
+    {"lcd_clear", bench_clear},
+    {"lcd_home", bench_home},
+    {"lcd_set_cursor", bench_set_cursor},
+    {"lcd_display_on", bench_display_on},
+    {"lcd_write_char", bench_write_char},
+    {"lcd_write_string 16", bench_write_string},
+    {"lcd_write_int", bench_write_int},
+    {"lcd_write_float", bench_write_float},
+    {"full screen", bench_full_screen},
+    {"line, cell by cell", bench_cell_by_cell},
+};
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char * argv[]) {
+    const unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    unsigned long i;
+    size_t b;
+    uint64_t start_us;
+    uint64_t start_ns;
+    uint64_t total_us;
+    uint64_t call_us;
+    uint64_t max_us;
+
+    if(iterations == 0) {
+	fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+	return 1;
+    }
+
+    bench_init();
+
+    printf("%-24s %12s %12s %12s %12s\n", "api", "mean us", "max us", "gpio writes", "cpu ns");
+    for(b = 0; b < sizeof(benches) / sizeof(*benches); b++) {
+	shim_reset_counts();
+	start_ns = cpu_ns();
+	total_us = 0;
+	max_us = 0;
+
+	for(i = 0; i < iterations; i++) {
+	    start_us = shim_now_us;
+	    benches[b].run();
+	    call_us = shim_now_us - start_us;
+	    total_us += call_us;
+	    if(call_us > max_us)
+		max_us = call_us;
+	}
+
+	printf("%-24s %12.1f %12" PRIu64 " %12.1f %12.1f\n", benches[b].name, (double)total_us / iterations, max_us,
+	       (double)shim_gpio_writes / iterations, (double)(cpu_ns() - start_ns) / iterations);
+    }
+
+    return 0;
+}
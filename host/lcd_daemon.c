@@ -0,0 +1,237 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_daemon.c
+
+  @Summary
+    Display daemon for Linux boards with a real time bus thread
+
+  @Description
+    Reads updates from stdin, one per line as the row number, a space and
+    the text, and shows them on a panel driven through lcd_mmio.c. The bus
+    is owned by one worker thread that can run as SCHED_FIFO, pinned to a
+    CPU, with memory locked and its stack prefaulted. Updates that arrive
+    while a frame is being sent are merged into the next frame.
+
+    The daemon measures the time between enable strobes against the delays
+    the driver requested, and the latency from an update being read to the
+    end of the frame showing it, and writes the histograms at exit and every
+    -n frames.
+
+    Build on the board with:
+      cc -O2 -I. -I../src -o lcd_daemon lcd_daemon.c lcd_mmio.c lcd_rt.c hd44780_sim.c ../src/lcd_16x2.c -lpthread
+
+    Usage:
+      lcd_daemon [-d /dev/gpiomem | regs.bin] [-p priority] [-c cpu] [-m] [-s stack kb] [-n frames] [-o stats.txt]
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_16x2.h"
+#include "lcd_mmio.h"
+#include "lcd_rt.h"
+#include "hd44780_sim.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// BCM gpio numbers of the wiring, the same as lcd_mmio_demo.c
+#define PIN_RS 25
+#define PIN_EN 24
+#define PIN_D4 23
+#define PIN_D5 17
+#define PIN_D6 18
+#define PIN_D7 22
+
+#define ROWS 2
+#define COLS 16
+
+typedef struct {
+    char text[ROWS][COLS];
+    uint8_t rows; // bit per row with an update not sent yet
+    uint64_t since_us; // when the oldest update not sent yet was read
+    uint8_t done; // stdin is closed
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} mailbox_t;
+
+static mailbox_t mailbox = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER};
+static lcd_rt_config_t rt = {0, -1, 0, 0};
+static uint32_t stats_every = 0;
+static FILE * stats_out = NULL;
+
+static lcd_rt_hist_t strobe_interval; // time between enable strobes
+static lcd_rt_hist_t strobe_stretch; // that time minus the delays the driver asked for
+static lcd_rt_hist_t frame_latency; // update read until the frame showing it is on the glass
+
+static void on_strobe(uint64_t actual_ns, uint64_t requested_ns);
+static void * bus_run(void * arg);
+static void stats_write(void);
+static uint64_t now_us(void);
+
+int main(int argc, char * argv[]) {
+    static const mmio_layout_t layout = MMIO_LAYOUT_BCM2835;
+    static const uint32_t data[4] = {PIN_D4, PIN_D5, PIN_D6, PIN_D7};
+    static const uint32_t en[1] = {PIN_EN};
+    const char * device = "/dev/gpiomem";
+    hd44780_sim_t sim;
+    pthread_t bus;
+    uint8_t fake;
+    char line[256];
+    size_t length;
+    int row;
+    int opt;
+
+    while((opt = getopt(argc, argv, "d:p:c:ms:n:o:")) != -1) {
+	switch(opt) {
+	case 'd': device = optarg; break;
+	case 'p': rt.priority = atoi(optarg); break;
+	case 'c': rt.cpu = atoi(optarg); break;
+	case 'm': rt.lock_memory = 1; break;
+	case 's': rt.prefault_kb = strtoul(optarg, NULL, 0); break;
+	case 'n': stats_every = strtoul(optarg, NULL, 0); break;
+	case 'o':
+	    stats_out = fopen(optarg, "w");
+	    if(stats_out == NULL) {
+		perror(optarg);
+		return 1;
+	    }
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-d /dev/gpiomem | regs.bin] [-p priority] [-c cpu] [-m] [-s stack kb] "
+		    "[-n frames] [-o stats.txt]\n", argv[0]);
+	    return 1;
+	}
+    }
+    if(stats_out == NULL)
+	stats_out = stderr;
+
+    fake = strncmp(device, "/dev/", 5) != 0;
+    if(!mmio_open(device, &layout, fake)) {
+	perror(device);
+	return 1;
+    }
+    if(fake && (!hd44780_sim_init(&sim, 1) || !mmio_watch_start(device, &layout, &sim, PIN_RS, data, en, 1))) {
+	fprintf(stderr, "cannot start the watcher\n");
+	return 1;
+    }
+    mmio_set_strobe_hook((uint32_t)1 << PIN_EN, on_strobe);
+
+    memset(mailbox.text, ' ', sizeof(mailbox.text));
+    if(pthread_create(&bus, NULL, bus_run, NULL) != 0) {
+	fprintf(stderr, "cannot start the bus thread\n");
+	return 1;
+    }
+
+    while(fgets(line, sizeof(line), stdin) != NULL) {
+	if(line[0] < '0' || line[0] >= '0' + ROWS || line[1] != ' ')
+	    continue;
+	row = line[0] - '0';
+	length = strcspn(line + 2, "\r\n");
+	if(length > COLS)
+	    length = COLS;
+
+	pthread_mutex_lock(&mailbox.lock);
+	memset(mailbox.text[row], ' ', COLS);
+	memcpy(mailbox.text[row], line + 2, length);
+	if(mailbox.rows == 0)
+	    mailbox.since_us = now_us();
+	mailbox.rows |= 1 << row;
+	pthread_cond_signal(&mailbox.wake);
+	pthread_mutex_unlock(&mailbox.lock);
+    }
+
+    pthread_mutex_lock(&mailbox.lock);
+    mailbox.done = 1;
+    pthread_cond_signal(&mailbox.wake);
+    pthread_mutex_unlock(&mailbox.lock);
+    pthread_join(bus, NULL);
+
+    mmio_close();
+    stats_write();
+
+    if(fake) {
+	mmio_watch_stop();
+	fprintf(stats_out, "simulated panel: strobes %" PRIu32 ", while busy %" PRIu32 "\n", sim.strobes[0],
+		sim.busy_strobes[0]);
+	hd44780_sim_free(&sim);
+    }
+    return 0;
+}
+
+/*
+    @brief Function for timing every enable strobe, called from the bus thread
+*/
+static void on_strobe(uint64_t actual_ns, uint64_t requested_ns) {
+    lcd_rt_hist_add(&strobe_interval, actual_ns / 1000);
+    lcd_rt_hist_add(&strobe_stretch, (actual_ns > requested_ns) ? (actual_ns - requested_ns) / 1000 : 0);
+}
+
+/*
+    @brief Function for the bus thread, the only one touching the driver
+*/
+static void * bus_run(void * arg) {
+    char text[ROWS][COLS];
+    uint8_t rows;
+    uint64_t since;
+    uint32_t frames = 0;
+    uint8_t row;
+
+    (void)arg;
+
+    lcd_rt_apply(&rt, stderr);
+
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+    lcd_write_combine_on();
+
+    for(;;) {
+	pthread_mutex_lock(&mailbox.lock);
+	while(mailbox.rows == 0 && !mailbox.done)
+	    pthread_cond_wait(&mailbox.wake, &mailbox.lock);
+	if(mailbox.rows == 0) {
+	    pthread_mutex_unlock(&mailbox.lock);
+	    break;
+	}
+	memcpy(text, mailbox.text, sizeof(text));
+	rows = mailbox.rows;
+	since = mailbox.since_us;
+	mailbox.rows = 0;
+	pthread_mutex_unlock(&mailbox.lock);
+
+	for(row = 0; row < ROWS; row++) {
+	    if(rows & (1 << row)) {
+		lcd_set_cursor(0, row);
+		lcd_write_buffer((const uint8_t *)text[row], COLS);
+	    }
+	}
+	lcd_flush();
+	lcd_rt_hist_add(&frame_latency, now_us() - since);
+
+	if(stats_every != 0 && ++frames % stats_every == 0)
+	    stats_write();
+    }
+
+    return NULL;
+}
+
+/*
+    @brief Function for writing every histogram
+*/
+static void stats_write(void) {
+    lcd_rt_hist_print(&strobe_interval, "strobe interval", stats_out);
+    lcd_rt_hist_print(&strobe_stretch, "strobe stretch", stats_out);
+    lcd_rt_hist_print(&frame_latency, "frame latency", stats_out);
+    fflush(stats_out);
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
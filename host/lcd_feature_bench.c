@@ -0,0 +1,1417 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_feature_bench.c
+
+  @Summary
+    Host measurements of the driver's features and its cost model
+
+  @Description
+    Runs the driver against the host shim with the pin writes fed
+    into the HD44780 simulator, and prints, for every API, the mean and the
+    longest bus time of a call, the most bytes a call sent, the number of
+    gpio writes and the CPU time the host spent in the driver. Bus time runs
+    until the controller has finished the last instruction and bytes are
+    counted from the strobes the controller latched. The worst case from
+    lcd_cost.h is printed next to them, a call above it is flagged and makes
+    the bench fail, as does a strobe arriving while the controller is busy.
+
+    Then lcd_cost_init() is checked against an init, and lcd_plan_pending()
+    with lcd_cost_sequence() against random frames flushed for real, the
+    bytes have to match and the bus time may not be longer than predicted.
+    Call sequences captured from applications drawing the usual way, a
+    cursor move before every character, redundant display on and entry mode
+    calls, fields blanked before they are written, are replayed with write
+    combining off and on, comparing the bytes and bus time per frame, the
+    panel has to end up showing the same in both.
+
+    The blink attribute is shown for a while with each mechanism the driver
+    picks, printing the bus bytes per blink period, and the hardware blink of
+    a single cell has to survive the application turning the cursor off.
+
+    A clock then shows a new second at a deadline, once written the usual
+    way when the deadline comes and once prepared ahead and sent by
+    lcd_present_at(), and the distribution of how late each frame was on the
+    glass is printed. Busy waits on time_us() advance the virtual clock a
+    microsecond per poll, with a 20 to 119us interrupt every 200 polls on
+    average standing in for the radio and other tasks.
+
+    The bus is then shared with an ADC that samples every 1000us and may not
+    see the data lines move for the first 300us of each period. Frames go
+    out once blocking and once through lcd_flush_poll() from a main loop,
+    and the window utilisation and the latency the windows added are
+    printed. A strobe in a closed window, or a byte whose nibbles straddle
+    two windows, fails the bench.
+
+    Next the run extraction of lcd_prepare_flush(), ctz scans over the dirty
+    bitmap, is timed against comparing the frame buffer with the glass cell
+    by cell, for screens with more and more changed cells. Both have to find
+    the same runs. The cycles they would take on a Cortex-M4 and on a
+    Cortex-M0+, which has no CLZ and counts trailing zeros with a de Bruijn
+    multiply, are estimated from the words, set bits, runs and cells each
+    one visits and the instruction timings of the cores. Measure the real
+    thing on the target with time_us() around lcd_prepare_flush().
+    Last a set of typical screens, plain text, a bar graph, big digits and
+    status icons with their glyph sets, is packed and compared with storing
+    them as strings, each one has to show on the panel after it is played,
+    and the menu is decoded into the frame buffer to compare the decoder
+    with the rate the bus takes bytes at.
+
+    Build on the host with:
+      cc -O2 -DLCD_MAX_PANELS=2 -I. -I../src -o lcd_feature_bench lcd_feature_bench.c hd44780_sim.c nrf_shim.c ../src/lcd_16x2.c \
+        ../src/lcd_trace.c ../src/lcd_cost.c ../src/lcd_asset.c ../src/lcd_asset_pack.c
+
+    Add -DLCD_TRACE and give a file name to run every API once more with the
+    tracer on and write the trace to the file as Chrome trace event JSON.
+
+    Usage:
+      lcd_feature_bench [iterations] [trace.json]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "lcd_asset.h"
+#include "lcd_cost.h"
+#include "lcd_trace.h"
+#include "hd44780_sim.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// pins of the bench wiring, all on port 0
+#define PIN_RS 1
+#define PIN_EN 2
+#define PIN_D4 3
+#define PIN_D5 4
+#define PIN_D6 5
+#define PIN_D7 6
+#define PIN_EN2 7 // second panel, for lcd_select_panels()
+
+#define SIM_PANELS 2
+
+// the ADC sampling the bench shares the bus with, the data lines must not move while it samples
+#define ADC_PERIOD_US 1000
+#define ADC_SAMPLE_US 300
+#define LOOP_WORK_US 150 // what the main loop does between two lcd_flush_poll() calls
+
+static const uint8_t bench_glyph[8] = {0x04, 0x0E, 0x1F, 0x04, 0x04, 0x04, 0x04, 0x00};
+static char bench_line[] = "0123456789ABCDEF";
+static uint32_t bench_reading = 0; // changes every call, like a sensor
+
+// a menu screen with an arrow glyph, packed the way tools/lcd_asset_packer.c does it
+static const uint8_t bench_arrow[8] = {0x00, 0x04, 0x06, 0x1F, 0x06, 0x04, 0x00, 0x00};
+
+// screens and glyph sets the asset packer is measured on, a typical instrument
+static const uint8_t bench_bars[5][8] = {
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10}, {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C}, {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E},
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F}};
+static const uint8_t bench_digits[8][8] = { // segments of 2x3 cell digits
+    {0x07, 0x0F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F}, {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x1C, 0x1E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F}, {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0F, 0x07},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F}, {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1E, 0x1C},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x1F}, {0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F}};
+static const uint8_t bench_icons[8][8] = { // battery, bell, signal, lock, clock, heart, degree, check
+    {0x0E, 0x1B, 0x11, 0x11, 0x1F, 0x1F, 0x1F, 0x1F}, {0x04, 0x0E, 0x0E, 0x0E, 0x1F, 0x00, 0x04, 0x00},
+    {0x00, 0x01, 0x01, 0x05, 0x05, 0x15, 0x15, 0x00}, {0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00},
+    {0x00, 0x0E, 0x15, 0x17, 0x11, 0x0E, 0x00, 0x00}, {0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00},
+    {0x06, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00}};
+
+typedef struct {
+    const char * name;
+    uint8_t glyphs; // custom characters uploaded first
+    uint8_t first_slot;
+    const uint8_t (*glyph)[8];
+    uint8_t line[2][16]; // ROM codes of both lines
+} bench_asset_t;
+
+static const bench_asset_t bench_assets[] = {
+    {"menu", 1, 1, &bench_arrow, {"----- MENU -----", "\x01 Backlight     "}},
+    {"splash", 0, 0, NULL, {"  ACME  THERMO  ", "   fw 2.14.0    "}},
+    {"status", 0, 0, NULL, {"Temp     21.5 C ", "Hum      48.0 % "}},
+    {"alert", 0, 0, NULL, {"                ", "   DOOR  OPEN   "}},
+    {"divider", 0, 0, NULL, {"================", "Total    1234.56"}},
+    {"bar graph", 5, 1, bench_bars, {"Vol \x05\x05\x05\x05\x05\x05\x05\x03    ", "Bass\x05\x05\x05\x02        "}},
+    {"big digits", 8, 0, bench_digits,
+     {{0, 1, 2, ' ', ' ', 2, ' ', 1, 1, 2, ' ', 1, 1, 2, ' ', ' '},
+      {3, 4, 5, ' ', ' ', 5, ' ', 3, 6, 6, ' ', 7, 7, 5, ' ', ' '}}},
+    {"status icons", 8, 0, bench_icons,
+     {{0, ' ', 2, ' ', 3, ' ', ' ', ' ', ' ', ' ', ' ', ' ', 4, '1', '2', ':'},
+      {'2', '1', 6, 'C', ' ', 5, ' ', '7', '2', ' ', ' ', ' ', ' ', ' ', 7, 1}}},
+};
+
+static hd44780_sim_t sim;
+static uint8_t sim_en_level[SIM_PANELS]; // to see falling edges, the shim reports every write
+static uint64_t sim_last_us = 0; // last strobe on the first panel
+static uint32_t bench_wrong = 0; // calls after which the panel didn't show what was drawn
+static uint32_t poll_seed = 1;
+static uint64_t adc_byte_period = 0; // sampling period the byte on the bus started in
+static uint32_t adc_violations = 0; // strobes in a closed window or bytes split across windows
+
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us);
+static uint64_t bus_free_us(void);
+
+static void bench_init(void) {
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+}
+
+static void bench_clear(void) {
+    lcd_clear();
+}
+
+static void bench_set_cursor(void) {
+    lcd_set_cursor(3, 1);
+}
+
+static void bench_write_char(void) {
+    lcd_write_char('A');
+}
+
+static void bench_write_string(void) {
+    lcd_set_cursor(0, 0);
+    lcd_write_string(bench_line);
+}
+
+static void bench_write_int(void) {
+    lcd_set_cursor(0, 1);
+    lcd_write_int(123456);
+}
+
+static void bench_write_float(void) {
+    lcd_set_cursor(0, 1);
+    lcd_write_float(21.5f);
+}
+
+static void bench_create_char(void) {
+    lcd_create_char(1, bench_glyph);
+    lcd_set_cursor(0, 0);
+}
+
+static void bench_full_screen(void) {
+    lcd_set_cursor(0, 0);
+    lcd_write_string(bench_line);
+    lcd_set_cursor(0, 1);
+    lcd_write_string(bench_line);
+}
+
+static void bench_clear_right(void) {
+    char line[17];
+
+    // the last right aligned write left the controller decrementing, clear puts it back to incrementing
+    lcd_clear();
+    lcd_set_cursor(15, 0);
+    lcd_write_int_right(57, 0);
+    hd44780_sim_line(&sim, 0, 0, 16, line);
+    if(strcmp(line, "              57") != 0)
+	bench_wrong++;
+}
+
+static void bench_off_draw_on(void) {
+    char line[17];
+
+    // the display may only come back on once the new text is in DDRAM
+    bench_line[0] = (bench_line[0] == '0') ? '1' : '0';
+    lcd_write_combine_on();
+    lcd_display_off();
+    lcd_set_cursor(0, 0);
+    lcd_write_string(bench_line);
+    lcd_display_on();
+    hd44780_sim_line(&sim, 0, 0, 16, line);
+    if(!(sim.control[0] & LCD_DISPLAYON) || strcmp(line, bench_line) != 0)
+	bench_wrong++;
+    lcd_write_combine_off();
+}
+
+static void bench_rotate_screen(void) {
+    // rotate the text so every cell changes
+    char first = bench_line[0];
+    uint8_t i;
+
+    for(i = 0; i < 15; i++)
+	bench_line[i] = bench_line[i + 1];
+    bench_line[15] = first;
+
+    bench_full_screen();
+}
+
+static void bench_flush_full_screen(void) {
+    lcd_write_combine_on();
+    bench_rotate_screen();
+    lcd_flush();
+    lcd_write_combine_off();
+}
+
+static void bench_combine_on(void) {
+    lcd_write_combine_on();
+}
+
+static void bench_combine_off(void) {
+    lcd_write_combine_off();
+}
+
+static void bench_flush_poll(void) {
+    bench_rotate_screen();
+    lcd_flush_poll(); // no bus window, so everything goes out
+}
+
+static void bench_present_at(void) {
+    bench_rotate_screen();
+    lcd_present_at(time_us()); // due already, only the plan is timed
+}
+
+static void bench_attr_setup(void) {
+    static const uint8_t codes[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint8_t rows[8];
+    uint8_t slot;
+    uint8_t row;
+
+    // a custom character in every slot for the inverse attribute, next to plain text
+    for(slot = 0; slot < 8; slot++) {
+	for(row = 0; row < 8; row++)
+	    rows[row] = bench_glyph[(row + slot) & 7];
+	lcd_create_char(slot, rows);
+    }
+    lcd_set_cursor(0, 1);
+    lcd_write_buffer(codes, sizeof(codes));
+    lcd_write_string("ABCDEFGH");
+}
+
+static void bench_attr_done(void) {
+    lcd_set_attr(0, 0, LCD_DDRAM_SIZE, 0);
+}
+
+static void bench_set_attr(void) {
+    static uint8_t on = 0;
+
+    // every CGRAM slot inverted or put back and the blink mechanism picked again
+    on = !on;
+    lcd_set_attr(0, 1, 16, on ? (LCD_ATTR_BLINK | LCD_ATTR_INVERSE) : 0);
+}
+
+static void bench_attr_tick_setup(void) {
+    bench_attr_setup();
+    lcd_set_attr(0, 1, 16, LCD_ATTR_BLINK); // glyphs and text blink together, so the cells are rewritten
+}
+
+static void bench_attr_tick(void) {
+    lcd_attr_tick();
+}
+
+static void bench_flip_setup(void) {
+    lcd_write_combine_on();
+    lcd_page_flip_on();
+}
+
+static void bench_flip_page(void) {
+    bench_rotate_screen();
+    lcd_flip_page();
+}
+
+static void bench_flip_done(void) {
+    lcd_page_flip_off();
+    lcd_write_combine_off();
+    lcd_home();
+}
+
+static void bench_warm_setup(void) {
+    uint8_t i;
+
+    // the longest shift to put back
+    lcd_clear();
+    for(i = 0; i < LCD_LINE_LENGTH - 1; i++)
+	lcd_shift_left();
+    lcd_retain();
+}
+
+static void bench_warm_init(void) {
+    static uint8_t invert = 0;
+    uint8_t rows[8];
+    uint8_t slot;
+    uint8_t i;
+
+    // picked up, then a screen and custom characters that all differ from the retained ones
+    lcd_warm_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+    invert ^= 0x1F;
+    lcd_write_combine_on();
+    for(slot = 0; slot < 8; slot++) {
+	for(i = 0; i < 8; i++)
+	    rows[i] = bench_glyph[i] ^ invert;
+	lcd_create_char(slot, rows);
+    }
+    bench_rotate_screen();
+    lcd_flush();
+    lcd_write_combine_off();
+}
+
+static void bench_warm_done(void) {
+    lcd_home();
+    lcd_clear();
+}
+
+#if LCD_MAX_PANELS > 1
+static void bench_panels_setup(void) {
+    lcd_add_panel(PIN_EN2);
+    lcd_write_combine_on();
+}
+
+static void bench_select_panels(void) {
+    static uint8_t both = 0;
+
+    // pending cells go to the old selection first
+    bench_rotate_screen();
+    both = !both;
+    lcd_select_panels(both ? 0x03 : 0x01);
+}
+
+static void bench_panels_done(void) {
+    lcd_select_panels(0x01);
+    lcd_write_combine_off();
+}
+#endif
+
+static void bench_field_padded(void) {
+    char str[12];
+
+    // right aligned the usual way, formatted to the field width and written from its left edge
+    snprintf(str, sizeof(str), "%6" PRIu32, bench_reading++ % 1000000);
+    lcd_set_cursor(10, 1);
+    lcd_write_buffer((const uint8_t *)str, 6);
+}
+
+static void bench_field_right(void) {
+    lcd_set_cursor(15, 1);
+    lcd_write_int_right(bench_reading++ % 1000000, 6);
+}
+
+typedef struct {
+    const char * name;
+    void (*setup)(void); // run before the calls and not measured, NULL for none
+    void (*run)(void);
+    void (*done)(void); // run after the calls and not measured, NULL for none
+    uint8_t apis[4]; // lcd_cost_api() of every call the bench makes
+    uint16_t length; // characters written for the string APIs, blinking cells for the attribute APIs
+} bench_t;
+
+#define NO_API 0xFF
+
+static const bench_t benches[] = {
+    {"lcd_init", NULL, bench_init, NULL, {LCD_COST_INIT, NO_API, NO_API, NO_API}, 0},
+    {"lcd_warm_init, redraw", bench_warm_setup, bench_warm_init, bench_warm_done,
+     {LCD_COST_WARM_INIT, NO_API, NO_API, NO_API}, 0},
+    {"lcd_clear", NULL, bench_clear, NULL, {LCD_COST_CLEAR, NO_API, NO_API, NO_API}, 0},
+    {"lcd_set_cursor", NULL, bench_set_cursor, NULL, {LCD_COST_COMMAND, NO_API, NO_API, NO_API}, 0},
+    {"lcd_write_char", NULL, bench_write_char, NULL, {LCD_COST_WRITE_CHAR, NO_API, NO_API, NO_API}, 0},
+    {"lcd_write_string 16", NULL, bench_write_string, NULL, {LCD_COST_COMMAND, LCD_COST_WRITE_STRING, NO_API, NO_API},
+     16},
+    {"lcd_write_int", NULL, bench_write_int, NULL, {LCD_COST_COMMAND, LCD_COST_WRITE_INT, NO_API, NO_API}, 0},
+    {"lcd_write_float", NULL, bench_write_float, NULL, {LCD_COST_COMMAND, LCD_COST_WRITE_FLOAT, NO_API, NO_API}, 0},
+    {"lcd_create_char", NULL, bench_create_char, NULL, {LCD_COST_CREATE_CHAR, LCD_COST_COMMAND, NO_API, NO_API}, 0},
+    {"full screen", NULL, bench_full_screen, NULL,
+     {LCD_COST_COMMAND, LCD_COST_WRITE_STRING, LCD_COST_COMMAND, LCD_COST_WRITE_STRING}, 16},
+    {"full screen, combined", NULL, bench_flush_full_screen, NULL, {LCD_COST_FLUSH, LCD_COST_COMMAND, NO_API, NO_API}, 0},
+    {"off, draw, on, combined", NULL, bench_off_draw_on, NULL,
+     {LCD_COST_COMMAND, LCD_COST_FLUSH, LCD_COST_COMMAND, LCD_COST_COMMAND}, 0},
+    {"lcd_flush_poll", bench_combine_on, bench_flush_poll, bench_combine_off,
+     {LCD_COST_FLUSH_POLL, NO_API, NO_API, NO_API}, 0},
+    {"lcd_present_at", bench_combine_on, bench_present_at, bench_combine_off,
+     {LCD_COST_PRESENT_AT, NO_API, NO_API, NO_API}, 0},
+    {"field, padded", NULL, bench_field_padded, NULL, {LCD_COST_COMMAND, LCD_COST_WRITE_BUFFER, NO_API, NO_API}, 6},
+    {"field, write_int_right", NULL, bench_field_right, NULL,
+     {LCD_COST_COMMAND, LCD_COST_WRITE_INT_RIGHT, NO_API, NO_API}, 6},
+    {"clear, write_int_right", NULL, bench_clear_right, NULL,
+     {LCD_COST_CLEAR, LCD_COST_COMMAND, LCD_COST_WRITE_INT_RIGHT, NO_API}, 0},
+    {"lcd_set_attr", bench_attr_setup, bench_set_attr, bench_attr_done, {LCD_COST_SET_ATTR, NO_API, NO_API, NO_API},
+     16},
+    {"lcd_attr_tick", bench_attr_tick_setup, bench_attr_tick, bench_attr_done,
+     {LCD_COST_ATTR_TICK, NO_API, NO_API, NO_API}, 16},
+    {"lcd_flip_page", bench_flip_setup, bench_flip_page, bench_flip_done, {LCD_COST_FLIP_PAGE, NO_API, NO_API, NO_API},
+     0},
+#if LCD_MAX_PANELS > 1
+    {"lcd_select_panels", bench_panels_setup, bench_select_panels, bench_panels_done,
+     {LCD_COST_SELECT_PANELS, NO_API, NO_API, NO_API}, 0},
+#endif
+};
+
+// a call of a captured sequence
+typedef struct {
+    uint8_t op; // CALL_...
+    uint8_t col; // column for CALL_CURSOR, the character for CALL_CHAR
+    uint8_t row;
+    const char * text; // CALL_STRING
+} bench_call_t;
+
+#define CALL_CURSOR 0 // lcd_set_cursor()
+#define CALL_CHAR 1 // lcd_write_char()
+#define CALL_STRING 2 // lcd_write_string()
+#define CALL_DISPLAY_ON 3 // lcd_display_on()
+#define CALL_LEFT_TO_RIGHT 4 // lcd_left_to_right()
+#define CALL_FRAME 5 // the application is done drawing, lcd_flush() with write combining on
+#define CALL_END 6
+
+#define CUR(col, row) {CALL_CURSOR, col, row, NULL}
+#define CHR(c) {CALL_CHAR, c, 0, NULL}
+#define STR(text) {CALL_STRING, 0, 0, text}
+#define ON {CALL_DISPLAY_ON, 0, 0, NULL}
+#define LTR {CALL_LEFT_TO_RIGHT, 0, 0, NULL}
+#define FRAME {CALL_FRAME, 0, 0, NULL}
+#define END {CALL_END, 0, 0, NULL}
+
+// a clock drawn a cell at a time, every cell located on its own
+static const bench_call_t capture_clock[] = {
+    ON, CUR(4, 0), CHR('1'), CUR(5, 0), CHR('2'), CUR(6, 0), CHR(':'), CUR(7, 0), CHR('5'), CUR(8, 0), CHR('9'),
+    CUR(9, 0), CHR(':'), CUR(10, 0), CHR('5'), CUR(11, 0), CHR('8'), FRAME,
+    ON, CUR(4, 0), CHR('1'), CUR(5, 0), CHR('2'), CUR(6, 0), CHR(':'), CUR(7, 0), CHR('5'), CUR(8, 0), CHR('9'),
+    CUR(9, 0), CHR(':'), CUR(10, 0), CHR('5'), CUR(11, 0), CHR('9'), FRAME,
+    ON, CUR(4, 0), CHR('1'), CUR(5, 0), CHR('3'), CUR(6, 0), CHR(':'), CUR(7, 0), CHR('0'), CUR(8, 0), CHR('0'),
+    CUR(9, 0), CHR(':'), CUR(10, 0), CHR('0'), CUR(11, 0), CHR('0'), CUR(3, 1), STR("Tue 14 Oct"), FRAME,
+    END,
+};
+
+// a thermostat redrawing its labels and blanking the readings before writing them
+static const bench_call_t capture_thermostat[] = {
+    LTR, CUR(0, 0), STR("Temp"), CUR(5, 0), STR("     "), CUR(5, 0), STR("21.5C"), CUR(0, 1), STR("Set"), CUR(5, 1),
+    STR("     "), CUR(5, 1), STR("22.0C"), FRAME,
+    LTR, CUR(0, 0), STR("Temp"), CUR(5, 0), STR("     "), CUR(5, 0), STR("21.6C"), CUR(0, 1), STR("Set"), CUR(5, 1),
+    STR("     "), CUR(5, 1), STR("22.0C"), FRAME,
+    END,
+};
+
+// a menu redrawn in full as the selection moves
+static const bench_call_t capture_menu[] = {
+    CUR(0, 0), STR(">Backlight      "), CUR(0, 1), STR(" Contrast       "), FRAME,
+    CUR(0, 0), STR(" Backlight      "), CUR(0, 1), STR(">Contrast       "), FRAME,
+    CUR(0, 0), STR(">Contrast       "), CUR(0, 1), STR(" Language       "), FRAME,
+    CUR(0, 0), STR(" Contrast       "), CUR(0, 1), STR(">Language       "), FRAME,
+    END,
+};
+
+typedef struct {
+    const char * name;
+    const bench_call_t * calls;
+} bench_capture_t;
+
+static const bench_capture_t captures[] = {
+    {"clock", capture_clock},
+    {"thermostat", capture_thermostat},
+    {"menu", capture_menu},
+};
+
+// a screen for the run extraction microbenchmark
+typedef struct {
+    uint8_t frame[LCD_DDRAM_SIZE];
+    uint8_t glass[LCD_DDRAM_SIZE];
+    uint32_t dirty[LCD_DIRTY_WORDS];
+} bench_screen_t;
+
+#define RUN_SCREENS 64 // random screens for every number of changed cells
+#define RUN_MAX (LCD_DDRAM_SIZE / 2 + 1) // runs on a screen, every other cell changed at most
+
+// estimated cycles of every step on a Cortex-M4 and a Cortex-M0+, from loads, ALU operations, taken branches and
+// RBIT + CLZ or the de Bruijn count trailing zeros
+#define M4_WORD 9 // load, test and clear a bitmap word
+#define M4_BIT 15 // count trailing zeros, load the cell and the glass, compare, clear the lowest bit
+#define M4_RUN 14 // two count trailing zeros and the masks around them
+#define M4_CELL 12 // load the cell and the glass, compare, loop
+#define M4_CELL_RUN 4 // start or extend a run
+#define M0_WORD 8
+#define M0_BIT 18
+#define M0_RUN 21
+#define M0_CELL 11
+#define M0_CELL_RUN 4
+
+static FILE * trace_out = NULL;
+
+static uint8_t report_model(unsigned long frames);
+static uint8_t report_captures(unsigned long iterations);
+static uint32_t replay(const bench_call_t * calls, uint8_t combine);
+static void report_present(unsigned long frames);
+static uint8_t report_blink(unsigned long periods);
+static uint8_t report_windows(unsigned long frames);
+static uint8_t adc_window(uint32_t duration_us);
+static void adc_pin(uint32_t pin_no, uint32_t value, uint64_t now_us);
+static void print_spread(const char * name, uint32_t * late, unsigned long count);
+static int compare_late(const void * a, const void * b);
+static void poll_cost(void);
+static uint8_t report_runs(unsigned long iterations);
+static uint8_t runs_ctz(const bench_screen_t * screen, uint8_t * run);
+static uint8_t runs_compare(const bench_screen_t * screen, uint8_t * run);
+static uint8_t report_asset(unsigned long iterations);
+
+static void write_trace(const char * text) {
+    fputs(text, trace_out);
+}
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char * argv[]) {
+    const unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    unsigned long i;
+    size_t b;
+    size_t a;
+    uint64_t start_us;
+    uint64_t start_ns;
+    uint64_t total_us;
+    uint32_t call_us;
+    uint32_t max_us;
+    uint32_t start_strobes;
+    uint32_t call_bytes;
+    uint32_t max_bytes;
+    uint32_t busy;
+    lcd_cost_config_t config;
+    lcd_cost_t wcet;
+    uint8_t call_over;
+    int over = 0;
+
+    if(iterations == 0 || !hd44780_sim_init(&sim, SIM_PANELS)) {
+	fprintf(stderr, "usage: %s [iterations] [trace.json]\n", argv[0]);
+	return 1;
+    }
+
+    shim_set_pin_hook(sim_pin);
+    bench_init();
+    lcd_cost_config_gpio(&config);
+
+    printf("%-24s %10s %10s %10s %10s %10s %12s %12s\n", "api", "mean us", "max us", "wcet us", "max bytes",
+	   "wcet bytes", "gpio writes", "cpu ns");
+    for(b = 0; b < sizeof(benches) / sizeof(*benches); b++) {
+	if(benches[b].setup != NULL)
+	    benches[b].setup();
+
+	shim_reset_counts();
+	start_ns = cpu_ns();
+	total_us = 0;
+	max_us = 0;
+	max_bytes = 0;
+
+	// every call on its own, the worst case bounds each of them and not just the mean
+	for(i = 0; i < iterations; i++) {
+	    start_us = bus_free_us();
+	    start_strobes = sim.strobes[0];
+	    benches[b].run();
+
+	    call_us = (uint32_t)(bus_free_us() - start_us);
+	    call_bytes = (sim.strobes[0] - start_strobes + 1) / 2;
+	    total_us += call_us;
+	    if(call_us > max_us)
+		max_us = call_us;
+	    if(call_bytes > max_bytes)
+		max_bytes = call_bytes;
+	}
+
+	start_ns = cpu_ns() - start_ns;
+	if(benches[b].done != NULL)
+	    benches[b].done();
+
+	wcet.bytes = 0;
+	wcet.bus_us = 0;
+	wcet.cpu_us = 0;
+	for(a = 0; a < sizeof(benches[b].apis) && benches[b].apis[a] != NO_API; a++)
+	    lcd_cost_api(&config, benches[b].apis[a], benches[b].length, &wcet);
+
+	call_over = max_us > wcet.bus_us || max_bytes > wcet.bytes;
+	printf("%-24s %10.1f %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %12.1f %12.1f%s\n", benches[b].name,
+	       (double)total_us / iterations, max_us, wcet.bus_us, max_bytes, wcet.bytes,
+	       (double)shim_gpio_writes / iterations, (double)start_ns / iterations, call_over ? "  over wcet" : "");
+	if(call_over)
+	    over = 1;
+    }
+
+    busy = sim.busy_strobes[0] + sim.busy_strobes[1];
+    printf("\nstrobes while the controller was busy: %" PRIu32 ", calls leaving the wrong text: %" PRIu32 "\n", busy,
+	   bench_wrong);
+    if(busy != 0 || bench_wrong != 0)
+	over = 1;
+
+    if(!report_model(iterations))
+	over = 1;
+    if(!report_captures(iterations))
+	over = 1;
+    report_present(iterations);
+    if(!report_blink(iterations))
+	over = 1;
+    if(!report_windows(iterations))
+	over = 1;
+    if(!report_runs(iterations))
+	over = 1;
+    if(!report_asset(iterations))
+	over = 1;
+
+    if(argc > 2) {
+	trace_out = fopen(argv[2], "w");
+	if(trace_out == NULL) {
+	    perror(argv[2]);
+	    return 1;
+	}
+
+	lcd_trace_clear();
+	for(b = 0; b < sizeof(benches) / sizeof(*benches); b++) {
+	    if(benches[b].setup != NULL)
+		benches[b].setup();
+	    benches[b].run();
+	    if(benches[b].done != NULL)
+		benches[b].done();
+	}
+	lcd_trace_export(&lcd_trace_buffer, write_trace);
+	fclose(trace_out);
+    }
+
+    hd44780_sim_free(&sim);
+    return over;
+}
+
+/*
+    @brief Function for checking the cost model against what the controller saw
+
+    @note an init against lcd_cost_init(), then random frames with lcd_plan_pending() and lcd_cost_sequence()
+	  against lcd_flush(), the panel has to show every frame
+
+    @return 1 if every byte count matched and no bus time was longer than predicted
+*/
+static uint8_t report_model(unsigned long frames) {
+    lcd_cost_config_t config;
+    lcd_cost_t cost = {0, 0, 0};
+    const uint8_t * value;
+    const uint8_t * mode;
+    uint16_t length;
+    uint64_t start_us;
+    uint32_t start_strobes;
+    uint32_t bytes;
+    uint32_t bus_us;
+    uint32_t seed = 1;
+    uint64_t predicted_us = 0;
+    uint64_t measured_us = 0;
+    unsigned long wrong_bytes = 0;
+    unsigned long longer = 0;
+    unsigned long wrong_text = 0;
+    unsigned long f;
+    char expect[2][17];
+    char line[17];
+    uint8_t cells;
+    uint8_t col;
+    uint8_t row;
+    uint8_t ok;
+
+    lcd_cost_config_gpio(&config);
+
+    lcd_cost_init(&config, &cost);
+    start_us = bus_free_us();
+    start_strobes = sim.strobes[0];
+    bench_init();
+    bytes = (sim.strobes[0] - start_strobes + 1) / 2;
+    bus_us = (uint32_t)(bus_free_us() - start_us);
+    ok = bytes == cost.bytes && bus_us <= cost.bus_us;
+    printf("\ninit: predicted %" PRIu32 " bytes in %" PRIu32 " us, measured %" PRIu32 " bytes in %" PRIu32 " us%s\n",
+	   cost.bytes, cost.bus_us, bytes, bus_us, ok ? "" : "  mismatch");
+
+    memset(expect, ' ', sizeof(expect));
+    expect[0][16] = 0;
+    expect[1][16] = 0;
+    lcd_write_combine_on();
+
+    for(f = 0; f < frames; f++) {
+	// a few cells anywhere on the screen, some of them rewritten with what they show
+	for(cells = 1 + (seed >> 16) % 24; cells != 0; cells--) {
+	    seed = seed * 1103515245 + 12345;
+	    col = (seed >> 16) % 16;
+	    row = (seed >> 20) & 1;
+	    expect[row][col] = 'A' + (seed >> 24) % 8;
+	    lcd_set_cursor(col, row);
+	    lcd_write_char(expect[row][col]);
+	}
+
+	lcd_prepare_flush();
+	length = lcd_plan_pending(&value, &mode);
+	cost.bytes = 0;
+	cost.bus_us = 0;
+	cost.cpu_us = 0;
+	lcd_cost_sequence(&config, value, mode, length, &cost);
+
+	start_us = bus_free_us();
+	start_strobes = sim.strobes[0];
+	lcd_flush();
+	bytes = (sim.strobes[0] - start_strobes) / 2;
+	bus_us = (uint32_t)(bus_free_us() - start_us);
+
+	predicted_us += cost.bus_us;
+	measured_us += bus_us;
+	if(bytes != cost.bytes)
+	    wrong_bytes++;
+	if(bus_us > cost.bus_us)
+	    longer++;
+	for(row = 0; row < 2; row++) {
+	    hd44780_sim_line(&sim, 0, row, 16, line);
+	    if(strcmp(line, expect[row]) != 0)
+		wrong_text++;
+	}
+    }
+
+    lcd_write_combine_off();
+
+    printf("plans: %lu frames, predicted %.1f us, measured %.1f us per frame, %lu with other byte counts, %lu longer, "
+	   "%lu wrong lines\n", frames, (double)predicted_us / frames, (double)measured_us / frames, wrong_bytes, longer,
+	   wrong_text);
+    return ok && wrong_bytes == 0 && longer == 0 && wrong_text == 0;
+}
+
+/*
+    @brief Function for replaying the captured call sequences with write combining off and on
+
+    @return 1 if the panel shows the same either way
+*/
+static uint8_t report_captures(unsigned long iterations) {
+    char line[2][2][17]; // what the panel shows after each way
+    uint64_t bus_us[2];
+    uint32_t start_strobes;
+    uint32_t bytes[2];
+    uint32_t frames = 0;
+    uint32_t calls;
+    unsigned long i;
+    uint8_t ok = 1;
+    uint8_t combine;
+    uint8_t row;
+    size_t c;
+
+    printf("\n%-24s %10s %12s %12s %12s %12s\n", "capture", "calls", "bytes", "combined", "bus us", "combined");
+    for(c = 0; c < sizeof(captures) / sizeof(*captures); c++) {
+	for(combine = 0; combine < 2; combine++) {
+	    lcd_clear();
+	    bus_us[combine] = bus_free_us();
+	    start_strobes = sim.strobes[0];
+	    for(i = 0; i < iterations; i++)
+		frames = replay(captures[c].calls, combine);
+	    bus_us[combine] = bus_free_us() - bus_us[combine];
+	    bytes[combine] = sim.strobes[0] - start_strobes;
+	    for(row = 0; row < 2; row++)
+		hd44780_sim_line(&sim, 0, row, 16, line[combine][row]);
+	}
+
+	for(calls = 0; captures[c].calls[calls].op != CALL_END; calls++)
+	    ;
+	frames *= iterations;
+	printf("%-24s %10.1f %12.1f %12.1f %12.1f %12.1f%s\n", captures[c].name, (double)(calls * iterations) / frames,
+	       bytes[0] / 2.0 / frames, bytes[1] / 2.0 / frames, (double)bus_us[0] / frames, (double)bus_us[1] / frames,
+	       memcmp(line[0], line[1], sizeof(line[0])) ? "  panels differ" : "");
+	if(memcmp(line[0], line[1], sizeof(line[0])) != 0)
+	    ok = 0;
+    }
+
+    return ok;
+}
+
+/*
+    @brief Function for replaying a captured call sequence
+
+    @return number of frames in the sequence
+*/
+static uint32_t replay(const bench_call_t * calls, uint8_t combine) {
+    uint32_t frames = 0;
+
+    if(combine)
+	lcd_write_combine_on();
+
+    for(; calls->op != CALL_END; calls++) {
+	switch(calls->op) {
+	case CALL_CURSOR:
+	    lcd_set_cursor(calls->col, calls->row);
+	    break;
+
+	case CALL_CHAR:
+	    lcd_write_char((char)calls->col);
+	    break;
+
+	case CALL_STRING:
+	    lcd_write_string((char *)calls->text);
+	    break;
+
+	case CALL_DISPLAY_ON:
+	    lcd_display_on();
+	    break;
+
+	case CALL_LEFT_TO_RIGHT:
+	    lcd_left_to_right();
+	    break;
+
+	default:
+	    if(combine)
+		lcd_flush();
+	    frames++;
+	    break;
+	}
+    }
+
+    if(combine)
+	lcd_write_combine_off();
+    return frames;
+}
+
+/*
+    @brief Function for comparing the jitter of a clock written at the deadline with lcd_present_at()
+*/
+static void report_present(unsigned long frames) {
+    uint32_t * late[3]; // written at the deadline, lcd_present_at() start and on the glass
+    uint32_t deadline;
+    uint64_t offset; // shim clock at time_us() 0
+    unsigned long f;
+    char text[9];
+    uint8_t way;
+
+    for(way = 0; way < 3; way++) {
+	late[way] = malloc(frames * sizeof(**late));
+	if(late[way] == NULL) {
+	    while(way--)
+		free(late[way]);
+	    return;
+	}
+    }
+
+    shim_set_dwt_hook(poll_cost);
+    lcd_set_cursor(4, 0);
+
+    for(f = 0; f < frames; f++) {
+	snprintf(text, sizeof(text), "12:%02lu:%02lu", (f / 60) % 60, f % 60);
+
+	// written the usual way once the second has come, every character goes out
+	deadline = time_us() + 5000;
+	offset = shim_now_us - (deadline - 5000); // the cycle counter may have wrapped since the last frame
+	while((int32_t)(deadline - time_us()) > 0)
+	    ;
+	lcd_set_cursor(4, 0);
+	lcd_write_string(text);
+	late[0][f] = (uint32_t)(sim_last_us - offset - deadline);
+
+	// drawn ahead, only the plan of the cells that changed is sent at the deadline
+	deadline = time_us() + 5000;
+	offset = shim_now_us - (deadline - 5000);
+	text[7] = '0' + (text[7] - '0' + 1) % 10;
+	lcd_write_combine_on();
+	lcd_set_cursor(4, 0);
+	lcd_write_string(text);
+	late[1][f] = (uint32_t)lcd_present_at(deadline);
+	late[2][f] = (uint32_t)(sim_last_us - offset - deadline);
+	lcd_write_combine_off();
+    }
+
+    shim_set_dwt_hook(NULL);
+
+    printf("\n%-28s %10s %10s %10s %10s\n", "presentation, us late", "p50", "p99", "max", "jitter");
+    print_spread("written at the deadline", late[0], frames);
+    print_spread("lcd_present_at, start", late[1], frames);
+    print_spread("lcd_present_at, on glass", late[2], frames);
+
+    for(way = 0; way < 3; way++)
+	free(late[way]);
+}
+
+/*
+    @brief Function for measuring the bus bytes per blink period of every blink mechanism
+
+    @return 1 if the hardware blink of a single cell is still on after the application changed display control
+*/
+static uint8_t report_blink(unsigned long periods) {
+    static const char * const names[4] = {"hardware cursor blink", "display on/off", "swap the CGRAM slot",
+					   "rewrite the cells"};
+    static const uint8_t cells[4] = {1, 5, 2, 9};
+    static const uint8_t glyph = 1;
+    uint32_t start_strobes;
+    unsigned long i;
+    uint8_t ok = 1;
+    uint8_t way;
+
+    printf("\n%-24s %10s %16s\n", "blink mechanism", "cells", "bytes per period");
+    for(way = 0; way < 4; way++) {
+	lcd_clear();
+	if(way == 0) {
+	    lcd_write_string("Alarm 07:30");
+	    lcd_set_attr(6, 0, 1, LCD_ATTR_BLINK);
+	    lcd_cursor_off(); // the application's display control may not end the blink
+	}
+	else if(way == 1) {
+	    lcd_write_string("ALERT");
+	    lcd_set_attr(0, 0, 5, LCD_ATTR_BLINK);
+	}
+	else if(way == 2) {
+	    lcd_create_char(glyph, bench_arrow);
+	    lcd_set_cursor(0, 0);
+	    lcd_write_char(glyph);
+	    lcd_write_string(" Low battery");
+	    lcd_set_cursor(5, 1);
+	    lcd_write_char(glyph);
+	    lcd_set_attr(0, 0, 1, LCD_ATTR_BLINK);
+	    lcd_set_attr(5, 1, 1, LCD_ATTR_BLINK);
+	}
+	else {
+	    lcd_write_string("Backlight");
+	    lcd_set_cursor(0, 1);
+	    lcd_write_string("Menu item");
+	    lcd_set_attr(0, 1, 9, LCD_ATTR_BLINK);
+	}
+
+	start_strobes = sim.strobes[0];
+	for(i = 0; i < 2 * periods; i++)
+	    lcd_attr_tick();
+	printf("%-24s %10u %16.1f\n", names[way], cells[way], (sim.strobes[0] - start_strobes) / 2.0 / periods);
+
+	if(way == 0 && !(sim.control[0] & LCD_BLINKON)) {
+	    printf("  the cursor blink stopped\n");
+	    ok = 0;
+	}
+	bench_attr_done();
+    }
+
+    lcd_clear();
+    return ok;
+}
+
+/*
+    @brief Function for sharing the bus with a sampling ADC, blocking writes and lcd_flush_poll() from a main loop
+
+    @note utilisation is the bus time over the time the windows were open while the frames went out
+
+    @return 1 if no strobe happened in a closed window, no byte was split and every frame ended up on the glass
+*/
+static uint8_t report_windows(unsigned long frames) {
+    static const char * const names[2] = {"blocking writes", "lcd_flush_poll"};
+    lcd_window_stats_t stats;
+    uint64_t start_us;
+    uint64_t open_us;
+    uint64_t latency_us;
+    uint64_t max_latency_us;
+    uint64_t frame_us;
+    unsigned long polls;
+    unsigned long wrong = 0;
+    unsigned long f;
+    char text[2][17];
+    char line[17];
+    uint8_t row;
+    uint8_t way;
+
+    printf("\n%-24s %10s %10s %12s %12s %12s %10s\n", "bus windows", "bytes", "busy us", "utilisation",
+	   "deferred", "mean wait us", "polls");
+    shim_set_pin_hook(adc_pin);
+
+    for(way = 0; way < 2; way++) {
+	lcd_set_bus_window(adc_window);
+	lcd_clear();
+	lcd_get_window_stats(&stats);
+	if(way == 1)
+	    lcd_write_combine_on();
+
+	start_us = shim_now_us;
+	latency_us = 0;
+	max_latency_us = 0;
+	polls = 0;
+	for(f = 0; f < frames; f++) {
+	    snprintf(text[0], sizeof(text[0]), "ch1 %5lu mV    ", (f * 37) % 3300);
+	    snprintf(text[1], sizeof(text[1]), "ch2 %5lu mV    ", (f * 91) % 3300);
+
+	    frame_us = shim_now_us;
+	    for(row = 0; row < 2; row++) {
+		lcd_set_cursor(0, row);
+		lcd_write_string(text[row]);
+	    }
+	    if(way == 1) {
+		while(lcd_flush_poll() != 0) {
+		    polls++;
+		    shim_now_us += LOOP_WORK_US;
+		}
+		polls++;
+	    }
+
+	    frame_us = bus_free_us() - frame_us;
+	    latency_us += frame_us;
+	    if(frame_us > max_latency_us)
+		max_latency_us = frame_us;
+
+	    for(row = 0; row < 2; row++) {
+		hd44780_sim_line(&sim, 0, row, 16, line);
+		if(memcmp(line, text[row], 16) != 0)
+		    wrong++;
+	    }
+	}
+
+	lcd_get_window_stats(&stats);
+	open_us = (bus_free_us() - start_us) * (ADC_PERIOD_US - ADC_SAMPLE_US) / ADC_PERIOD_US;
+	printf("%-24s %10" PRIu32 " %10" PRIu32 " %11.1f%% %12" PRIu32 " %12.1f %10lu\n", names[way], stats.bytes,
+	       stats.busy_us, 100.0 * stats.busy_us / open_us, stats.deferred,
+	       stats.deferred ? (double)stats.deferred_us / stats.deferred : 0.0, polls);
+	printf("  frame on the glass after %.1f us on average, %" PRIu64 " us at most\n", (double)latency_us / frames,
+	       max_latency_us);
+
+	if(way == 1)
+	    lcd_write_combine_off();
+	lcd_set_bus_window(NULL);
+    }
+
+    shim_set_pin_hook(sim_pin);
+    printf("strobes in a closed window or bytes split across windows: %" PRIu32 ", rows left wrong: %lu\n",
+	   adc_violations, wrong);
+    lcd_clear();
+    return adc_violations == 0 && wrong == 0;
+}
+
+/*
+    @brief Function for the bus window of the ADC, a transfer may start if it ends before the next sample
+
+    @note every poll of a closed window costs a microsecond, like polling a timer on the target
+*/
+static uint8_t adc_window(uint32_t duration_us) {
+    const uint64_t phase = shim_now_us % ADC_PERIOD_US;
+
+    if(phase >= ADC_SAMPLE_US && phase + duration_us <= ADC_PERIOD_US)
+	return 1;
+    shim_now_us += 1;
+    return 0;
+}
+
+/*
+    @brief Function for checking every enable edge of the first panel against the ADC windows
+
+    @note both nibbles of a byte have to go out in the open part of the same period
+*/
+static void adc_pin(uint32_t pin_no, uint32_t value, uint64_t now_us) {
+    static uint8_t nibble = 0; // strobes of the current byte seen so far
+    const uint8_t rising = pin_no == PIN_EN && value && !sim_en_level[0];
+
+    if(rising) {
+	if(nibble == 0)
+	    adc_byte_period = now_us / ADC_PERIOD_US;
+	if(now_us % ADC_PERIOD_US < ADC_SAMPLE_US || now_us / ADC_PERIOD_US != adc_byte_period)
+	    adc_violations++;
+	nibble ^= 1;
+    }
+    sim_pin(pin_no, value, now_us);
+}
+
+/*
+    @brief Function for printing the percentiles of how late frames were, jitter is the longest minus the shortest
+*/
+static void print_spread(const char * name, uint32_t * late, unsigned long count) {
+    qsort(late, count, sizeof(*late), compare_late);
+    printf("%-28s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n", name, late[count / 2],
+	   late[count * 99 / 100], late[count - 1], late[count - 1] - late[0]);
+}
+
+static int compare_late(const void * a, const void * b) {
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+    @brief Function for timing the run extraction with ctz scans against comparing every cell
+
+    @return 1 if both found the same runs on every screen
+*/
+static uint8_t report_runs(unsigned long iterations) {
+    static const uint8_t changed[] = {1, 4, 16, 32, LCD_DDRAM_SIZE};
+    static bench_screen_t screens[RUN_SCREENS];
+    volatile uint32_t sink = 0;
+    uint8_t run_ctz[2 * RUN_MAX];
+    uint8_t run_compare[2 * RUN_MAX];
+    uint32_t seed = 7;
+    uint32_t runs; // found on all screens
+    uint32_t raw_runs; // before joining runs that cross a word
+    uint32_t bits;
+    uint32_t filtered;
+    uint64_t start_ns;
+    double ctz_ns;
+    double compare_ns;
+    unsigned long i;
+    uint8_t count;
+    uint8_t ok = 1;
+    uint8_t cell;
+    uint8_t c;
+    size_t n;
+
+    printf("\n%-8s %8s %10s %12s %10s %12s %10s %12s\n", "changed", "runs", "ctz ns", "compare ns", "ctz M4",
+	   "compare M4", "ctz M0+", "compare M0+");
+    for(c = 0; c < sizeof(changed) / sizeof(*changed); c++) {
+	runs = 0;
+	raw_runs = 0;
+	bits = 0;
+
+	for(n = 0; n < RUN_SCREENS; n++) {
+	    for(cell = 0; cell < LCD_DDRAM_SIZE; cell++) {
+		seed = seed * 1103515245 + 12345;
+		screens[n].glass[cell] = 'A' + (seed >> 16) % 26;
+		screens[n].frame[cell] = screens[n].glass[cell];
+	    }
+	    memset(screens[n].dirty, 0, sizeof(screens[n].dirty));
+
+	    // written cells, one in four rewritten with what the glass already shows
+	    for(count = 0; count < changed[c];) {
+		seed = seed * 1103515245 + 12345;
+		cell = (seed >> 16) % LCD_DDRAM_SIZE;
+		if(screens[n].dirty[cell >> 5] & ((uint32_t)1 << (cell & 31)))
+		    continue;
+		screens[n].dirty[cell >> 5] |= (uint32_t)1 << (cell & 31);
+		if((seed >> 30) != 0)
+		    screens[n].frame[cell] = 'a' + (seed >> 8) % 26;
+		count++;
+	    }
+
+	    count = runs_ctz(&screens[n], run_ctz);
+	    if(count != runs_compare(&screens[n], run_compare) || memcmp(run_ctz, run_compare, 2 * count) != 0)
+		ok = 0;
+	    runs += count;
+	    bits += changed[c];
+	    for(i = 0; i < LCD_DIRTY_WORDS; i++) {
+		filtered = 0;
+		for(cell = 0; cell < 32 && (i << 5) + cell < LCD_DDRAM_SIZE; cell++)
+		    if(screens[n].frame[(i << 5) + cell] != screens[n].glass[(i << 5) + cell])
+			filtered |= (uint32_t)1 << cell;
+		raw_runs += __builtin_popcount(filtered & ~(filtered << 1));
+	    }
+	}
+
+	start_ns = cpu_ns();
+	for(i = 0; i < iterations; i++)
+	    for(n = 0; n < RUN_SCREENS; n++)
+		sink += runs_ctz(&screens[n], run_ctz);
+	ctz_ns = (double)(cpu_ns() - start_ns) / iterations / RUN_SCREENS;
+
+	start_ns = cpu_ns();
+	for(i = 0; i < iterations; i++)
+	    for(n = 0; n < RUN_SCREENS; n++)
+		sink += runs_compare(&screens[n], run_compare);
+	compare_ns = (double)(cpu_ns() - start_ns) / iterations / RUN_SCREENS;
+
+	printf("%-8u %8.1f %10.1f %12.1f %10.0f %12.0f %10.0f %12.0f\n", changed[c], (double)runs / RUN_SCREENS, ctz_ns,
+	       compare_ns, (double)(LCD_DIRTY_WORDS * M4_WORD * RUN_SCREENS + bits * M4_BIT + raw_runs * M4_RUN) / RUN_SCREENS,
+	       (double)(LCD_DDRAM_SIZE * M4_CELL * RUN_SCREENS + runs * M4_CELL_RUN) / RUN_SCREENS,
+	       (double)(LCD_DIRTY_WORDS * M0_WORD * RUN_SCREENS + bits * M0_BIT + raw_runs * M0_RUN) / RUN_SCREENS,
+	       (double)(LCD_DDRAM_SIZE * M0_CELL * RUN_SCREENS + runs * M0_CELL_RUN) / RUN_SCREENS);
+    }
+
+    (void)sink;
+    if(!ok)
+	printf("run extraction: the two ways found different runs\n");
+    return ok;
+}
+
+/*
+    @brief Function for finding the runs of changed cells the way lcd_prepare_flush() does
+
+    @note only the set bits of the dirty bitmap are visited, runs crossing a word are joined
+
+    @return number of runs, start and end of each in run
+*/
+static uint8_t runs_ctz(const bench_screen_t * screen, uint8_t * run) {
+    uint32_t bits;
+    uint32_t bit;
+    uint8_t runs = 0;
+    uint8_t word;
+    uint8_t start;
+    uint8_t end;
+    uint8_t cell;
+
+    for(word = 0; word < LCD_DIRTY_WORDS; word++) {
+	bits = screen->dirty[word];
+
+	for(bit = bits; bit != 0; bit &= bit - 1) {
+	    cell = (word << 5) + __builtin_ctz(bit);
+	    if(screen->frame[cell] == screen->glass[cell])
+		bits &= ~((uint32_t)1 << (cell & 31));
+	}
+
+	while(bits != 0) {
+	    start = __builtin_ctz(bits);
+	    bit = ~bits & (UINT32_MAX << start);
+	    end = (bit == 0) ? 32 : __builtin_ctz(bit);
+	    bits = (end == 32) ? 0 : (bits & (UINT32_MAX << end));
+
+	    if(runs != 0 && run[2 * runs - 1] == (word << 5) + start) {
+		run[2 * runs - 1] = (word << 5) + end;
+	    }
+	    else {
+		run[2 * runs] = (word << 5) + start;
+		run[2 * runs + 1] = (word << 5) + end;
+		runs++;
+	    }
+	}
+    }
+
+    return runs;
+}
+
+/*
+    @brief Function for finding the runs of changed cells by comparing every cell with the glass
+
+    @return number of runs, start and end of each in run
+*/
+static uint8_t runs_compare(const bench_screen_t * screen, uint8_t * run) {
+    uint8_t runs = 0;
+    uint8_t cell;
+
+    for(cell = 0; cell < LCD_DDRAM_SIZE; cell++) {
+	if(screen->frame[cell] == screen->glass[cell])
+	    continue;
+
+	if(runs != 0 && run[2 * runs - 1] == cell) {
+	    run[2 * runs - 1] = cell + 1;
+	}
+	else {
+	    run[2 * runs] = cell;
+	    run[2 * runs + 1] = cell + 1;
+	    runs++;
+	}
+    }
+
+    return runs;
+}
+
+/*
+    @brief Function for packing a bench asset the way tools/lcd_asset_packer.c does it
+
+    @param[out] plain Size of the same asset stored plainly, 9 bytes a glyph and every line as col, row and a null
+		      terminated string
+
+    @return size of the packed asset
+*/
+static uint16_t pack_asset(const bench_asset_t * bench, uint8_t * asset, uint16_t size, uint16_t * plain) {
+    uint16_t length = 0;
+    uint8_t slot;
+    uint8_t row;
+
+    *plain = 0;
+    for(slot = 0; slot < bench->glyphs; slot++) {
+	length += lcd_asset_pack_glyph(bench->first_slot + slot, bench->glyph[slot], &asset[length], size - length);
+	*plain += 9;
+    }
+    for(row = 0; row < 2; row++) {
+	length += lcd_asset_pack_cursor(0, row, &asset[length], size - length);
+	length += lcd_asset_pack_text(bench->line[row], 16, &asset[length], size - length);
+	*plain += 2 + 16 + 1;
+    }
+    length += lcd_asset_pack_token(LCD_ASSET_END, &asset[length], size - length);
+
+    return length;
+}
+
+/*
+    @brief Function for measuring the packed size of a set of screens and glyph sets, and comparing the asset decoder
+	   with the bus
+
+    @note every asset is played and flushed and the panel has to show it, then the menu is played into the frame
+	  buffer with write combining on, so only decoding is timed
+
+    @return 1 if the panel showed every asset
+*/
+static uint8_t report_asset(unsigned long iterations) {
+    uint8_t asset[160];
+    uint16_t length;
+    uint16_t plain;
+    uint32_t total_plain[2] = {0, 0}; // text screens, screens with glyph sets
+    uint32_t total_packed[2] = {0, 0};
+    uint64_t start_ns;
+    unsigned long i;
+    double rate;
+    char line[17];
+    uint8_t ok = 1;
+    uint8_t a;
+    uint8_t row;
+
+    printf("\n%-24s %8s %8s %8s %8s\n", "asset", "glyphs", "plain", "packed", "ratio");
+    for(a = 0; a < sizeof(bench_assets) / sizeof(*bench_assets); a++) {
+	length = pack_asset(&bench_assets[a], asset, sizeof(asset), &plain);
+	total_plain[bench_assets[a].glyphs != 0] += plain;
+	total_packed[bench_assets[a].glyphs != 0] += length;
+	printf("%-24s %8u %8u %8u %8.2f\n", bench_assets[a].name, bench_assets[a].glyphs, plain, length,
+	       (double)plain / length);
+
+	lcd_write_combine_on();
+	lcd_asset_play(asset);
+	lcd_flush();
+	lcd_write_combine_off();
+	for(row = 0; row < 2; row++) {
+	    hd44780_sim_line(&sim, 0, row, 16, line);
+	    if(memcmp(line, bench_assets[a].line[row], 16) != 0) {
+		printf("  the panel doesn't show row %u\n", row);
+		ok = 0;
+	    }
+	}
+    }
+    printf("%-24s %8s %8" PRIu32 " %8" PRIu32 " %8.2f\n", "text screens", "", total_plain[0], total_packed[0],
+	   (double)total_plain[0] / total_packed[0]);
+    printf("%-24s %8s %8" PRIu32 " %8" PRIu32 " %8.2f\n", "screens with glyphs", "", total_plain[1], total_packed[1],
+	   (double)total_plain[1] / total_packed[1]);
+    printf("%-24s %8s %8" PRIu32 " %8" PRIu32 " %8.2f\n", "all", "", total_plain[0] + total_plain[1],
+	   total_packed[0] + total_packed[1],
+	   (double)(total_plain[0] + total_plain[1]) / (total_packed[0] + total_packed[1]));
+
+    pack_asset(&bench_assets[0], asset, sizeof(asset), &plain);
+    lcd_write_combine_on();
+    lcd_asset_play(asset); // uploads the glyph, later plays find it in CGRAM already
+
+    start_ns = cpu_ns();
+    for(i = 0; i < iterations; i++)
+	lcd_asset_play(asset);
+    rate = 32.0 * iterations * 1e9 / (double)(cpu_ns() - start_ns);
+
+    lcd_write_combine_off();
+    lcd_clear();
+
+    printf("decode: %.0f ROM codes/s into the frame buffer, the gpio bus takes %.0f/s, %.0fx the bus rate\n", rate,
+	   1e6 / LCD_BYTE_US, rate * LCD_BYTE_US / 1e6);
+    return ok;
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function for feeding every enable strobe of the bench wiring into the simulator
+*/
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us) {
+    static const uint32_t en[SIM_PANELS] = {PIN_EN, PIN_EN2};
+    uint8_t panel;
+    uint8_t rs;
+    uint8_t nibble;
+
+    for(panel = 0; panel < SIM_PANELS; panel++) {
+	if(pin_no != en[panel])
+	    continue;
+
+	// the controller latches when enable falls
+	if(sim_en_level[panel] && !value) {
+	    rs = shim_pin_level[PIN_RS];
+	    nibble = shim_pin_level[PIN_D4] | (shim_pin_level[PIN_D5] << 1) | (shim_pin_level[PIN_D6] << 2)
+		     | (shim_pin_level[PIN_D7] << 3);
+	    hd44780_sim_strobe(&sim, panel, 1, &rs, &nibble, now_us);
+	    if(panel == 0)
+		sim_last_us = now_us;
+	}
+	sim_en_level[panel] = value;
+    }
+}
+
+/*
+    @brief Function for a poll of the cycle counter, a microsecond and now and then an interrupt
+*/
+static void poll_cost(void) {
+    poll_seed = poll_seed * 1103515245 + 12345;
+    shim_now_us += 1;
+    if((poll_seed >> 16) % 200 == 0)
+	shim_now_us += 20 + (poll_seed >> 8) % 100;
+}
+
+/*
+    @brief Function for the time the bus is free again, once the clock and every controller are done
+*/
+static uint64_t bus_free_us(void) {
+    uint64_t free_us = shim_now_us;
+    uint8_t panel;
+
+    for(panel = 0; panel < SIM_PANELS; panel++)
+	if(sim.busy_until[panel] > free_us)
+	    free_us = sim.busy_until[panel];
+    return free_us;
+}
@@ -0,0 +1,353 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_i2cdev.c
+
+  @Summary
+    Linux i2c-dev transport for a PCF8574 backpack
+
+  @Description
+    Implements the transport with I2C_RDWR, the expander bytes of a batch are
+    collected in one buffer and sent with as few ioctl calls and messages as
+    the adapter allows
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_i2cdev.h"
+#include "lcd_16x2.h"
+#include "nrf_delay.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stddef.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define PAD_MAX 16 // padding bytes after an LCD byte, enough for 3.4MHz
+
+// a whole flush plan, up to five expander bytes and the padding per LCD byte
+#define FRAME_SIZE ((LCD_PLAN_SIZE + 1) * (5 + PAD_MAX))
+
+static int i2c_fd = -1;
+static lcd_i2cdev_config_t i2c_config;
+static i2cdev_ioctl_fn i2c_ioctl = NULL;
+static uint8_t grouping = LCD_I2CDEV_PER_FRAME;
+static uint8_t pad = 0; // copies of the last expander byte that give the LCD time to execute
+static lcd_i2cdev_stats_t stats;
+
+static uint8_t frame[FRAME_SIZE]; // expander bytes not sent yet
+static uint16_t frame_length = 0;
+static uint8_t level = PCF8574_BACKLIGHT; // last expander byte, what the pins show once the frame is out
+static uint8_t batch_open = 0; // the driver is sending a flush plan
+static uint8_t in_batch = 0; // bytes are held back until the batch is closed
+static uint8_t batch_used = 0; // the open batch carried something
+
+static void i2cdev_send(uint8_t value, uint8_t mode);
+static void i2cdev_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode);
+static void i2cdev_batch(uint8_t open);
+static void emit_byte(uint8_t value, uint8_t rs);
+static void emit_wake(uint8_t nibble);
+static void frame_put(uint8_t bits);
+static void frame_send(void);
+static void i2c_transfer(uint8_t * data, uint16_t length);
+static int i2c_call(unsigned long request, void * arg);
+
+static lcd_transport_t i2cdev_transport = {
+    i2cdev_send,
+    i2cdev_write_buffer,
+    90, // 4 bytes at 400kHz, set from the bus clock at init
+    i2cdev_batch
+};
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Open the adapter and initialize the LCD behind the expander
+
+    @note the panel is woken up in 4 bit mode by the transport, then the full initialization runs through
+	  lcd_init_transport(), the function sets it sends are turned into their 4 bit form
+
+    @param[in] path Adapter, e.g. /dev/i2c-1
+
+    @param[in] config Settings, copied
+
+    @return 0 if the adapter could not be opened or has no plain I2C transfers
+*/
+uint8_t lcd_i2cdev_init(const char * path, const lcd_i2cdev_config_t * config) {
+    unsigned long funcs = 0;
+    uint32_t gap;
+
+    i2c_config = *config;
+    if(i2c_config.max_len == 0 || i2c_config.max_len > LCD_I2CDEV_MAX_LEN)
+	i2c_config.max_len = LCD_I2CDEV_MAX_LEN;
+    if(i2c_config.max_msgs == 0 || i2c_config.max_msgs > I2C_RDWR_IOCTL_MAX_MSGS)
+	i2c_config.max_msgs = I2C_RDWR_IOCTL_MAX_MSGS;
+
+    i2c_fd = open(path, O_RDWR);
+    if(i2c_fd < 0)
+	return 0;
+
+    // SMBus only adapters can't take a run of bytes in one message
+    if(i2c_call(I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)
+       || i2c_call(I2C_SLAVE, (void *)(uintptr_t)i2c_config.address) < 0) {
+	lcd_i2cdev_close();
+	return 0;
+    }
+
+    // the next enable edge is two bytes away, pad to cover the instruction time on fast buses
+    gap = (LCD_I2CDEV_EXEC_US * i2c_config.bus_hz + 8999999) / 9000000;
+    pad = (gap > 2) ? gap - 2 : 0;
+    if(pad > PAD_MAX)
+	pad = PAD_MAX;
+    i2cdev_transport.byte_us = ((4 + pad) * 9000000 + i2c_config.bus_hz - 1) / i2c_config.bus_hz;
+
+    frame_length = 0;
+    in_batch = 0;
+
+    // park with enable low and the backlight on
+    frame_put(PCF8574_BACKLIGHT);
+    frame_send();
+    nrf_delay_ms(LCD_POWER_UP_MS);
+
+    // the panel powers up in 8 bit mode with only D4-D7 wired, wake it up and switch with single nibbles
+    emit_wake(0x03);
+    nrf_delay_ms(LCD_WAKE_MS);
+    emit_wake(0x03);
+    nrf_delay_us(LCD_WAKE_LAST_US);
+    emit_wake(0x03);
+    nrf_delay_us(LCD_WAKE_LAST_US);
+    emit_wake(0x02);
+    nrf_delay_us(LCD_WAKE_LAST_US);
+
+    lcd_init_transport(&i2cdev_transport);
+    return 1;
+}
+
+/*
+    @brief Close the adapter
+*/
+void lcd_i2cdev_close(void) {
+    if(i2c_fd >= 0)
+	close(i2c_fd);
+    i2c_fd = -1;
+}
+
+/*
+    @brief Set how the expander bytes are grouped into syscalls
+
+    @param[in] mode LCD_I2CDEV_PER_BYTE, LCD_I2CDEV_PER_CALL or LCD_I2CDEV_PER_FRAME (the default)
+*/
+void lcd_i2cdev_grouping(uint8_t mode) {
+    frame_send();
+    grouping = mode;
+}
+
+/*
+    @brief Replace the ioctl used for every transfer
+
+    @note with a stand-in the single byte writes of LCD_I2CDEV_PER_BYTE also go through it, as I2C_RDWR with one
+	  message
+
+    @param[in] fn Stand-in, NULL for ioctl()
+*/
+void lcd_i2cdev_set_ioctl(i2cdev_ioctl_fn fn) {
+    i2c_ioctl = fn;
+}
+
+/*
+    @brief Read the traffic counters
+
+    @param[out] counters Counters
+
+    @param[in] reset 1 to start counting again from zero
+*/
+void lcd_i2cdev_stats(lcd_i2cdev_stats_t * counters, uint8_t reset) {
+    *counters = stats;
+    if(reset) {
+	stats.frames = 0;
+	stats.syscalls = 0;
+	stats.transactions = 0;
+	stats.bytes = 0;
+	stats.errors = 0;
+    }
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]***************************************/
+
+/*
+    @brief Function for sending a single byte through the expander
+
+    @note the driver wakes the panel up with 8 bit function sets, the panel is already in 4 bit mode by then
+*/
+static void i2cdev_send(uint8_t value, uint8_t mode) {
+    if(!mode && (value & 0xE0) == LCD_FUNCTIONSET)
+	value &= ~LCD_8BITMODE;
+
+    emit_byte(value, mode ? PCF8574_RS : 0);
+    if(!in_batch)
+	frame_send();
+}
+
+/*
+    @brief Function for sending a burst of bytes to one LCD register
+*/
+static void i2cdev_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode) {
+    uint16_t i;
+
+    for(i = 0; i < length; i++)
+	emit_byte(data[i], mode ? PCF8574_RS : 0);
+    if(!in_batch)
+	frame_send();
+}
+
+/*
+    @brief Function for holding the bytes of a flush plan back and sending them as one frame
+*/
+static void i2cdev_batch(uint8_t open) {
+    if(open) {
+	batch_open = 1;
+	in_batch = (grouping == LCD_I2CDEV_PER_FRAME);
+	batch_used = 0;
+	return;
+    }
+
+    frame_send();
+    batch_open = 0;
+    in_batch = 0;
+    if(batch_used)
+	stats.frames++;
+}
+
+/*
+    @brief Function for encoding an LCD byte as expander bytes
+
+    @note register select gets a byte of its own only when it changes, otherwise it already settled with the last
+	  byte, then every nibble is enable high and enable low, and the LCD gets its execution time from the padding
+*/
+static void emit_byte(uint8_t value, uint8_t rs) {
+    const uint8_t high = (value & 0xF0) | rs | PCF8574_BACKLIGHT;
+    const uint8_t low = (uint8_t)(value << 4) | rs | PCF8574_BACKLIGHT;
+    uint8_t i;
+
+    if((level & PCF8574_RS) != rs)
+	frame_put(level ^ PCF8574_RS);
+
+    frame_put(high | PCF8574_EN);
+    frame_put(high);
+    frame_put(low | PCF8574_EN);
+    frame_put(low);
+    for(i = 0; i < pad; i++)
+	frame_put(low);
+}
+
+/*
+    @brief Function for strobing a single nibble to the instruction register during the wake up
+*/
+static void emit_wake(uint8_t nibble) {
+    const uint8_t bits = (uint8_t)(nibble << 4) | PCF8574_BACKLIGHT;
+
+    frame_put(bits | PCF8574_EN);
+    frame_put(bits);
+    frame_send();
+}
+
+/*
+    @brief Function for appending an expander byte to the frame
+
+    @note a full frame is sent early rather than dropping bytes
+*/
+static void frame_put(uint8_t bits) {
+    if(frame_length == FRAME_SIZE)
+	frame_send();
+    frame[frame_length++] = bits;
+    level = bits;
+    batch_used |= batch_open;
+}
+
+/*
+    @brief Function for sending the frame with the grouping in use
+*/
+static void frame_send(void) {
+    uint16_t i;
+
+    if(grouping == LCD_I2CDEV_PER_BYTE) {
+	for(i = 0; i < frame_length; i++)
+	    i2c_transfer(&frame[i], 1);
+    }
+    else if(frame_length != 0) {
+	i2c_transfer(frame, frame_length);
+    }
+    frame_length = 0;
+}
+
+/*
+    @brief Function for sending expander bytes with as few ioctl calls and messages as the adapter allows
+
+    @note i2c-dev rejects more than I2C_RDWR_IOCTL_MAX_MSGS messages or a message over LCD_I2CDEV_MAX_LEN bytes, an
+	  adapter may reject less with EOPNOTSUPP, then the limits are lowered for good, first to one message per
+	  call, then halving the message length
+*/
+static void i2c_transfer(uint8_t * data, uint16_t length) {
+    struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+    struct i2c_rdwr_ioctl_data rdwr;
+    uint16_t taken;
+    uint16_t chunk;
+    uint8_t n;
+
+    if(grouping == LCD_I2CDEV_PER_BYTE && i2c_ioctl == NULL) {
+	stats.syscalls++;
+	if(write(i2c_fd, data, length) != (ssize_t)length) {
+	    stats.errors++;
+	    return;
+	}
+	stats.transactions++;
+	stats.bytes += length;
+	return;
+    }
+
+    while(length > 0) {
+	taken = 0;
+	for(n = 0; n < i2c_config.max_msgs && taken < length; n++) {
+	    chunk = (length - taken > i2c_config.max_len) ? i2c_config.max_len : length - taken;
+	    msgs[n].addr = i2c_config.address;
+	    msgs[n].flags = 0;
+	    msgs[n].len = chunk;
+	    msgs[n].buf = data + taken;
+	    taken += chunk;
+	}
+	rdwr.msgs = msgs;
+	rdwr.nmsgs = n;
+
+	stats.syscalls++;
+	if(i2c_call(I2C_RDWR, &rdwr) < 0) {
+	    stats.errors++;
+	    if(errno == EOPNOTSUPP && i2c_config.max_msgs > 1) {
+		i2c_config.max_msgs = 1;
+		continue;
+	    }
+	    if(errno == EOPNOTSUPP && i2c_config.max_len > 1) {
+		i2c_config.max_len /= 2;
+		continue;
+	    }
+	    return; // the rest of the frame is dropped
+	}
+
+	stats.transactions += n;
+	stats.bytes += taken;
+	data += taken;
+	length -= taken;
+    }
+}
+
+/*
+    @brief Function for an ioctl on the adapter, through the stand-in if there is one
+*/
+static int i2c_call(unsigned long request, void * arg) {
+    if(i2c_ioctl != NULL)
+	return i2c_ioctl(i2c_fd, request, arg);
+    return ioctl(i2c_fd, request, arg);
+}
@@ -0,0 +1,115 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_i2cdev.h
+
+  @Summary
+    Linux i2c-dev transport for a PCF8574 backpack
+
+  @Description
+    Drives the common PCF8574 backpack from a Linux board through
+    /dev/i2c-N. The expander only moves a nibble, so every LCD byte becomes
+    four or five expander bytes, and a write() per byte or per call spends
+    far more time in syscalls and bus address phases than on the data. The
+    transport holds back everything the driver sends while it plays a flush
+    plan and hands the whole frame to the kernel as one I2C_RDWR ioctl,
+    split into several messages only where the adapter's limits require it.
+
+    The ioctl can be replaced, e.g. by a stand-in that decodes the expander
+    bytes into the HD44780 simulator instead of talking to an adapter.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_I2CDEV_H
+#define LCD_I2CDEV_H
+
+// PCF8574 pins on the usual backpack, D4-D7 on P4-P7
+#define PCF8574_RS 0x01
+#define PCF8574_RW 0x02
+#define PCF8574_EN 0x04
+#define PCF8574_BACKLIGHT 0x08
+
+#define LCD_I2CDEV_MAX_LEN 8192 // longest message i2c-dev accepts
+#define LCD_I2CDEV_EXEC_US 37 // instruction time the bus has to cover between two bytes
+
+// how the expander bytes are grouped into syscalls
+#define LCD_I2CDEV_PER_BYTE 0 // one write() per expander byte, like most backpack libraries
+#define LCD_I2CDEV_PER_CALL 1 // one ioctl per call from the driver
+#define LCD_I2CDEV_PER_FRAME 2 // one ioctl per flush plan
+
+/*
+    @brief Stand-in for ioctl(), same arguments and return value
+*/
+typedef int (*i2cdev_ioctl_fn)(int fd, unsigned long request, void * arg);
+
+/*
+    @brief Adapter and expander settings
+*/
+typedef struct {
+    uint8_t address; // 7 bit address of the expander, usually 0x27 or 0x3F
+    uint32_t bus_hz; // bus clock, sets the padding between bytes and the byte time given to the driver
+    uint16_t max_len; // longest message the adapter takes, 0 for LCD_I2CDEV_MAX_LEN
+    uint8_t max_msgs; // messages per ioctl, 0 for I2C_RDWR_IOCTL_MAX_MSGS
+} lcd_i2cdev_config_t;
+
+/*
+    @brief Counters of the traffic since the last reset
+*/
+typedef struct {
+    uint64_t frames; // batches sent
+    uint64_t syscalls; // ioctl and write calls, failed ones included
+    uint64_t transactions; // messages on the bus, each with its own address phase
+    uint64_t bytes; // expander bytes
+    uint64_t errors; // failed calls
+} lcd_i2cdev_stats_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Open the adapter and initialize the LCD behind the expander
+
+    @note the panel is woken up in 4 bit mode by the transport, then the full initialization runs through
+	  lcd_init_transport(), the function sets it sends are turned into their 4 bit form
+
+    @param[in] path Adapter, e.g. /dev/i2c-1
+
+    @param[in] config Settings, copied
+
+    @return 0 if the adapter could not be opened or has no plain I2C transfers
+*/
+uint8_t lcd_i2cdev_init(const char * path, const lcd_i2cdev_config_t * config);
+
+/*
+    @brief Close the adapter
+*/
+void lcd_i2cdev_close(void);
+
+/*
+    @brief Set how the expander bytes are grouped into syscalls
+
+    @param[in] mode LCD_I2CDEV_PER_BYTE, LCD_I2CDEV_PER_CALL or LCD_I2CDEV_PER_FRAME (the default)
+*/
+void lcd_i2cdev_grouping(uint8_t mode);
+
+/*
+    @brief Replace the ioctl used for every transfer
+
+    @note with a stand-in the single byte writes of LCD_I2CDEV_PER_BYTE also go through it, as I2C_RDWR with one
+	  message
+
+    @param[in] fn Stand-in, NULL for ioctl()
+*/
+void lcd_i2cdev_set_ioctl(i2cdev_ioctl_fn fn);
+
+/*
+    @brief Read the traffic counters
+
+    @param[out] counters Counters
+
+    @param[in] reset 1 to start counting again from zero
+*/
+void lcd_i2cdev_stats(lcd_i2cdev_stats_t * counters, uint8_t reset);
+
+#endif
@@ -0,0 +1,245 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_i2cdev_demo.c
+
+  @Summary
+    Syscalls and bus transactions per frame of the i2c-dev transport
+
+  @Description
+    Initializes the LCD behind a PCF8574 through lcd_i2cdev.c and sends the
+    same frames with each grouping of expander bytes into syscalls, then
+    prints the syscalls, messages and bytes per frame and the bus time of a
+    frame. Given /dev/i2c-N it drives a real backpack. Otherwise the ioctl is
+    replaced by a stand-in adapter that decodes every expander byte into the
+    HD44780 simulator on the virtual clock of the host shim, checks what the
+    panel shows and counts strobes that came while it was busy. -l and -m
+    give the stand-in a message length and count limit, like adapter quirks.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_i2cdev_demo lcd_i2cdev_demo.c lcd_i2cdev.c hd44780_sim.c nrf_shim.c ../src/lcd_16x2.c
+    and on the board, where the delays have to be real, with:
+      cc -O2 -DI2CDEV_BOARD -I. -I../src -o lcd_i2cdev_demo lcd_i2cdev_demo.c lcd_i2cdev.c lcd_mmio.c hd44780_sim.c \
+        ../src/lcd_16x2.c -lpthread
+
+    Usage:
+      lcd_i2cdev_demo [-a address] [-k bus hz] [-l max len] [-m max msgs] [-f frames] [/dev/i2c-1]
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_16x2.h"
+#include "lcd_i2cdev.h"
+#include "hd44780_sim.h"
+#ifndef I2CDEV_BOARD
+#include "nrf_shim.h"
+#endif
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static hd44780_sim_t sim;
+static uint32_t bus_hz = 400000;
+static uint32_t adapter_len = LCD_I2CDEV_MAX_LEN; // limits of the stand-in adapter
+static uint32_t adapter_msgs = I2C_RDWR_IOCTL_MAX_MSGS;
+#ifndef I2CDEV_BOARD
+static uint8_t pins = PCF8574_BACKLIGHT; // expander outputs
+static uint64_t bus_ns = 0; // bus time not yet added to the virtual clock
+#endif
+
+#ifndef I2CDEV_BOARD
+static int adapter_ioctl(int fd, unsigned long request, void * arg);
+#endif
+static uint64_t clock_us(void);
+static void draw(uint32_t frame, char text[2][17]);
+
+int main(int argc, char * argv[]) {
+    static const char * const names[3] = {"per byte", "per call", "per frame"};
+    lcd_i2cdev_config_t config = {0x27, 0, 0, 0};
+    lcd_i2cdev_stats_t stats;
+    const char * device = "/dev/null";
+    uint32_t frames = 100;
+    uint32_t frame;
+    uint64_t start_us;
+    uint8_t grouping;
+    uint8_t fake;
+    uint8_t ok = 1;
+    char text[2][17];
+    char line[17];
+    int opt;
+
+    while((opt = getopt(argc, argv, "a:k:l:m:f:")) != -1) {
+	switch(opt) {
+	case 'a': config.address = strtoul(optarg, NULL, 0); break;
+	case 'k': bus_hz = strtoul(optarg, NULL, 0); break;
+	case 'l': adapter_len = strtoul(optarg, NULL, 0); break;
+	case 'm': adapter_msgs = strtoul(optarg, NULL, 0); break;
+	case 'f': frames = strtoul(optarg, NULL, 0); break;
+	default:
+	    fprintf(stderr, "usage: %s [-a address] [-k bus hz] [-l max len] [-m max msgs] [-f frames] [/dev/i2c-1]\n",
+		    argv[0]);
+	    return 1;
+	}
+    }
+#ifdef I2CDEV_BOARD
+    fake = 0;
+#else
+    fake = optind >= argc;
+#endif
+    if(optind < argc)
+	device = argv[optind];
+    config.bus_hz = bus_hz;
+
+    if(fake) {
+	if(!hd44780_sim_init(&sim, 1)) {
+	    fprintf(stderr, "out of memory\n");
+	    return 1;
+	}
+#ifndef I2CDEV_BOARD
+	lcd_i2cdev_set_ioctl(adapter_ioctl);
+#endif
+    }
+
+    if(!lcd_i2cdev_init(device, &config)) {
+	fprintf(stderr, "%s: cannot open or no I2C_FUNC_I2C\n", device);
+	return 1;
+    }
+    lcd_write_combine_on();
+
+    printf("| grouping | syscalls/frame | messages/frame | bytes/frame | us/frame |\n");
+    printf("|---|---|---|---|---|\n");
+
+    for(grouping = LCD_I2CDEV_PER_BYTE; grouping <= LCD_I2CDEV_PER_FRAME; grouping++) {
+	lcd_i2cdev_grouping(grouping);
+	lcd_i2cdev_stats(&stats, 1);
+	start_us = clock_us();
+
+	for(frame = 0; frame < frames; frame++)
+	    draw(frame, text);
+
+	lcd_i2cdev_stats(&stats, 0);
+	if(stats.frames == 0)
+	    stats.frames = 1;
+	printf("| %s | %.1f | %.1f | %.1f | %.0f |\n", names[grouping], (double)stats.syscalls / stats.frames,
+	       (double)stats.transactions / stats.frames, (double)stats.bytes / stats.frames,
+	       (double)(clock_us() - start_us) / stats.frames);
+	if(stats.errors != 0)
+	    printf("  %" PRIu64 " failed calls, the limits were lowered\n", stats.errors);
+    }
+
+    lcd_i2cdev_close();
+
+    if(fake) {
+	hd44780_sim_line(&sim, 0, 0, 16, line);
+	ok &= strcmp(line, text[0]) == 0;
+	printf("row 0: \"%s\"\n", line);
+	hd44780_sim_line(&sim, 0, 1, 16, line);
+	ok &= strcmp(line, text[1]) == 0;
+	printf("row 1: \"%s\"\n", line);
+	printf("strobes %" PRIu32 ", while busy %" PRIu32 "\n", sim.strobes[0], sim.busy_strobes[0]);
+	ok &= sim.busy_strobes[0] == 0;
+	hd44780_sim_free(&sim);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/*
+    @brief Function for drawing one frame, a counter and a bar that both change every frame
+*/
+static void draw(uint32_t frame, char text[2][17]) {
+    uint8_t i;
+
+    snprintf(text[0], 17, "frame %-10" PRIu32, frame);
+    for(i = 0; i < 16; i++)
+	text[1][i] = (i <= frame % 17 && frame % 17 != 0) ? '#' : '.';
+    text[1][16] = '\0';
+
+    lcd_set_cursor(0, 0);
+    lcd_write_string(text[0]);
+    lcd_set_cursor(0, 1);
+    lcd_write_string(text[1]);
+    lcd_flush();
+}
+
+/*
+    @brief Function for reading the virtual clock, or the wall clock on a board
+*/
+static uint64_t clock_us(void) {
+#ifdef I2CDEV_BOARD
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return shim_now_us;
+#endif
+}
+
+#ifndef I2CDEV_BOARD
+/*
+    @brief Function standing in for an adapter, decodes the expander bytes into the simulator
+
+    @note every message costs a start and an address byte and every data byte 9 clocks, the virtual clock moves on
+	  by the bus time of the call, and a panel strobe is made on every falling edge of enable at the time of the
+	  byte that dropped it
+*/
+static int adapter_ioctl(int fd, unsigned long request, void * arg) {
+    const struct i2c_rdwr_ioctl_data * rdwr = arg;
+    uint8_t rs;
+    uint8_t nibble;
+    uint32_t m;
+    uint32_t i;
+    uint8_t bits;
+
+    (void)fd;
+
+    if(request == I2C_FUNCS) {
+	*(unsigned long *)arg = I2C_FUNC_I2C;
+	return 0;
+    }
+    if(request == I2C_SLAVE)
+	return 0;
+    if(request != I2C_RDWR) {
+	errno = ENOTTY;
+	return -1;
+    }
+
+    if(rdwr->nmsgs > adapter_msgs) {
+	errno = EOPNOTSUPP;
+	return -1;
+    }
+    for(m = 0; m < rdwr->nmsgs; m++) {
+	if(rdwr->msgs[m].len > adapter_len) {
+	    errno = EOPNOTSUPP;
+	    return -1;
+	}
+    }
+
+    for(m = 0; m < rdwr->nmsgs; m++) {
+	bus_ns += 10 * 1000000000ull / bus_hz; // start and address
+	for(i = 0; i < rdwr->msgs[m].len; i++) {
+	    bus_ns += 9 * 1000000000ull / bus_hz;
+	    bits = rdwr->msgs[m].buf[i];
+	    if((pins & PCF8574_EN) && !(bits & PCF8574_EN)) {
+		rs = (bits & PCF8574_RS) != 0;
+		nibble = bits >> 4;
+		hd44780_sim_strobe(&sim, 0, 1, &rs, &nibble, shim_now_us + bus_ns / 1000);
+	    }
+	    pins = bits;
+	}
+	bus_ns += 1000000000ull / bus_hz; // stop
+    }
+
+    shim_now_us += bus_ns / 1000;
+    bus_ns %= 1000;
+    return (int)rdwr->nmsgs;
+}
+#endif
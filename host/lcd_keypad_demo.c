@@ -0,0 +1,275 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_keypad_demo.c
+
+  @Summary
+    Keypad scan rate and its cost to the LCD on the host
+
+  @Description
+    Runs lcd_keypad.c and the driver against the host shim, with a 4x4 key
+    matrix behind the read hook and the pin writes fed into the HD44780
+    simulator. Keys are pressed for 20ms at random times while the
+    application draws text, clears and redraws, or leaves the LCD idle and
+    sleeps until lcd_keypad_poll() says the next scan is due. For every
+    workload it prints the latency from a key going down to the scan that
+    debounces it, the longest gap between scans, the scans done inside the
+    long waits of the LCD and the LCD throughput lost to scanning, measured
+    against the same workload without the keypad. Fails if a press is lost,
+    a key takes longer than two intervals and a byte to be seen, the panel
+    shows the wrong text or a strobe arrives while the controller is busy.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_keypad_demo lcd_keypad_demo.c hd44780_sim.c nrf_shim.c ../src/lcd_keypad.c \
+        ../src/lcd_16x2.c
+
+    Usage:
+      lcd_keypad_demo [ms per workload] [scan interval us]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "lcd_keypad.h"
+#include "hd44780_sim.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// pins of the demo wiring, all on port 0
+#define PIN_RS 1
+#define PIN_EN 2
+#define PIN_D4 3
+#define PIN_D5 4
+#define PIN_D6 5
+#define PIN_D7 6
+#define PIN_ROW0 8 // rows on 8 to 11
+
+#define HOLD_US 20000 // how long a key stays down
+#define MAX_PRESSES 4096
+
+typedef enum {
+    WORK_TEXT, // both rows rewritten over and over
+    WORK_CLEAR, // clear display and a short line
+    WORK_IDLE // nothing to draw, poll and sleep
+} work_t;
+
+static const uint32_t rows[4] = {PIN_ROW0, PIN_ROW0 + 1, PIN_ROW0 + 2, PIN_ROW0 + 3};
+static const uint32_t cols[4] = {PIN_D4, PIN_D5, PIN_D6, PIN_D7};
+static const char * const work_names[3] = {"drawing text", "clear and redraw", "idle, sleeping"};
+
+static hd44780_sim_t sim;
+static uint8_t sim_en_level = 0; // to see falling edges, the shim reports every write
+
+// the key matrix
+static uint8_t key_down = LCD_KEYPAD_NONE; // key held now
+static uint64_t press_us = 0; // when it went down
+static uint64_t next_press_us = UINT64_MAX; // when the next key goes down
+static uint8_t seen = 0; // scans that saw the key held now
+static uint32_t seed = 1;
+
+// presses of the current workload
+static uint8_t pressed[MAX_PRESSES];
+static uint32_t latency[MAX_PRESSES]; // from the key going down to the scan that debounced it
+static uint32_t presses = 0;
+static uint32_t debounced = 0;
+static uint32_t wrong_text = 0; // frames after which the panel didn't show what was drawn
+
+static uint32_t matrix_read(uint32_t pin_no);
+static void matrix_update(void);
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us);
+static uint64_t run(work_t work, uint8_t keypad, uint64_t length_us, uint32_t * lost);
+
+int main(int argc, char * argv[]) {
+    const uint64_t length_us = ((argc > 1) ? strtoull(argv[1], NULL, 0) : 2000) * 1000;
+    const uint32_t interval_us = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000;
+    lcd_keypad_stats_t stats;
+    uint64_t plain_bytes;
+    uint64_t keypad_bytes;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t lost;
+    uint32_t i;
+    uint32_t busy;
+    int fail = 0;
+    work_t work;
+
+    if(length_us == 0 || interval_us == 0 || !hd44780_sim_init(&sim, 1)) {
+	fprintf(stderr, "usage: %s [ms per workload] [scan interval us]\n", argv[0]);
+	return 1;
+    }
+
+    shim_set_pin_hook(sim_pin);
+    shim_set_read_hook(matrix_read);
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+
+    printf("%-18s %9s %9s %9s %10s %9s %11s %11s %9s\n", "workload", "presses", "mean us", "max us", "max gap us",
+	   "late", "free scans", "stolen us", "lost");
+    for(work = WORK_TEXT; work <= WORK_IDLE; work++) {
+	// the same workload without the keypad first, for the throughput it loses
+	lcd_set_bus_gap(NULL);
+	plain_bytes = run(work, 0, length_us, &lost);
+
+	presses = 0;
+	debounced = 0;
+	next_press_us = shim_now_us + 1000 + seed % HOLD_US;
+	lcd_keypad_init(rows, cols, interval_us);
+	keypad_bytes = run(work, 1, length_us, &lost);
+	lcd_keypad_get_stats(&stats);
+
+	total_us = 0;
+	max_us = 0;
+	for(i = 0; i < debounced; i++) {
+	    total_us += latency[i];
+	    if(latency[i] > max_us)
+		max_us = latency[i];
+	}
+
+	printf("%-18s %9" PRIu32 " %9.1f %9" PRIu32 " %10" PRIu32 " %9" PRIu32 " %11" PRIu32 " %11" PRIu32 " %8.2f%%\n",
+	       work_names[work], presses, debounced ? (double)total_us / debounced : 0.0, max_us, stats.max_gap_us,
+	       stats.late, stats.free_scans, stats.stolen_us,
+	       plain_bytes ? 100.0 * (double)(plain_bytes - keypad_bytes) / plain_bytes : 0.0);
+
+	if(lost != 0 || debounced < presses - (key_down != LCD_KEYPAD_NONE) || max_us > 2 * interval_us + LCD_BYTE_US) {
+	    printf("  %" PRIu32 " presses lost, %" PRIu32 " of %" PRIu32 " seen\n", lost, debounced, presses);
+	    fail = 1;
+	}
+
+	// let go before the next workload
+	key_down = LCD_KEYPAD_NONE;
+	next_press_us = UINT64_MAX;
+    }
+
+    busy = sim.busy_strobes[0];
+    printf("\nstrobes while the controller was busy: %" PRIu32 ", frames left wrong: %" PRIu32 "\n", busy, wrong_text);
+    if(busy != 0 || wrong_text != 0)
+	fail = 1;
+
+    hd44780_sim_free(&sim);
+    return fail;
+}
+
+/*
+    @brief Function for running a workload for a while
+
+    @param[in] keypad 1 if the keypad is set up, 0 to measure the LCD on its own
+
+    @param[out] lost Presses that lcd_keypad_get() didn't return, or returned as another key
+
+    @return bytes the panel latched, the text checked after every frame
+*/
+static uint64_t run(work_t work, uint8_t keypad, uint64_t length_us, uint32_t * lost) {
+    static char line[2][17] = {"Temp  21.5 C    ", "Set   22.0 C    "};
+    const uint64_t end = shim_now_us + length_us;
+    const uint32_t start_strobes = sim.strobes[0];
+    uint32_t read = 0;
+    uint32_t sleep_us;
+    char shown[17];
+    uint8_t row;
+    uint8_t key;
+
+    *lost = 0;
+    while(shim_now_us < end) {
+	if(work == WORK_TEXT) {
+	    line[0][9]++;
+	    if(line[0][9] > '9')
+		line[0][9] = '0';
+	    for(row = 0; row < 2; row++) {
+		lcd_set_cursor(0, row);
+		lcd_write_string(line[row]);
+	    }
+	    for(row = 0; row < 2; row++) {
+		hd44780_sim_line(&sim, 0, row, 16, shown);
+		if(memcmp(shown, line[row], 16) != 0)
+		    wrong_text++;
+	    }
+	}
+	else if(work == WORK_CLEAR) {
+	    lcd_clear();
+	    lcd_write_string(line[0]);
+	    hd44780_sim_line(&sim, 0, 0, 16, shown);
+	    if(memcmp(shown, line[0], 16) != 0)
+		wrong_text++;
+	}
+	else {
+	    sleep_us = keypad ? lcd_keypad_poll() : 1000;
+	    delay_us(sleep_us ? sleep_us : 1);
+	}
+
+	while((key = lcd_keypad_get()) != LCD_KEYPAD_NONE) {
+	    if(read >= presses || pressed[read] != key)
+		(*lost)++;
+	    read++;
+	}
+    }
+
+    // presses still in flight at the end are allowed to miss the last read
+    if(read + 1 < debounced)
+	*lost += debounced - read - 1;
+
+    return (sim.strobes[0] - start_strobes) / 2;
+}
+
+/*
+    @brief Function for the level of a pin, the columns read low while a pressed key's row is driven low
+*/
+static uint32_t matrix_read(uint32_t pin_no) {
+    uint32_t row;
+
+    matrix_update();
+    if(key_down == LCD_KEYPAD_NONE || pin_no != cols[key_down % 4])
+	return (pin_no >= PIN_D4 && pin_no <= PIN_D7) ? 1 : shim_pin_level[pin_no]; // pull-ups
+
+    row = rows[key_down / 4];
+    if(!shim_pin_output[row] || shim_pin_level[row])
+	return 1;
+
+    // the second scan in a row that sees the key is the one that debounces it
+    if(++seen == 2 && debounced < presses) {
+	latency[debounced] = (uint32_t)(shim_now_us - press_us);
+	debounced++;
+    }
+    return 0;
+}
+
+/*
+    @brief Function for pressing and letting go of keys as the clock runs
+
+    @note a key goes down for HOLD_US at a random time after the last one came up
+*/
+static void matrix_update(void) {
+    if(key_down != LCD_KEYPAD_NONE && shim_now_us >= press_us + HOLD_US) {
+	key_down = LCD_KEYPAD_NONE;
+	next_press_us = press_us + 2 * HOLD_US + seed % HOLD_US; // long enough for the release to be seen
+    }
+
+    // the key went down at its time, even if nothing looked at the matrix since
+    if(key_down == LCD_KEYPAD_NONE && shim_now_us >= next_press_us && presses < MAX_PRESSES) {
+	seed = seed * 1103515245 + 12345;
+	key_down = (seed >> 16) % 16;
+	press_us = next_press_us;
+	seen = 0;
+	pressed[presses++] = key_down;
+    }
+}
+
+/*
+    @brief Function for feeding the pin writes into the simulator
+*/
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us) {
+    uint8_t rs;
+    uint8_t nibble;
+
+    if(pin_no != PIN_EN)
+	return;
+
+    // the controller latches when enable falls
+    if(sim_en_level && !value) {
+	rs = shim_pin_level[PIN_RS];
+	nibble = shim_pin_level[PIN_D4] | (shim_pin_level[PIN_D5] << 1) | (shim_pin_level[PIN_D6] << 2)
+		 | (shim_pin_level[PIN_D7] << 3);
+	hd44780_sim_strobe(&sim, 0, 1, &rs, &nibble, now_us);
+    }
+    sim_en_level = value;
+}
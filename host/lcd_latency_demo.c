@@ -0,0 +1,101 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_latency_demo.c
+
+  @Summary
+    Request latency across clears and inits on the host shim
+
+  @Description
+    Runs the driver with the latency hooks on against the host shim. Every
+    round starts a request, writes a line with write combining on and ends
+    it, then either flushes, clears the display or initializes it again
+    before the cells went out. Each way is its own region, so the table
+    shows how many requests were done, how many of them were coalesced
+    (wiped before being sent) and how many were lost because every slot was
+    taken. A request may never be left waiting for cells that will not be
+    sent, so the demo fails if any region loses a request or finishes fewer
+    than it started.
+
+    Build on the host with:
+      cc -O2 -DLCD_LATENCY -I. -I../src -o lcd_latency_demo lcd_latency_demo.c nrf_shim.c ../src/lcd_16x2.c \
+        ../src/lcd_latency.c
+
+    Usage:
+      lcd_latency_demo [rounds]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "lcd_latency.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// pins of the demo wiring, all on port 0
+#define PIN_RS 1
+#define PIN_EN 2
+#define PIN_D4 3
+#define PIN_D5 4
+#define PIN_D6 5
+#define PIN_D7 6
+
+// what ends a round, one region each
+#define END_FLUSH 0
+#define END_CLEAR 1
+#define END_INIT 2
+#define END_WAYS 3
+
+int main(int argc, char * argv[]) {
+    static const char * const names[END_WAYS] = {"flush", "clear", "init"};
+    unsigned long rounds = 1000;
+    unsigned long i;
+    lcd_latency_stats_t stats;
+    char line[17];
+    uint8_t way;
+    uint8_t ok = 1;
+
+    if(argc > 1)
+	rounds = strtoul(argv[1], NULL, 0);
+    if(rounds == 0) {
+	fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+	return 1;
+    }
+
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+
+    printf("| round ends with | requests | done | coalesced | lost | p50 us | p99 us | max us |\n");
+    printf("|---|---|---|---|---|---|---|---|\n");
+
+    for(way = 0; way < END_WAYS; way++) {
+	for(i = 0; i < rounds; i++) {
+	    lcd_write_combine_on();
+	    lcd_request_begin((uint16_t)i, way);
+	    snprintf(line, sizeof(line), "%-6s %9lu", names[way], i % 1000000000);
+	    lcd_set_cursor(0, i & 1);
+	    lcd_write_string(line);
+	    lcd_request_end();
+
+	    if(way == END_FLUSH) {
+		lcd_flush();
+	    }
+	    else if(way == END_CLEAR) {
+		lcd_clear();
+	    }
+	    else {
+		lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+	    }
+	}
+
+	lcd_write_combine_off();
+	lcd_latency_get(way, &stats);
+	printf("| %s | %lu | %" PRIu32 " | %" PRIu32 " | %" PRIu32 " | %" PRIu32 " | %" PRIu32 " | %" PRIu32 " |\n",
+	       names[way], rounds, stats.count, stats.coalesced, stats.lost, stats.p50_us, stats.p99_us, stats.max_us);
+	if(stats.lost != 0 || stats.count != rounds)
+	    ok = 0;
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
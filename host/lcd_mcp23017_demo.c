@@ -0,0 +1,255 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mcp23017_demo.c
+
+  @Summary
+    MCP23017 transport against a register model of the expander
+
+  @Description
+    Runs lcd_mcp23017.c on the host with i2c_write() replaced by a model of
+    the MCP23017: IOCON, the direction and output latch registers and the
+    address pointer, which increments, toggles between the A and B register
+    of a pair or stays put depending on IOCON. Every falling edge of enable
+    on GPIOA strobes the byte GPIOB drives into the HD44780 simulator, at the
+    time of the I2C byte that dropped it on the virtual clock of the host
+    shim. Draws a screen with each write path, checks what the panel shows
+    and counts strobes that came while it was busy, then prints the I2C
+    bytes per character of every path, address bytes included.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_mcp23017_demo lcd_mcp23017_demo.c hd44780_sim.c nrf_shim.c ../src/lcd_mcp23017.c \
+        ../src/lcd_16x2.c
+
+    Usage:
+      lcd_mcp23017_demo [bus hz]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "lcd_i2c.h"
+#include "lcd_mcp23017.h"
+#include "hd44780_sim.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEMO_ADDRESS 0x20
+#define DEMO_RS 0 // GPA0
+#define DEMO_EN 1 // GPA1
+
+#define MCP_REGISTERS 0x16 // BANK = 0 layout, A and B registers interleaved
+
+static hd44780_sim_t sim;
+static uint32_t bus_hz = 400000;
+static uint64_t bus_ns = 0; // bus time not yet added to the virtual clock
+static uint64_t i2c_bytes = 0; // bytes on the bus, address bytes included
+static uint64_t i2c_transactions = 0;
+
+// the expander, in its power on state until i2c_init()
+static uint8_t mcp_reg[MCP_REGISTERS];
+static uint8_t mcp_pointer = 0; // register the next byte lands in
+static uint8_t lcd_pins = 0; // GPIOA as the panel sees it, to find enable edges
+
+static void mcp_reset(void);
+static void mcp_write(uint8_t reg, uint8_t value);
+static uint8_t mcp_next(uint8_t reg);
+static uint8_t mcp_port(uint8_t port);
+static uint8_t check(const char * row0, const char * row1);
+
+int main(int argc, char * argv[]) {
+    static const char * const text[2] = {"MCP23017 8 bit", "0123456789ABCDEF"};
+    uint64_t bytes;
+    uint8_t ok = 1;
+    uint8_t col;
+
+    if(argc > 1)
+	bus_hz = strtoul(argv[1], NULL, 0);
+    if(bus_hz == 0 || !hd44780_sim_init(&sim, 1)) {
+	fprintf(stderr, "usage: %s [bus hz]\n", argv[0]);
+	return 1;
+    }
+
+    i2c_init(0, 0, bus_hz);
+    lcd_mcp23017_init(DEMO_ADDRESS, DEMO_RS, DEMO_EN);
+    printf("init: %" PRIu64 " I2C bytes in %" PRIu64 " transactions\n\n", i2c_bytes, i2c_transactions);
+
+    printf("| write path | I2C bytes | per character |\n");
+    printf("|---|---|---|\n");
+
+    // a character at a time, every one is its own transaction
+    lcd_clear();
+    bytes = i2c_bytes;
+    for(col = 0; col < 16; col++) {
+	lcd_set_cursor(col, 1);
+	lcd_write_char(text[1][col]);
+    }
+    bytes = i2c_bytes - bytes;
+    printf("| lcd_set_cursor + lcd_write_char x16 | %" PRIu64 " | %.2f |\n", bytes, bytes / 16.0);
+    ok &= check("", text[1]);
+
+    lcd_clear();
+    bytes = i2c_bytes;
+    lcd_set_cursor(0, 1);
+    lcd_write_string((char *)text[1]);
+    bytes = i2c_bytes - bytes;
+    printf("| lcd_write_string 16 | %" PRIu64 " | %.2f |\n", bytes, bytes / 16.0);
+    ok &= check("", text[1]);
+
+    // one burst for the whole run
+    lcd_clear();
+    bytes = i2c_bytes;
+    lcd_set_cursor(0, 1);
+    lcd_write_buffer((const uint8_t *)text[1], 16);
+    bytes = i2c_bytes - bytes;
+    printf("| lcd_write_buffer 16 | %" PRIu64 " | %.2f |\n", bytes, bytes / 16.0);
+    ok &= check("", text[1]);
+
+    // both lines through the flush plan
+    lcd_clear();
+    bytes = i2c_bytes;
+    lcd_write_combine_on();
+    lcd_set_cursor(0, 0);
+    lcd_write_string((char *)text[0]);
+    lcd_set_cursor(0, 1);
+    lcd_write_string((char *)text[1]);
+    lcd_flush();
+    lcd_write_combine_off();
+    bytes = i2c_bytes - bytes;
+    printf("| full screen, combined | %" PRIu64 " | %.2f |\n", bytes, bytes / 30.0);
+    ok &= check(text[0], text[1]);
+
+    printf("\nstrobes %" PRIu32 ", while busy %" PRIu32 "\n", sim.strobes[0], sim.busy_strobes[0]);
+    ok &= sim.busy_strobes[0] == 0;
+    hd44780_sim_free(&sim);
+
+    return ok ? 0 : 1;
+}
+
+/*
+    @brief Function for comparing what the panel shows with the text drawn, blank padded to 16 characters
+*/
+static uint8_t check(const char * row0, const char * row1) {
+    const char * const want[2] = {row0, row1};
+    char line[17];
+    char padded[17];
+    uint8_t ok = 1;
+    uint8_t row;
+
+    for(row = 0; row < 2; row++) {
+	snprintf(padded, sizeof(padded), "%-16s", want[row]);
+	hd44780_sim_line(&sim, 0, row, 16, line);
+	if(strcmp(line, padded) != 0) {
+	    printf("  row %u shows \"%s\", expected \"%s\"\n", row, line, padded);
+	    ok = 0;
+	}
+    }
+    return ok;
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function standing in for lcd_i2c.c, resets the expander model
+*/
+void i2c_init(uint32_t scl, uint32_t sda, uint32_t frequency) {
+    (void)scl;
+    (void)sda;
+    bus_hz = frequency;
+    mcp_reset();
+}
+
+/*
+    @brief Function standing in for lcd_i2c.c, the bus rate of the model
+*/
+uint32_t i2c_frequency(void) {
+    return bus_hz;
+}
+
+/*
+    @brief Function standing in for lcd_i2c.c, feeds a write transaction to the expander model
+
+    @note a start and the address byte, 9 clocks for every byte and a stop, the virtual clock moves on by the bus
+	  time of the transaction
+*/
+void i2c_write(uint8_t address, const uint8_t * data, uint8_t length) {
+    uint8_t i;
+
+    i2c_transactions++;
+    i2c_bytes += 1 + length;
+    bus_ns += 10 * 1000000000ull / bus_hz;
+
+    for(i = 0; i < length; i++) {
+	bus_ns += 9 * 1000000000ull / bus_hz;
+	if(address != DEMO_ADDRESS)
+	    continue; // nobody acknowledges
+
+	// the first byte sets the address pointer, the rest are register writes
+	if(i == 0) {
+	    mcp_pointer = data[0] % MCP_REGISTERS;
+	}
+	else {
+	    mcp_write(mcp_pointer, data[i]);
+	    mcp_pointer = mcp_next(mcp_pointer);
+	}
+    }
+
+    bus_ns += 1000000000ull / bus_hz;
+    shim_now_us += bus_ns / 1000;
+    bus_ns %= 1000;
+}
+
+/*
+    @brief Function for putting the expander model in its power on state
+*/
+static void mcp_reset(void) {
+    memset(mcp_reg, 0, sizeof(mcp_reg));
+    mcp_reg[MCP23017_IODIRA] = 0xFF; // every pin an input
+    mcp_reg[MCP23017_IODIRB] = 0xFF;
+    mcp_pointer = 0;
+    lcd_pins = 0;
+}
+
+/*
+    @brief Function for writing an expander register, GPIO writes go to the output latch
+
+    @note a falling edge of enable strobes what GPIOB drives into the simulator, at the end of the current byte
+*/
+static void mcp_write(uint8_t reg, uint8_t value) {
+    uint8_t pins;
+
+    if(reg == MCP23017_IOCON || reg == MCP23017_IOCON + 1) {
+	mcp_reg[MCP23017_IOCON] = value; // one register at two addresses
+	mcp_reg[MCP23017_IOCON + 1] = value;
+	return;
+    }
+    if(reg == MCP23017_GPIOA || reg == MCP23017_GPIOB)
+	reg += 2; // OLATA, OLATB
+    mcp_reg[reg] = value;
+
+    pins = mcp_port(0);
+    if((lcd_pins & (1 << DEMO_EN)) && !(pins & (1 << DEMO_EN)))
+	hd44780_sim_byte(&sim, 0, (pins >> DEMO_RS) & 1, mcp_port(1), shim_now_us + bus_ns / 1000);
+    lcd_pins = pins;
+}
+
+/*
+    @brief Function for the register the address pointer moves to after a byte
+
+    @note with SEQOP set and BANK clear the pointer toggles between the A and B register of a pair, with SEQOP clear
+	  it runs through the register file
+*/
+static uint8_t mcp_next(uint8_t reg) {
+    if(mcp_reg[MCP23017_IOCON] & MCP23017_IOCON_SEQOP)
+	return (mcp_reg[MCP23017_IOCON] & MCP23017_IOCON_BANK) ? reg : (reg ^ 1);
+    return (reg + 1) % MCP_REGISTERS;
+}
+
+/*
+    @brief Function for the level a port drives, pins that are still inputs read low
+*/
+static uint8_t mcp_port(uint8_t port) {
+    return mcp_reg[MCP23017_GPIOA + 2 + port] & ~mcp_reg[MCP23017_IODIRA + port];
+}
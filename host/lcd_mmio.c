@@ -0,0 +1,449 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mmio.c
+
+  @Summary
+    Memory mapped gpio backend for Linux boards
+
+  @Description
+    Implements nrf_delay.h, nrf_gpio.h and nrf.h on top of mapped gpio
+    registers and the monotonic clock, and the watcher that decodes the
+    writes to a fake register block into the HD44780 simulator
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_mmio.h"
+#include "hd44780_sim.h"
+#include "nrf_delay.h"
+#include "nrf_gpio.h"
+#include "nrf.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MMIO_MAX_PANELS 8
+
+CoreDebug_Type shim_core_debug;
+NRF_GPIO_Type shim_p0;
+
+static DWT_Type dwt_regs;
+
+static volatile uint32_t * regs = NULL; // mapped register block of the driver's side
+static size_t regs_length;
+static mmio_layout_t regs_layout;
+static uint8_t regs_fake = 0;
+
+static mmio_strobe_fn strobe_hook = NULL;
+static uint32_t strobe_en_mask = 0;
+static uint32_t strobe_en_high = 0; // enable pins driven high
+static uint64_t strobe_last_ns = 0; // time of the last falling edge, 0 before the first
+static uint64_t strobe_requested_ns = 0; // delays requested since then
+
+static volatile uint32_t * watch_regs = NULL; // the watcher's own mapping of the fake block
+static size_t watch_length;
+static mmio_layout_t watch_layout;
+static hd44780_sim_t * watch_sim;
+static uint32_t watch_rs;
+static uint32_t watch_data[4];
+static uint32_t watch_en[MMIO_MAX_PANELS];
+static uint8_t watch_panels;
+static pthread_t watch_thread;
+static volatile uint8_t watch_stopping = 0;
+
+static volatile uint32_t * mmio_map(const char * path, const mmio_layout_t * layout, uint8_t fake, size_t * length);
+static volatile uint32_t * mmio_reg(volatile uint32_t * base, uint32_t offset);
+static volatile uint64_t * mmio_stamp(volatile uint32_t * base, const mmio_layout_t * layout);
+static void mmio_store(uint32_t offset, uint32_t value);
+static void mmio_wait_taken(void);
+static uint64_t mmio_now_us(void);
+static uint64_t mmio_now_ns(void);
+static void mmio_strobe_track(uint32_t offset, uint32_t value);
+static void * watch_run(void * arg);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Map the register block
+
+    @note with fake set the file is created if needed and stands in for the registers, it is left to the watcher
+	  to apply the set and clear writes to the level register, pull ups are not set up on real hardware, use the
+	  board's tools
+
+    @param[in] path Device or file to map
+
+    @param[in] layout Registers in the block
+
+    @param[in] fake Nonzero if path is a regular file followed by mmio_watch_start()
+
+    @return 0 if the block could not be mapped
+*/
+uint8_t mmio_open(const char * path, const mmio_layout_t * layout, uint8_t fake) {
+    regs = mmio_map(path, layout, fake, &regs_length);
+    if(regs == NULL)
+	return 0;
+
+    regs_layout = *layout;
+    regs_fake = fake;
+    return 1;
+}
+
+/*
+    @brief Unmap the register block
+
+    @note with a fake block, waits for the watcher to take the last write
+*/
+void mmio_close(void) {
+    if(regs == NULL)
+	return;
+
+    if(regs_fake)
+	mmio_wait_taken();
+
+    munmap((void *)regs, regs_length);
+    regs = NULL;
+}
+
+/*
+    @brief Set the callback timing the enable strobes
+
+    @note compares the time between two strobes with the delays requested in between, the difference is what
+	  the scheduler and the bus stretched the timing by
+
+    @param[in] en_mask Port bits of the enable pins
+
+    @param[in] hook Callback, NULL for none
+*/
+void mmio_set_strobe_hook(uint32_t en_mask, mmio_strobe_fn hook) {
+    strobe_en_mask = en_mask;
+    strobe_en_high = 0;
+    strobe_last_ns = 0;
+    strobe_requested_ns = 0;
+    strobe_hook = hook;
+}
+
+/*
+    @brief Follow the writes to a fake register block and decode them into the simulator
+
+    @note the watcher applies set and clear writes to the level register and strobes a panel of the simulator on
+	  every falling edge of its enable pin, with the time stamp of the write
+
+    @param[in] path File given to mmio_open()
+
+    @param[in] layout Registers in the block
+
+    @param[in] sim Simulator, at least panels panels
+
+    @param[in] rs Register select pin
+
+    @param[in] data D4-D7 pins
+
+    @param[in] en Enable pin of every panel
+
+    @param[in] panels Number of panels
+
+    @return 0 if the file could not be mapped or the thread could not be started
+*/
+uint8_t mmio_watch_start(const char * path, const mmio_layout_t * layout, hd44780_sim_t * sim, uint32_t rs,
+			 const uint32_t data[4], const uint32_t * en, uint8_t panels) {
+    uint8_t i;
+
+    if(panels > MMIO_MAX_PANELS)
+	panels = MMIO_MAX_PANELS;
+
+    watch_regs = mmio_map(path, layout, 1, &watch_length);
+    if(watch_regs == NULL)
+	return 0;
+
+    watch_layout = *layout;
+    watch_sim = sim;
+    watch_rs = rs;
+    for(i = 0; i < 4; i++)
+	watch_data[i] = data[i];
+    for(i = 0; i < panels; i++)
+	watch_en[i] = en[i];
+    watch_panels = panels;
+    watch_stopping = 0;
+
+    if(pthread_create(&watch_thread, NULL, watch_run, NULL) != 0) {
+	munmap((void *)watch_regs, watch_length);
+	watch_regs = NULL;
+	return 0;
+    }
+    return 1;
+}
+
+/*
+    @brief Stop the watcher once it has taken every write
+*/
+void mmio_watch_stop(void) {
+    if(watch_regs == NULL)
+	return;
+
+    watch_stopping = 1;
+    pthread_join(watch_thread, NULL);
+    munmap((void *)watch_regs, watch_length);
+    watch_regs = NULL;
+}
+
+/*******************************[ SDK Functions ]****************************************/
+
+void nrf_delay_us(uint32_t us_time) {
+    const uint64_t until = mmio_now_us() + us_time;
+
+    strobe_requested_ns += (uint64_t)us_time * 1000;
+
+    // sleeping would take far longer than an enable pulse
+    while(mmio_now_us() < until)
+	;
+}
+
+void nrf_delay_ms(uint32_t ms_time) {
+    struct timespec ts;
+
+    strobe_requested_ns += (uint64_t)ms_time * 1000000;
+
+    ts.tv_sec = ms_time / 1000;
+    ts.tv_nsec = (long)(ms_time % 1000) * 1000000;
+    while(nanosleep(&ts, &ts) != 0)
+	;
+}
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value) {
+    if(pin_number < 32)
+	mmio_store(value ? regs_layout.set : regs_layout.clear, (uint32_t)1 << pin_number);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+    if(pin_number >= 32)
+	return 0;
+    return (__atomic_load_n(mmio_reg(regs, regs_layout.level), __ATOMIC_ACQUIRE) >> pin_number) & 1;
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+    volatile uint32_t * select;
+
+    if(pin_number >= 32 || regs_layout.select == MMIO_NONE)
+	return;
+
+    select = mmio_reg(regs, regs_layout.select + (pin_number / 10) * 4);
+    *select = (*select & ~((uint32_t)7 << ((pin_number % 10) * 3))) | ((uint32_t)1 << ((pin_number % 10) * 3));
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+    volatile uint32_t * select;
+
+    (void)pull_config;
+    if(pin_number >= 32 || regs_layout.select == MMIO_NONE)
+	return;
+
+    select = mmio_reg(regs, regs_layout.select + (pin_number / 10) * 4);
+    *select &= ~((uint32_t)7 << ((pin_number % 10) * 3));
+}
+
+void nrf_gpio_port_out_set(NRF_GPIO_Type * p_reg, uint32_t set_mask) {
+    (void)p_reg;
+    if(set_mask != 0)
+	mmio_store(regs_layout.set, set_mask);
+}
+
+void nrf_gpio_port_out_clear(NRF_GPIO_Type * p_reg, uint32_t clr_mask) {
+    (void)p_reg;
+    if(clr_mask != 0)
+	mmio_store(regs_layout.clear, clr_mask);
+}
+
+/*
+    @brief Function for reading the DWT registers with CYCCNT following the monotonic clock at 64MHz
+*/
+DWT_Type * shim_dwt(void) {
+    dwt_regs.CYCCNT = (uint32_t)(mmio_now_us() * 64);
+    return &dwt_regs;
+}
+
+/*
+    @brief Function for mapping a register block, a fake one gets room for the time stamp after the registers
+*/
+static volatile uint32_t * mmio_map(const char * path, const mmio_layout_t * layout, uint8_t fake, size_t * length) {
+    void * block;
+    int fd;
+
+    *length = layout->length;
+    if(fake)
+	*length = ((layout->length + 7) & ~(size_t)7) + sizeof(uint64_t);
+
+    fd = open(path, fake ? (O_RDWR | O_CREAT) : (O_RDWR | O_SYNC), 0644);
+    if(fd < 0)
+	return NULL;
+
+    if(fake && lseek(fd, 0, SEEK_END) < (off_t)(layout->offset + *length)
+       && ftruncate(fd, layout->offset + *length) != 0) {
+	close(fd);
+	return NULL;
+    }
+
+    block = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, layout->offset);
+    close(fd); // the mapping keeps the file open
+    return (block == MAP_FAILED) ? NULL : block;
+}
+
+/*
+    @brief Function for finding a register in a mapped block
+*/
+static volatile uint32_t * mmio_reg(volatile uint32_t * base, uint32_t offset) {
+    return base + offset / 4;
+}
+
+/*
+    @brief Function for finding the time stamp of a fake block, 8 byte aligned after the registers
+*/
+static volatile uint64_t * mmio_stamp(volatile uint32_t * base, const mmio_layout_t * layout) {
+    return (volatile uint64_t *)(base + ((layout->length + 7) & ~(uint32_t)7) / 4);
+}
+
+/*
+    @brief Function for writing a set or clear register
+
+    @note a single store on real hardware, on a fake block the store waits until the watcher took the one
+	  before so it sees every write in order
+*/
+static void mmio_store(uint32_t offset, uint32_t value) {
+    if(regs == NULL)
+	return;
+
+    if(!regs_fake) {
+	*mmio_reg(regs, offset) = value;
+	if(strobe_hook != NULL)
+	    mmio_strobe_track(offset, value);
+	return;
+    }
+
+    mmio_wait_taken();
+    __atomic_store_n(mmio_stamp(regs, &regs_layout), mmio_now_us(), __ATOMIC_RELAXED);
+    __atomic_store_n(mmio_reg(regs, offset), value, __ATOMIC_RELEASE);
+    if(strobe_hook != NULL)
+	mmio_strobe_track(offset, value);
+}
+
+/*
+    @brief Function for waiting until the watcher took the last write to a fake block
+
+    @note sleeps rather than yields and backs off up to a millisecond, a SCHED_FIFO bus thread would barely let
+	  a normal watcher run otherwise
+*/
+static void mmio_wait_taken(void) {
+    struct timespec nap = {0, 1000};
+
+    while(__atomic_load_n(mmio_reg(regs, regs_layout.set), __ATOMIC_ACQUIRE) != 0
+	  || __atomic_load_n(mmio_reg(regs, regs_layout.clear), __ATOMIC_ACQUIRE) != 0) {
+	nanosleep(&nap, NULL);
+	if(nap.tv_nsec < 1000000)
+	    nap.tv_nsec *= 2;
+    }
+}
+
+/*
+    @brief Function for timing a falling enable edge against the delays requested since the one before
+*/
+static void mmio_strobe_track(uint32_t offset, uint32_t value) {
+    uint64_t now;
+
+    value &= strobe_en_mask;
+    if(value == 0)
+	return;
+
+    if(offset == regs_layout.set) {
+	strobe_en_high |= value;
+	return;
+    }
+
+    if(!(strobe_en_high & value))
+	return; // already low, the driver clears enable before every pulse
+
+    strobe_en_high &= ~value;
+    now = mmio_now_ns();
+    if(strobe_last_ns != 0)
+	strobe_hook(now - strobe_last_ns, strobe_requested_ns);
+    strobe_last_ns = now;
+    strobe_requested_ns = 0;
+}
+
+/*
+    @brief Function for reading the monotonic clock in microseconds
+*/
+static uint64_t mmio_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+    @brief Function for reading the monotonic clock in nanoseconds
+*/
+static uint64_t mmio_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+    @brief Function for the watcher thread, applies every write and strobes the panels whose enable fell
+*/
+static void * watch_run(void * arg) {
+    volatile uint32_t * const set = mmio_reg(watch_regs, watch_layout.set);
+    volatile uint32_t * const clear = mmio_reg(watch_regs, watch_layout.clear);
+    volatile uint32_t * const level = mmio_reg(watch_regs, watch_layout.level);
+    uint32_t out = *level;
+    uint32_t next;
+    uint32_t set_mask;
+    uint32_t clear_mask;
+    uint64_t stamp;
+    uint8_t rs;
+    uint8_t nibble;
+    uint8_t panel;
+    uint8_t bit;
+
+    (void)arg;
+
+    for(;;) {
+	set_mask = __atomic_load_n(set, __ATOMIC_ACQUIRE);
+	clear_mask = __atomic_load_n(clear, __ATOMIC_ACQUIRE);
+	if(set_mask == 0 && clear_mask == 0) {
+	    if(watch_stopping)
+		break;
+	    sched_yield();
+	    continue;
+	}
+
+	stamp = __atomic_load_n(mmio_stamp(watch_regs, &watch_layout), __ATOMIC_RELAXED);
+	next = (out | set_mask) & ~clear_mask;
+	__atomic_store_n(level, next, __ATOMIC_RELAXED);
+	if(set_mask != 0)
+	    __atomic_store_n(set, 0, __ATOMIC_RELEASE);
+	if(clear_mask != 0)
+	    __atomic_store_n(clear, 0, __ATOMIC_RELEASE);
+
+	// the controller latches RS and D4-D7 when its enable falls
+	rs = (next >> watch_rs) & 1;
+	nibble = 0;
+	for(bit = 0; bit < 4; bit++)
+	    nibble |= ((next >> watch_data[bit]) & 1) << bit;
+
+	for(panel = 0; panel < watch_panels; panel++)
+	    if(((out >> watch_en[panel]) & 1) && !((next >> watch_en[panel]) & 1))
+		hd44780_sim_strobe(watch_sim, panel, 1, &rs, &nibble, stamp);
+
+	out = next;
+    }
+
+    return NULL;
+}
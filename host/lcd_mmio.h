@@ -0,0 +1,124 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mmio.h
+
+  @Summary
+    Memory mapped gpio backend for Linux boards
+
+  @Description
+    Runs the unmodified driver on a Linux board by mapping the SoC's gpio
+    registers into user space, e.g. /dev/gpiomem on a Raspberry Pi, instead
+    of going through a syscall per pin. Implements the same SDK functions as
+    nrf_shim.c, link one or the other. The driver already works out the port
+    bits of every nibble and of the enable pins at init, so a nibble is one
+    store to the set register and one to the clear register and a whole
+    enable pulse is two stores.
+
+    Any regular file can stand in for the register block, e.g. on a PC. The
+    file is shared, so a watcher thread in the same process or in another
+    process can follow the writes and decode them into the HD44780
+    simulator. In that mode every store waits until the watcher has taken
+    the one before, and is stamped with the time it was made.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "hd44780_sim.h"
+
+#ifndef LCD_MMIO_H
+#define LCD_MMIO_H
+
+#define MMIO_NONE 0xFFFFFFFF
+
+/*
+    @brief Where the registers are in the mapped block, byte offsets
+*/
+typedef struct {
+    uint32_t offset; // offset of the block in the device or file, a multiple of the page size
+    uint32_t length; // bytes to map
+    uint32_t set; // output set register, a 1 drives the pin high
+    uint32_t clear; // output clear register, a 1 drives the pin low
+    uint32_t level; // input level register
+    uint32_t select; // first function select register, 3 bits per pin and 10 pins per register, MMIO_NONE to leave the pins alone
+} mmio_layout_t;
+
+// /dev/gpiomem on a Raspberry Pi, pins 0-31
+#define MMIO_LAYOUT_BCM2835 {0, 0xB4, 0x1C, 0x28, 0x34, 0x00}
+
+/*
+    @brief Callback seeing every falling edge of an enable pin
+
+    @param[in] actual_ns Time since the falling edge before
+
+    @param[in] requested_ns Delays the driver asked for in between
+*/
+typedef void (*mmio_strobe_fn)(uint64_t actual_ns, uint64_t requested_ns);
+
+/*
+    @brief Map the register block
+
+    @note with fake set the file is created if needed and stands in for the registers, it is left to the watcher
+	  to apply the set and clear writes to the level register, pull ups are not set up on real hardware, use the
+	  board's tools
+
+    @param[in] path Device or file to map
+
+    @param[in] layout Registers in the block
+
+    @param[in] fake Nonzero if path is a regular file followed by mmio_watch_start()
+
+    @return 0 if the block could not be mapped
+*/
+uint8_t mmio_open(const char * path, const mmio_layout_t * layout, uint8_t fake);
+
+/*
+    @brief Unmap the register block
+
+    @note with a fake block, waits for the watcher to take the last write
+*/
+void mmio_close(void);
+
+/*
+    @brief Set the callback timing the enable strobes
+
+    @note compares the time between two strobes with the delays requested in between, the difference is what
+	  the scheduler and the bus stretched the timing by
+
+    @param[in] en_mask Port bits of the enable pins
+
+    @param[in] hook Callback, NULL for none
+*/
+void mmio_set_strobe_hook(uint32_t en_mask, mmio_strobe_fn hook);
+
+/*
+    @brief Follow the writes to a fake register block and decode them into the simulator
+
+    @note the watcher applies set and clear writes to the level register and strobes a panel of the simulator on
+	  every falling edge of its enable pin, with the time stamp of the write
+
+    @param[in] path File given to mmio_open()
+
+    @param[in] layout Registers in the block
+
+    @param[in] sim Simulator, at least panels panels
+
+    @param[in] rs Register select pin
+
+    @param[in] data D4-D7 pins
+
+    @param[in] en Enable pin of every panel
+
+    @param[in] panels Number of panels
+
+    @return 0 if the file could not be mapped or the thread could not be started
+*/
+uint8_t mmio_watch_start(const char * path, const mmio_layout_t * layout, hd44780_sim_t * sim, uint32_t rs,
+			 const uint32_t data[4], const uint32_t * en, uint8_t panels);
+
+/*
+    @brief Stop the watcher once it has taken every write
+*/
+void mmio_watch_stop(void);
+
+#endif
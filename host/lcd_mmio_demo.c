@@ -0,0 +1,99 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mmio_demo.c
+
+  @Summary
+    Driver on memory mapped gpio, on a board or against a fake register block
+
+  @Description
+    Initializes the LCD through lcd_mmio.c and writes two lines. Given
+    /dev/gpiomem on a Raspberry Pi it drives a real panel wired to the pins
+    below. Given any other file it maps the file as a fake register block,
+    follows it with the watcher and prints what the simulated panel shows,
+    how many strobes it took and how many came while it was busy.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_mmio_demo lcd_mmio_demo.c lcd_mmio.c hd44780_sim.c ../src/lcd_16x2.c -lpthread
+
+    Usage:
+      lcd_mmio_demo /dev/gpiomem
+      lcd_mmio_demo regs.bin
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_16x2.h"
+#include "lcd_mmio.h"
+#include "hd44780_sim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// BCM gpio numbers of the demo wiring
+#define PIN_RS 25
+#define PIN_EN 24
+#define PIN_D4 23
+#define PIN_D5 17
+#define PIN_D6 18
+#define PIN_D7 22
+
+static double wall_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char * argv[]) {
+    static const mmio_layout_t layout = MMIO_LAYOUT_BCM2835;
+    static const uint32_t data[4] = {PIN_D4, PIN_D5, PIN_D6, PIN_D7};
+    static const uint32_t en[1] = {PIN_EN};
+    uint8_t fake;
+    hd44780_sim_t sim;
+    char line[17];
+    double start;
+    double string_us;
+
+    if(argc != 2) {
+	fprintf(stderr, "usage: %s </dev/gpiomem | regs.bin>\n", argv[0]);
+	return 1;
+    }
+
+    fake = strncmp(argv[1], "/dev/", 5) != 0;
+    if(!mmio_open(argv[1], &layout, fake)) {
+	perror(argv[1]);
+	return 1;
+    }
+
+    if(fake && (!hd44780_sim_init(&sim, 1) || !mmio_watch_start(argv[1], &layout, &sim, PIN_RS, data, en, 1))) {
+	fprintf(stderr, "cannot start the watcher\n");
+	return 1;
+    }
+
+    lcd_init(PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7);
+    lcd_set_cursor(0, 0);
+    lcd_write_string("mmio gpio");
+
+    lcd_set_cursor(0, 1);
+    start = wall_us();
+    lcd_write_string("0123456789ABCDEF");
+    string_us = wall_us() - start;
+
+    mmio_close();
+    printf("16 characters took %.0f us\n", string_us);
+
+    if(fake) {
+	mmio_watch_stop();
+	hd44780_sim_line(&sim, 0, 0, 16, line);
+	printf("|%s|\n", line);
+	hd44780_sim_line(&sim, 0, 1, 16, line);
+	printf("|%s|\n", line);
+	printf("strobes %" PRIu32 ", while busy %" PRIu32 "\n", sim.strobes[0], sim.busy_strobes[0]);
+	hd44780_sim_free(&sim);
+    }
+
+    return 0;
+}
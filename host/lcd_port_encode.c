@@ -0,0 +1,343 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_port_encode.c
+
+  @Summary
+    Port word encoders for DMA playback on the host
+
+  @Description
+    Implements the scalar, SWAR and SIMD encoders. Build with -mssse3 (or
+    -march=native) on x86 to get the pshufb version, AArch64 always has
+    NEON.
+******************************************************************************/
+
+#include "lcd_port_encode.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+#include <string.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define PORT_ENCODE_SSSE3
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PORT_ENCODE_NEON
+#endif
+
+#define LANES 0x0000000100000001ull // one in each 32 bit half
+
+#if defined(PORT_ENCODE_SSSE3) || defined(PORT_ENCODE_NEON)
+// the 5 words of 4 bytes as 5 stores of 4 words: h0 h0|E h0 l0|E l0 h1 h1|E ... which enable bits go where
+static const uint32_t spread_en[LCD_PORT_WORDS][4] = {
+    {0, 0xFFFFFFFF, 0, 0xFFFFFFFF},
+    {0, 0, 0xFFFFFFFF, 0},
+    {0xFFFFFFFF, 0, 0, 0xFFFFFFFF},
+    {0, 0xFFFFFFFF, 0, 0},
+    {0xFFFFFFFF, 0, 0xFFFFFFFF, 0}
+};
+#endif
+
+#if defined(PORT_ENCODE_SSSE3)
+// bytes of each store taken from the high nibble words, 0x80 gives 0
+static const uint8_t spread_high[LCD_PORT_WORDS][16] = {
+    {0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x02, 0x03, 0x80, 0x80, 0x80, 0x80},
+    {0x80, 0x80, 0x80, 0x80, 0x04, 0x05, 0x06, 0x07, 0x04, 0x05, 0x06, 0x07, 0x04, 0x05, 0x06, 0x07},
+    {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x08, 0x09, 0x0A, 0x0B, 0x08, 0x09, 0x0A, 0x0B},
+    {0x08, 0x09, 0x0A, 0x0B, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x0C, 0x0D, 0x0E, 0x0F},
+    {0x0C, 0x0D, 0x0E, 0x0F, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}
+};
+
+// and from the low nibble words
+static const uint8_t spread_low[LCD_PORT_WORDS][16] = {
+    {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0x01, 0x02, 0x03},
+    {0x00, 0x01, 0x02, 0x03, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+    {0x04, 0x05, 0x06, 0x07, 0x04, 0x05, 0x06, 0x07, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80},
+    {0x80, 0x80, 0x80, 0x80, 0x08, 0x09, 0x0A, 0x0B, 0x08, 0x09, 0x0A, 0x0B, 0x80, 0x80, 0x80, 0x80},
+    {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x0C, 0x0D, 0x0E, 0x0F, 0x0C, 0x0D, 0x0E, 0x0F}
+};
+#elif defined(PORT_ENCODE_NEON)
+// bytes of each store from the high nibble words (0-15) and the low nibble words (16-31)
+static const uint8_t spread_pair[LCD_PORT_WORDS][16] = {
+    {0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 16, 17, 18, 19},
+    {16, 17, 18, 19, 4, 5, 6, 7, 4, 5, 6, 7, 4, 5, 6, 7},
+    {20, 21, 22, 23, 20, 21, 22, 23, 8, 9, 10, 11, 8, 9, 10, 11},
+    {8, 9, 10, 11, 24, 25, 26, 27, 24, 25, 26, 27, 12, 13, 14, 15},
+    {12, 13, 14, 15, 12, 13, 14, 15, 28, 29, 30, 31, 28, 29, 30, 31}
+};
+#endif
+
+static void put_byte(const lcd_port_encoder_t * enc, uint32_t high, uint32_t low, uint32_t * words);
+
+/*
+    @brief Work out the port bits of the bus pins
+
+    @param[out] enc Encoder to set up
+
+    @param[in] rs Register select pin
+
+    @param[in] data D4-D7 pins
+
+    @param[in] en_mask Port bits of the enable pins
+
+    @return 0 if a pin is not on port 0
+*/
+uint8_t lcd_port_encoder_init(lcd_port_encoder_t * enc, uint32_t rs, const uint32_t data[4], uint32_t en_mask) {
+    uint8_t nibble;
+    uint8_t bit;
+
+    memset(enc, 0, sizeof(*enc));
+    if(rs >= 32 || data[0] >= 32 || data[1] >= 32 || data[2] >= 32 || data[3] >= 32)
+	return 0;
+
+    enc->rs_mask = (uint32_t)1 << rs;
+    enc->en_mask = en_mask;
+    for(bit = 0; bit < 4; bit++)
+	enc->pin[bit] = (uint32_t)1 << data[bit];
+
+    for(nibble = 0; nibble < 16; nibble++) {
+	for(bit = 0; bit < 4; bit++)
+	    if(nibble & (1 << bit))
+		enc->nibble_set[nibble] |= enc->pin[bit];
+	for(bit = 0; bit < 4; bit++)
+	    enc->plane[bit][nibble] = (uint8_t)(enc->nibble_set[nibble] >> (8 * bit));
+    }
+
+    return 1;
+}
+
+/*
+    @brief Encode bytes with a table lookup per nibble, the way the driver does it
+
+    @param[in] enc Port bits of the bus pins
+
+    @param[in] value Bytes to send
+
+    @param[in] mode Register select for each byte, 0 for a command and 1 for data
+
+    @param[in] length Number of bytes
+
+    @param[out] words Port words, LCD_PORT_WORDS per byte
+
+    @param[in] words_size Number of words that fit in words
+
+    @return number of words written, 0 if they don't fit
+*/
+uint32_t lcd_port_encode_scalar(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+				uint32_t length, uint32_t * words, uint32_t words_size) {
+    uint32_t rs;
+    uint32_t i;
+
+    if((uint64_t)length * LCD_PORT_WORDS > words_size)
+	return 0;
+
+    for(i = 0; i < length; i++) {
+	rs = mode[i] ? enc->rs_mask : 0;
+	put_byte(enc, enc->nibble_set[value[i] >> 4] | rs, enc->nibble_set[value[i] & 0x0F] | rs,
+		 &words[LCD_PORT_WORDS * i]);
+    }
+
+    return LCD_PORT_WORDS * length;
+}
+
+/*
+    @brief Encode bytes with a multiply per data bit covering both nibbles, no table
+
+    @note the high nibble sits in the low half of a 64 bit word and the low nibble in the upper half, bit n of each
+	  half times the port bit of the pin lands on that pin in both halves at once without a carry between them
+*/
+uint32_t lcd_port_encode_swar(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+			      uint32_t length, uint32_t * words, uint32_t words_size) {
+    uint64_t nibbles;
+    uint64_t x;
+    uint32_t i;
+
+    if((uint64_t)length * LCD_PORT_WORDS > words_size)
+	return 0;
+
+    for(i = 0; i < length; i++) {
+	nibbles = (uint64_t)(value[i] >> 4) | ((uint64_t)(value[i] & 0x0F) << 32);
+
+	x = ((nibbles & LANES) * enc->pin[0])
+	  | (((nibbles >> 1) & LANES) * enc->pin[1])
+	  | (((nibbles >> 2) & LANES) * enc->pin[2])
+	  | (((nibbles >> 3) & LANES) * enc->pin[3])
+	  | ((uint64_t)(mode[i] != 0) * (LANES * enc->rs_mask));
+
+	put_byte(enc, (uint32_t)x, (uint32_t)(x >> 32), &words[LCD_PORT_WORDS * i]);
+    }
+
+    return LCD_PORT_WORDS * length;
+}
+
+/*
+    @brief Encode bytes 16 at a time with byte shuffles, the tail and unsupported targets go through SWAR
+
+    @note the nibbles index 4 tables, one per byte of the port word, the 4 results are interleaved into 32 bit
+	  words. Every 4 bytes become 5 stores of 4 words, each shuffled together from the high and low nibble words
+	  with the enable bits ORed in
+*/
+uint32_t lcd_port_encode_simd(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+			      uint32_t length, uint32_t * words, uint32_t words_size) {
+    uint32_t i = 0;
+#if defined(PORT_ENCODE_SSSE3)
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i plane[4];
+    __m128i rs_byte[4];
+    __m128i pick_high[LCD_PORT_WORDS];
+    __m128i pick_low[LCD_PORT_WORDS];
+    __m128i en_words[LCD_PORT_WORDS];
+    __m128i v, hi, lo, data_mode, h[4], l[4], high[4], low[4], a, b;
+    uint32_t * out;
+    uint8_t g;
+    uint8_t k;
+
+    for(k = 0; k < 4; k++) {
+	plane[k] = _mm_loadu_si128((const __m128i *)enc->plane[k]);
+	rs_byte[k] = _mm_set1_epi8((char)(enc->rs_mask >> (8 * k)));
+    }
+    for(k = 0; k < LCD_PORT_WORDS; k++) {
+	pick_high[k] = _mm_loadu_si128((const __m128i *)spread_high[k]);
+	pick_low[k] = _mm_loadu_si128((const __m128i *)spread_low[k]);
+	en_words[k] = _mm_and_si128(_mm_loadu_si128((const __m128i *)spread_en[k]), _mm_set1_epi32((int)enc->en_mask));
+    }
+#elif defined(PORT_ENCODE_NEON)
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0F);
+    uint8x16_t plane[4];
+    uint8x16_t rs_byte[4];
+    uint8x16_t pick[LCD_PORT_WORDS];
+    uint32x4_t en_words[LCD_PORT_WORDS];
+    uint8x16_t v, hi, lo, data_mode, h[4], l[4];
+    uint8x16x2_t z01, z23, pair[4];
+    uint16x8x2_t w;
+    uint32_t * out;
+    uint8_t g;
+    uint8_t k;
+
+    for(k = 0; k < 4; k++) {
+	plane[k] = vld1q_u8(enc->plane[k]);
+	rs_byte[k] = vdupq_n_u8((uint8_t)(enc->rs_mask >> (8 * k)));
+    }
+    for(k = 0; k < LCD_PORT_WORDS; k++) {
+	pick[k] = vld1q_u8(spread_pair[k]);
+	en_words[k] = vandq_u32(vld1q_u32(spread_en[k]), vdupq_n_u32(enc->en_mask));
+    }
+#endif
+
+    if((uint64_t)length * LCD_PORT_WORDS > words_size)
+	return 0;
+
+#if defined(PORT_ENCODE_SSSE3)
+    for(; i + 16 <= length; i += 16) {
+	v = _mm_loadu_si128((const __m128i *)&value[i]);
+	data_mode = _mm_xor_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&mode[i]), zero),
+				  _mm_set1_epi8(-1));
+	hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble_mask);
+	lo = _mm_and_si128(v, nibble_mask);
+
+	for(k = 0; k < 4; k++) {
+	    h[k] = _mm_or_si128(_mm_shuffle_epi8(plane[k], hi), _mm_and_si128(data_mode, rs_byte[k]));
+	    l[k] = _mm_or_si128(_mm_shuffle_epi8(plane[k], lo), _mm_and_si128(data_mode, rs_byte[k]));
+	}
+
+	// bytes 0-3 of the port word next to each other, 4 words per register
+	a = _mm_unpacklo_epi8(h[0], h[1]);
+	b = _mm_unpacklo_epi8(h[2], h[3]);
+	high[0] = _mm_unpacklo_epi16(a, b);
+	high[1] = _mm_unpackhi_epi16(a, b);
+	a = _mm_unpackhi_epi8(h[0], h[1]);
+	b = _mm_unpackhi_epi8(h[2], h[3]);
+	high[2] = _mm_unpacklo_epi16(a, b);
+	high[3] = _mm_unpackhi_epi16(a, b);
+
+	a = _mm_unpacklo_epi8(l[0], l[1]);
+	b = _mm_unpacklo_epi8(l[2], l[3]);
+	low[0] = _mm_unpacklo_epi16(a, b);
+	low[1] = _mm_unpackhi_epi16(a, b);
+	a = _mm_unpackhi_epi8(l[0], l[1]);
+	b = _mm_unpackhi_epi8(l[2], l[3]);
+	low[2] = _mm_unpacklo_epi16(a, b);
+	low[3] = _mm_unpackhi_epi16(a, b);
+
+	out = &words[LCD_PORT_WORDS * i];
+	for(g = 0; g < 4; g++) {
+	    for(k = 0; k < LCD_PORT_WORDS; k++) {
+		a = _mm_or_si128(_mm_shuffle_epi8(high[g], pick_high[k]), _mm_shuffle_epi8(low[g], pick_low[k]));
+		_mm_storeu_si128((__m128i *)out, _mm_or_si128(a, en_words[k]));
+		out += 4;
+	    }
+	}
+    }
+#elif defined(PORT_ENCODE_NEON)
+    for(; i + 16 <= length; i += 16) {
+	v = vld1q_u8(&value[i]);
+	data_mode = vtstq_u8(vld1q_u8(&mode[i]), vdupq_n_u8(0xFF));
+	hi = vshrq_n_u8(v, 4);
+	lo = vandq_u8(v, nibble_mask);
+
+	for(k = 0; k < 4; k++) {
+	    h[k] = vorrq_u8(vqtbl1q_u8(plane[k], hi), vandq_u8(data_mode, rs_byte[k]));
+	    l[k] = vorrq_u8(vqtbl1q_u8(plane[k], lo), vandq_u8(data_mode, rs_byte[k]));
+	}
+
+	// bytes 0-3 of the port word next to each other, 4 words per register, high and low words side by side
+	z01 = vzipq_u8(h[0], h[1]);
+	z23 = vzipq_u8(h[2], h[3]);
+	w = vzipq_u16(vreinterpretq_u16_u8(z01.val[0]), vreinterpretq_u16_u8(z23.val[0]));
+	pair[0].val[0] = vreinterpretq_u8_u16(w.val[0]);
+	pair[1].val[0] = vreinterpretq_u8_u16(w.val[1]);
+	w = vzipq_u16(vreinterpretq_u16_u8(z01.val[1]), vreinterpretq_u16_u8(z23.val[1]));
+	pair[2].val[0] = vreinterpretq_u8_u16(w.val[0]);
+	pair[3].val[0] = vreinterpretq_u8_u16(w.val[1]);
+
+	z01 = vzipq_u8(l[0], l[1]);
+	z23 = vzipq_u8(l[2], l[3]);
+	w = vzipq_u16(vreinterpretq_u16_u8(z01.val[0]), vreinterpretq_u16_u8(z23.val[0]));
+	pair[0].val[1] = vreinterpretq_u8_u16(w.val[0]);
+	pair[1].val[1] = vreinterpretq_u8_u16(w.val[1]);
+	w = vzipq_u16(vreinterpretq_u16_u8(z01.val[1]), vreinterpretq_u16_u8(z23.val[1]));
+	pair[2].val[1] = vreinterpretq_u8_u16(w.val[0]);
+	pair[3].val[1] = vreinterpretq_u8_u16(w.val[1]);
+
+	out = &words[LCD_PORT_WORDS * i];
+	for(g = 0; g < 4; g++) {
+	    for(k = 0; k < LCD_PORT_WORDS; k++) {
+		vst1q_u32(out, vorrq_u32(vreinterpretq_u32_u8(vqtbl2q_u8(pair[g], pick[k])), en_words[k]));
+		out += 4;
+	    }
+	}
+    }
+#endif
+
+    // fewer than 16 bytes left, or no shuffle instruction
+    lcd_port_encode_swar(enc, &value[i], &mode[i], length - i, &words[LCD_PORT_WORDS * i],
+			 words_size - LCD_PORT_WORDS * i);
+
+    return LCD_PORT_WORDS * length;
+}
+
+/*
+    @brief Name of the instructions lcd_port_encode_simd() was built with
+*/
+const char * lcd_port_encode_simd_name(void) {
+#if defined(PORT_ENCODE_SSSE3)
+    return "SSSE3 pshufb";
+#elif defined(PORT_ENCODE_NEON)
+    return "NEON tbl";
+#else
+    return "SWAR fallback";
+#endif
+}
+
+/*
+    @brief Function for writing the words of one byte, the order of lcd_encode_port_words()
+*/
+static void put_byte(const lcd_port_encoder_t * enc, uint32_t high, uint32_t low, uint32_t * words) {
+    words[0] = high; // register select settles before enable rises
+    words[1] = high | enc->en_mask;
+    words[2] = high;
+    words[3] = low | enc->en_mask;
+    words[4] = low;
+}
@@ -0,0 +1,98 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_port_encode.h
+
+  @Summary
+    Port word encoders for DMA playback on the host
+
+  @Description
+    The same encoding as lcd_encode_port_words(), LCD_PORT_WORDS words per
+    byte, written three ways for hosts that prepare large sequences for a
+    DMA or PIO engine, e.g. a Linux board feeding a peripheral. The scalar
+    version looks every nibble up in a table like the driver. The SWAR
+    version spreads the 4 data bits of both nibbles of a byte onto their
+    pins in one 64 bit multiply per bit, no table. The SIMD version looks
+    up 16 bytes at a time with one byte shuffle per byte of the port word,
+    pshufb on SSSE3 and tbl on AArch64 NEON, and falls back to SWAR when
+    neither is available.
+
+    The words only hold the bus pins, OR in the rest of the port. None of
+    the encoders touch the driver's register mirror, unlike
+    lcd_encode_port_words().
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_PORT_ENCODE_H
+#define LCD_PORT_ENCODE_H
+
+/*
+    @brief Port bits of the bus pins
+*/
+typedef struct {
+    uint32_t nibble_set[16]; // data pins set for every nibble
+    uint32_t pin[4]; // port bit of D4-D7
+    uint32_t rs_mask;
+    uint32_t en_mask; // enable pins of every panel taking part
+    uint8_t plane[4][16]; // byte n of nibble_set, the tables of the byte shuffles
+} lcd_port_encoder_t;
+
+/*
+    @brief Work out the port bits of the bus pins
+
+    @param[out] enc Encoder to set up
+
+    @param[in] rs Register select pin
+
+    @param[in] data D4-D7 pins
+
+    @param[in] en_mask Port bits of the enable pins
+
+    @return 0 if a pin is not on port 0
+*/
+uint8_t lcd_port_encoder_init(lcd_port_encoder_t * enc, uint32_t rs, const uint32_t data[4], uint32_t en_mask);
+
+/*
+    @brief Encode bytes with a table lookup per nibble, the way the driver does it
+
+    @param[in] enc Port bits of the bus pins
+
+    @param[in] value Bytes to send
+
+    @param[in] mode Register select for each byte, 0 for a command and 1 for data
+
+    @param[in] length Number of bytes
+
+    @param[out] words Port words, LCD_PORT_WORDS per byte
+
+    @param[in] words_size Number of words that fit in words
+
+    @return number of words written, 0 if they don't fit
+*/
+uint32_t lcd_port_encode_scalar(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+				uint32_t length, uint32_t * words, uint32_t words_size);
+
+/*
+    @brief Encode bytes with a multiply per data bit covering both nibbles, no table
+
+    @note same parameters and result as lcd_port_encode_scalar()
+*/
+uint32_t lcd_port_encode_swar(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+			      uint32_t length, uint32_t * words, uint32_t words_size);
+
+/*
+    @brief Encode bytes 16 at a time with byte shuffles, the tail and unsupported targets go through SWAR
+
+    @note same parameters and result as lcd_port_encode_scalar()
+*/
+uint32_t lcd_port_encode_simd(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+			      uint32_t length, uint32_t * words, uint32_t words_size);
+
+/*
+    @brief Name of the instructions lcd_port_encode_simd() was built with
+*/
+const char * lcd_port_encode_simd_name(void);
+
+#endif
@@ -0,0 +1,344 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_port_encode_bench.c
+
+  @Summary
+    Equivalence check and throughput of the port word encoders
+
+  @Description
+    For a few wirings, encodes every byte value as a command and as data
+    with lcd_encode_port_words() and checks the scalar, SWAR and SIMD
+    encoders give the same words, for the whole set and for every length up
+    to 48 so the SIMD tail is covered. The driver's words are then played
+    into a model of the controller's bus interface, which checks that
+    register select never changes while enable is high or in the same word
+    enable rises, and latches a nibble on every falling edge. The nibbles
+    must match what lcd_write_data() puts on the pins, recorded through the
+    shim's pin hook while the driver writes the same data bytes on the gpio
+    bus. Then times every encoder on a screen sized and a large buffer and
+    prints bytes per cycle (the TSC on x86, nanoseconds elsewhere) next to
+    the rate the 4 bit bus takes bytes at.
+
+    Build on the host with:
+      cc -O2 -mssse3 -I. -I../src -o lcd_port_encode_bench lcd_port_encode_bench.c lcd_port_encode.c nrf_shim.c \
+        ../src/lcd_16x2.c
+
+    Leave out -mssse3 to build the SWAR fallback, on AArch64 the NEON
+    version is always built.
+
+    Usage:
+      lcd_port_encode_bench [iterations]
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_16x2.h"
+#include "lcd_port_encode.h"
+#include "nrf_shim.h"
+#include "nrf_gpio.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define ALL_BYTES 512 // every value as a command, then as data
+#define BENCH_BYTES 4096
+
+typedef uint32_t (*encode_fn)(const lcd_port_encoder_t * enc, const uint8_t * value, const uint8_t * mode,
+			      uint32_t length, uint32_t * words, uint32_t words_size);
+
+typedef struct {
+    uint32_t rs;
+    uint32_t en;
+    uint32_t data[4];
+} wiring_t;
+
+static const wiring_t wirings[] = {
+    {1, 2, {3, 4, 5, 6}}, // the bench wiring
+    {31, 0, {17, 9, 26, 4}}, // scattered over every byte of the port
+    {8, 9, {24, 25, 26, 27}}
+};
+
+static const struct {
+    const char * name;
+    encode_fn encode;
+} encoders[] = {
+    {"scalar", lcd_port_encode_scalar},
+    {"swar", lcd_port_encode_swar},
+    {"simd", lcd_port_encode_simd}
+};
+
+#define ENCODERS (sizeof(encoders) / sizeof(*encoders))
+
+static uint8_t all_value[ALL_BYTES];
+static uint8_t all_mode[ALL_BYTES];
+static uint32_t driver_words[ALL_BYTES * LCD_PORT_WORDS];
+static uint32_t host_words[ALL_BYTES * LCD_PORT_WORDS];
+
+// nibbles the gpio bus latched, recorded by the pin hook
+static uint32_t hook_en;
+static uint32_t hook_en_level; // to see edges, the shim reports every write
+static uint32_t hook_rs;
+static uint32_t hook_data[4];
+static uint8_t hook_nibbles[ALL_BYTES * 2];
+static uint32_t hook_count;
+
+static uint8_t check_wiring(const wiring_t * wiring);
+static uint8_t check_protocol(const lcd_port_encoder_t * enc, const wiring_t * wiring);
+static void record_strobe(uint32_t pin_no, uint32_t value, uint64_t now_us);
+static void bench(const lcd_port_encoder_t * enc, uint32_t length, unsigned long iterations);
+static uint64_t cpu_ns(void);
+static uint64_t cycles(void);
+
+int main(int argc, char * argv[]) {
+    unsigned long iterations = 20000;
+    lcd_port_encoder_t enc;
+    uint8_t ok = 1;
+    size_t w;
+    uint32_t i;
+
+    if(argc > 1)
+	iterations = strtoul(argv[1], NULL, 0);
+    if(iterations == 0) {
+	fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+	return 1;
+    }
+
+    for(i = 0; i < ALL_BYTES; i++) {
+	all_value[i] = (uint8_t)i;
+	all_mode[i] = (uint8_t)(i >> 8);
+    }
+
+    for(w = 0; w < sizeof(wirings) / sizeof(*wirings); w++)
+	ok &= check_wiring(&wirings[w]);
+    printf("%s, %s\n\n", lcd_port_encode_simd_name(), ok ? "every encoder matches the driver" : "MISMATCH");
+
+    lcd_port_encoder_init(&enc, wirings[0].rs, wirings[0].data, (uint32_t)1 << wirings[0].en);
+    printf("| encoder | bytes | ns per byte | bytes per %s | x the 4 bit bus |\n",
+#if defined(__x86_64__) || defined(__i386__)
+	   "TSC cycle"
+#else
+	   "ns"
+#endif
+	  );
+    printf("|---|---|---|---|---|\n");
+    bench(&enc, 32, iterations * 32);
+    bench(&enc, BENCH_BYTES, iterations);
+
+    return ok ? 0 : 1;
+}
+
+/*
+    @brief Function for comparing every encoder with the driver for one wiring
+*/
+static uint8_t check_wiring(const wiring_t * wiring) {
+    lcd_port_encoder_t enc;
+    uint32_t expect;
+    uint32_t length;
+    uint32_t start;
+    uint8_t ok = 1;
+    size_t e;
+
+    lcd_init(wiring->rs, wiring->en, wiring->data[0], wiring->data[1], wiring->data[2], wiring->data[3]);
+    lcd_port_encoder_init(&enc, wiring->rs, wiring->data, (uint32_t)1 << wiring->en);
+    if(lcd_port_mask() != (enc.rs_mask | enc.pin[0] | enc.pin[1] | enc.pin[2] | enc.pin[3] | enc.en_mask)) {
+	printf("rs %" PRIu32 ": port mask differs from the driver\n", wiring->rs);
+	return 0;
+    }
+
+    expect = lcd_encode_port_words(all_value, all_mode, ALL_BYTES, driver_words, ALL_BYTES * LCD_PORT_WORDS);
+
+    for(e = 0; e < ENCODERS; e++) {
+	memset(host_words, 0xA5, sizeof(host_words));
+	if(encoders[e].encode(&enc, all_value, all_mode, ALL_BYTES, host_words, ALL_BYTES * LCD_PORT_WORDS) != expect
+	   || memcmp(host_words, driver_words, expect * sizeof(uint32_t)) != 0) {
+	    printf("rs %" PRIu32 ": %s differs from lcd_encode_port_words()\n", wiring->rs, encoders[e].name);
+	    ok = 0;
+	}
+
+	// every tail length at a few alignments
+	for(start = 0; start < 3; start++) {
+	    for(length = 1; length <= 48; length++) {
+		encoders[e].encode(&enc, &all_value[200 + start], &all_mode[200 + start], length, host_words,
+				   length * LCD_PORT_WORDS);
+		if(memcmp(host_words, &driver_words[(200 + start) * LCD_PORT_WORDS],
+			  length * LCD_PORT_WORDS * sizeof(uint32_t)) != 0) {
+		    printf("rs %" PRIu32 ": %s differs at %" PRIu32 " bytes from %" PRIu32 "\n", wiring->rs,
+			   encoders[e].name, length, 200 + start);
+		    ok = 0;
+		}
+	    }
+	}
+    }
+
+    return ok & check_protocol(&enc, wiring);
+}
+
+/*
+    @brief Function for playing the driver's words into a model of the bus interface and comparing with the gpio bus
+
+    @note the controller samples register select as enable rises and the data pins as it falls
+*/
+static uint8_t check_protocol(const lcd_port_encoder_t * enc, const wiring_t * wiring) {
+    uint32_t previous = 0;
+    uint32_t word;
+    uint32_t nibbles = 0;
+    uint32_t violations = 0;
+    uint32_t rs_at_rise = 0;
+    uint8_t nibble;
+    uint8_t want;
+    uint8_t ok = 1;
+    uint8_t bit;
+    uint32_t i;
+
+    for(i = 0; i < ALL_BYTES * LCD_PORT_WORDS; i++) {
+	word = driver_words[i];
+	if(!(previous & enc->en_mask) && (word & enc->en_mask)) {
+	    // tAS, register select must already have been there in the word before
+	    if((word ^ previous) & enc->rs_mask)
+		violations++;
+	    rs_at_rise = word & enc->rs_mask;
+	}
+	else if((previous & enc->en_mask) && (word & enc->en_mask) == 0) {
+	    if((word ^ previous) & (enc->rs_mask | enc->pin[0] | enc->pin[1] | enc->pin[2] | enc->pin[3]))
+		violations++; // tH, nothing else may move with the falling edge
+	    if((word & enc->rs_mask) != rs_at_rise)
+		violations++;
+
+	    nibble = 0;
+	    for(bit = 0; bit < 4; bit++)
+		if(word & enc->pin[bit])
+		    nibble |= 1 << bit;
+	    want = (nibbles & 1) ? (all_value[nibbles / 2] & 0x0F) : (all_value[nibbles / 2] >> 4);
+	    if(nibble != want || (rs_at_rise != 0) != (all_mode[nibbles / 2] != 0))
+		violations++;
+	    nibbles++;
+	}
+	else if((word & enc->en_mask) && ((word ^ previous) & enc->rs_mask)) {
+	    violations++; // register select moved while enable was high
+	}
+	previous = word;
+    }
+
+    if(violations != 0 || nibbles != ALL_BYTES * 2) {
+	printf("rs %" PRIu32 ": %" PRIu32 " timing or value violations in %" PRIu32 " strobes\n", wiring->rs, violations,
+	       nibbles);
+	ok = 0;
+    }
+
+    // the data bytes once more through lcd_write_data() on the gpio bus
+    hook_en = wiring->en;
+    hook_rs = wiring->rs;
+    memcpy(hook_data, wiring->data, sizeof(hook_data));
+    hook_count = 0;
+    hook_en_level = 0;
+    lcd_set_cursor(0, 0);
+    shim_set_pin_hook(record_strobe);
+    for(i = 0; i < 256; i++)
+	lcd_write_char((char)all_value[256 + i]);
+    shim_set_pin_hook(NULL);
+
+    for(i = 0; i < 512; i++) {
+	want = (i & 1) ? (all_value[256 + i / 2] & 0x0F) : (all_value[256 + i / 2] >> 4);
+	if(i >= hook_count || hook_nibbles[i] != want)
+	    break;
+    }
+    if(i != 512 || hook_count != 512) {
+	printf("rs %" PRIu32 ": the gpio bus latched %" PRIu32 " data nibbles, the first %" PRIu32 " match\n", wiring->rs,
+	       hook_count, i);
+	ok = 0;
+    }
+
+    return ok;
+}
+
+/*
+    @brief Function for latching a data nibble on every falling edge of enable while register select is high
+*/
+static void record_strobe(uint32_t pin_no, uint32_t value, uint64_t now_us) {
+    uint8_t nibble = 0;
+    uint8_t bit;
+
+    (void)now_us;
+    if(pin_no != hook_en)
+	return;
+    if(!hook_en_level || value || !nrf_gpio_pin_read(hook_rs) || hook_count == ALL_BYTES * 2) {
+	hook_en_level = value;
+	return;
+    }
+    hook_en_level = 0;
+
+    for(bit = 0; bit < 4; bit++)
+	if(nrf_gpio_pin_read(hook_data[bit]))
+	    nibble |= 1 << bit;
+    hook_nibbles[hook_count++] = nibble;
+}
+
+/*
+    @brief Function for timing every encoder on a buffer of random bytes
+*/
+static void bench(const lcd_port_encoder_t * enc, uint32_t length, unsigned long iterations) {
+    static uint8_t value[BENCH_BYTES];
+    static uint8_t mode[BENCH_BYTES];
+    static uint32_t words[BENCH_BYTES * LCD_PORT_WORDS];
+    const double bus_bytes_per_ns = 1.0 / (LCD_BYTE_US * 1000.0);
+    volatile uint32_t sink = 0;
+    uint64_t start_ns;
+    uint64_t start_cycles;
+    double ns;
+    double per_unit;
+    unsigned long i;
+    size_t e;
+
+    srand(1);
+    for(i = 0; i < length; i++) {
+	value[i] = (uint8_t)rand();
+	mode[i] = (rand() & 7) != 0; // mostly data, like a screen
+    }
+
+    for(e = 0; e < ENCODERS; e++) {
+	start_ns = cpu_ns();
+	start_cycles = cycles();
+	for(i = 0; i < iterations; i++) {
+	    encoders[e].encode(enc, value, mode, length, words, BENCH_BYTES * LCD_PORT_WORDS);
+	    sink += words[i % (length * LCD_PORT_WORDS)];
+	}
+	ns = (double)(cpu_ns() - start_ns) / ((double)iterations * length);
+#if defined(__x86_64__) || defined(__i386__)
+	per_unit = (double)iterations * length / (double)(cycles() - start_cycles);
+#else
+	(void)start_cycles;
+	per_unit = 1.0 / ns;
+#endif
+	printf("| %s | %" PRIu32 " | %.3f | %.2f | %.0f |\n", encoders[e].name, length, ns, per_unit,
+	       1.0 / ns / bus_bytes_per_ns);
+    }
+    (void)sink;
+}
+
+/*
+    @brief Function for reading the CPU time of the process in nanoseconds
+*/
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+    @brief Function for reading the time stamp counter, 0 where there is none
+*/
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,166 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_rt.c
+
+  @Summary
+    Real time setup of a Linux bus thread and latency histograms
+
+  @Description
+    Implements the thread setup with the Linux scheduling, affinity and
+    memory locking calls, and the histograms
+******************************************************************************/
+
+#define _GNU_SOURCE // pthread_setaffinity_np()
+
+#include "lcd_rt.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static void rt_prefault(uint32_t kb);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Apply real time settings to the calling thread
+
+    @note SCHED_FIFO and mlockall() need CAP_SYS_NICE and CAP_IPC_LOCK or root, a step that fails is reported and
+	  the rest are still applied
+
+    @param[in] config Settings
+
+    @param[in] log Stream for the report, NULL for none
+
+    @return 0 if any step failed
+*/
+uint8_t lcd_rt_apply(const lcd_rt_config_t * config, FILE * log) {
+    struct sched_param param;
+    cpu_set_t cpus;
+    uint8_t ok = 1;
+    int err;
+
+    // lock first so the prefaulted stack stays in memory
+    if(config->lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+	if(log != NULL)
+	    fprintf(log, "mlockall: %s\n", strerror(errno));
+	ok = 0;
+    }
+
+    if(config->prefault_kb != 0)
+	rt_prefault(config->prefault_kb);
+
+    if(config->cpu >= 0) {
+	CPU_ZERO(&cpus);
+	CPU_SET(config->cpu, &cpus);
+	err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	if(err != 0) {
+	    if(log != NULL)
+		fprintf(log, "affinity to cpu %d: %s\n", config->cpu, strerror(err));
+	    ok = 0;
+	}
+    }
+
+    if(config->priority > 0) {
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = config->priority;
+	err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if(err != 0) {
+	    if(log != NULL)
+		fprintf(log, "SCHED_FIFO priority %d: %s\n", config->priority, strerror(err));
+	    ok = 0;
+	}
+    }
+
+    return ok;
+}
+
+/*
+    @brief Add a value to a histogram
+
+    @param[in,out] hist Histogram
+
+    @param[in] value_us Value in microseconds
+*/
+void lcd_rt_hist_add(lcd_rt_hist_t * hist, uint64_t value_us) {
+    uint8_t bucket = 0;
+
+    while(bucket < LCD_RT_BUCKETS - 1 && (value_us >> bucket) != 0)
+	bucket++;
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum_us += value_us;
+    if(value_us > hist->max_us)
+	hist->max_us = value_us;
+}
+
+/*
+    @brief Get a percentile of a histogram
+
+    @param[in] hist Histogram
+
+    @param[in] per_mille Percentile in tenths of a percent, 500 for the median, 999 for p99.9
+
+    @return upper edge of the bucket holding the percentile, capped at the maximum
+*/
+uint64_t lcd_rt_hist_percentile(const lcd_rt_hist_t * hist, uint32_t per_mille) {
+    const uint64_t rank = (hist->count * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    uint64_t edge;
+    uint8_t bucket;
+
+    if(rank == 0)
+	return 0;
+
+    for(bucket = 0; bucket < LCD_RT_BUCKETS - 1; bucket++) {
+	seen += hist->buckets[bucket];
+	if(seen >= rank)
+	    break;
+    }
+
+    edge = ((uint64_t)1 << bucket) - 1;
+    return (edge > hist->max_us) ? hist->max_us : edge;
+}
+
+/*
+    @brief Write a histogram as text
+
+    @note one summary line with count, mean, p50, p99, p99.9 and max, then one line per bucket in use
+
+    @param[in] hist Histogram
+
+    @param[in] name Name on the summary line
+
+    @param[in] out Stream to write to
+*/
+void lcd_rt_hist_print(const lcd_rt_hist_t * hist, const char * name, FILE * out) {
+    uint8_t bucket;
+
+    fprintf(out, "%s: count %" PRIu64 " mean %.1f p50 %" PRIu64 " p99 %" PRIu64 " p99.9 %" PRIu64 " max %" PRIu64 " us\n",
+	    name, hist->count, hist->count ? (double)hist->sum_us / hist->count : 0.0, lcd_rt_hist_percentile(hist, 500),
+	    lcd_rt_hist_percentile(hist, 990), lcd_rt_hist_percentile(hist, 999), hist->max_us);
+
+    for(bucket = 0; bucket < LCD_RT_BUCKETS; bucket++)
+	if(hist->buckets[bucket] != 0)
+	    fprintf(out, "  < %" PRIu64 " us: %" PRIu64 "\n", (uint64_t)1 << bucket, hist->buckets[bucket]);
+}
+
+/*
+    @brief Function for touching the stack the thread will use, so it doesn't fault in the middle of a pulse
+*/
+static void rt_prefault(uint32_t kb) {
+    volatile uint8_t page[4096];
+    uint32_t i;
+
+    for(i = 0; i < sizeof(page); i += 64)
+	page[i] = 0;
+    if(kb > 4)
+	rt_prefault(kb - 4);
+    page[0]++; // keeps the frame alive across the call, so it can't become a loop reusing one page
+}
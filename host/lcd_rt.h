@@ -0,0 +1,95 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_rt.h
+
+  @Summary
+    Real time setup of a Linux bus thread and latency histograms
+
+  @Description
+    Bit banged timing on Linux is stretched by the scheduler: every enable
+    pulse wait that is preempted or page faults runs long. lcd_rt_apply()
+    moves the calling thread to SCHED_FIFO, pins it to a CPU, locks the
+    process's memory and touches the stack it will need, each step optional.
+    The histograms measure the result, log2 buckets in microseconds.
+******************************************************************************/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#ifndef LCD_RT_H
+#define LCD_RT_H
+
+#define LCD_RT_BUCKETS 33 // bucket n counts values of 2^(n-1) to 2^n - 1 microseconds
+
+/*
+    @brief Real time settings of a thread
+*/
+typedef struct {
+    int priority; // SCHED_FIFO priority 1-99, 0 to keep the normal scheduler
+    int cpu; // CPU to run on, -1 for any
+    uint8_t lock_memory; // mlockall() the current and future pages of the process
+    uint32_t prefault_kb; // stack to touch in advance, 0 for none
+} lcd_rt_config_t;
+
+/*
+    @brief Histogram of a time in microseconds
+*/
+typedef struct {
+    uint64_t buckets[LCD_RT_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+} lcd_rt_hist_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Apply real time settings to the calling thread
+
+    @note SCHED_FIFO and mlockall() need CAP_SYS_NICE and CAP_IPC_LOCK or root, a step that fails is reported and
+	  the rest are still applied
+
+    @param[in] config Settings
+
+    @param[in] log Stream for the report, NULL for none
+
+    @return 0 if any step failed
+*/
+uint8_t lcd_rt_apply(const lcd_rt_config_t * config, FILE * log);
+
+/*
+    @brief Add a value to a histogram
+
+    @param[in,out] hist Histogram
+
+    @param[in] value_us Value in microseconds
+*/
+void lcd_rt_hist_add(lcd_rt_hist_t * hist, uint64_t value_us);
+
+/*
+    @brief Get a percentile of a histogram
+
+    @param[in] hist Histogram
+
+    @param[in] per_mille Percentile in tenths of a percent, 500 for the median, 999 for p99.9
+
+    @return upper edge of the bucket holding the percentile, capped at the maximum
+*/
+uint64_t lcd_rt_hist_percentile(const lcd_rt_hist_t * hist, uint32_t per_mille);
+
+/*
+    @brief Write a histogram as text
+
+    @note one summary line with count, mean, p50, p99, p99.9 and max, then one line per bucket in use
+
+    @param[in] hist Histogram
+
+    @param[in] name Name on the summary line
+
+    @param[in] out Stream to write to
+*/
+void lcd_rt_hist_print(const lcd_rt_hist_t * hist, const char * name, FILE * out);
+
+#endif
@@ -0,0 +1,331 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_spidev.c
+
+  @Summary
+    Linux spidev transport for a panel behind a 74HC595 shift register
+
+  @Description
+    Implements the transport with SPI_IOC_MESSAGE, the shift register bytes
+    of a batch and the waits the LCD needs between them are collected and
+    sent as one chain of transfers
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_spidev.h"
+#include "lcd_16x2.h"
+#include "nrf_delay.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/spi/spidev.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// a whole flush plan, up to five transfers per LCD byte
+#define FRAME_SIZE ((LCD_PLAN_SIZE + 1) * 5)
+
+static int spi_fd = -1;
+static lcd_spidev_config_t spi_config;
+static spidev_ioctl_fn spi_ioctl = NULL;
+static uint8_t grouping = LCD_SPIDEV_PER_FRAME;
+static uint16_t exec_gap = 0; // delay that makes up the instruction time the next transfers don't cover
+static lcd_spidev_stats_t stats;
+
+static uint8_t frame[FRAME_SIZE]; // shift register bytes not sent yet
+static uint16_t frame_delay[FRAME_SIZE]; // delay before each byte is latched
+static uint16_t frame_length = 0;
+static uint8_t level = HC595_BACKLIGHT; // last byte, what the outputs show once the frame is out
+static uint16_t owed = 0; // wait the last LCD byte needs before the next enable strobe
+static uint8_t batch_open = 0; // the driver is sending a flush plan
+static uint8_t in_batch = 0; // bytes are held back until the batch is closed
+static uint8_t batch_used = 0; // the open batch carried something
+
+static struct spi_ioc_transfer xfers[LCD_SPIDEV_MAX_XFERS];
+
+static void spidev_send(uint8_t value, uint8_t mode);
+static void spidev_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode);
+static void spidev_batch(uint8_t open);
+static void emit_byte(uint8_t value, uint8_t rs, uint16_t wait_us);
+static void emit_wake(uint8_t nibble, uint32_t wait_us);
+static void frame_put(uint8_t bits);
+static void frame_send(void);
+static void spi_transfer(const uint8_t * data, const uint16_t * delay, uint16_t length);
+static int spi_call(unsigned long request, void * arg);
+
+static lcd_transport_t spidev_transport = {
+    spidev_send,
+    spidev_write_buffer,
+    41, // 4 bytes at 1MHz and the rest of the instruction time, set from the clock at init
+    spidev_batch
+};
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Open the controller and initialize the LCD behind the shift register
+
+    @note the panel is woken up in 4 bit mode by the transport, then the full initialization runs through
+	  lcd_init_transport(), the function sets it sends are turned into their 4 bit form
+
+    @param[in] path Controller, e.g. /dev/spidev0.0
+
+    @param[in] config Settings, copied
+
+    @return 0 if the controller could not be opened or set up
+*/
+uint8_t lcd_spidev_init(const char * path, const lcd_spidev_config_t * config) {
+    uint8_t spi_mode = SPI_MODE_0; // the 74HC595 shifts on the rising edge
+    uint8_t bits = 8;
+    uint32_t byte_ns;
+
+    spi_config = *config;
+    if(spi_config.max_xfers == 0 || spi_config.max_xfers > LCD_SPIDEV_MAX_XFERS)
+	spi_config.max_xfers = LCD_SPIDEV_MAX_XFERS;
+
+    spi_fd = open(path, O_RDWR);
+    if(spi_fd < 0)
+	return 0;
+
+    if(spi_call(SPI_IOC_WR_MODE, &spi_mode) < 0 || spi_call(SPI_IOC_WR_BITS_PER_WORD, &bits) < 0
+       || spi_call(SPI_IOC_WR_MAX_SPEED_HZ, &spi_config.speed_hz) < 0) {
+	lcd_spidev_close();
+	return 0;
+    }
+
+    // the next enable strobe is two transfers away, the delay covers the rest of the instruction time
+    byte_ns = 8000000000ull / spi_config.speed_hz / 1000;
+    exec_gap = (LCD_SPIDEV_EXEC_US * 1000 > 2 * byte_ns) ? (LCD_SPIDEV_EXEC_US * 1000 - 2 * byte_ns + 999) / 1000 : 0;
+    spidev_transport.byte_us = (4 * byte_ns + 999) / 1000 + exec_gap;
+
+    frame_length = 0;
+    in_batch = 0;
+    owed = 0;
+
+    // park with enable low and the backlight on, then wake the panel up in 4 bit mode with single nibbles,
+    // the waits are delays of the transfers so the whole sequence is one call
+    frame_put(HC595_BACKLIGHT);
+    emit_wake(0x03, LCD_POWER_UP_MS * 1000);
+    emit_wake(0x03, LCD_WAKE_MS * 1000);
+    emit_wake(0x03, LCD_WAKE_LAST_US);
+    emit_wake(0x02, LCD_WAKE_LAST_US);
+    owed = LCD_WAKE_LAST_US;
+    frame_send();
+
+    lcd_init_transport(&spidev_transport);
+    return 1;
+}
+
+/*
+    @brief Close the controller
+*/
+void lcd_spidev_close(void) {
+    if(spi_fd >= 0)
+	close(spi_fd);
+    spi_fd = -1;
+}
+
+/*
+    @brief Set how the transfers are grouped into syscalls
+
+    @param[in] mode LCD_SPIDEV_PER_BYTE, LCD_SPIDEV_PER_CALL or LCD_SPIDEV_PER_FRAME (the default)
+*/
+void lcd_spidev_grouping(uint8_t mode) {
+    frame_send();
+    grouping = mode;
+}
+
+/*
+    @brief Replace the ioctl used for every transfer
+
+    @param[in] fn Stand-in, NULL for ioctl()
+*/
+void lcd_spidev_set_ioctl(spidev_ioctl_fn fn) {
+    spi_ioctl = fn;
+}
+
+/*
+    @brief Read the traffic counters
+
+    @param[out] counters Counters
+
+    @param[in] reset 1 to start counting again from zero
+*/
+void lcd_spidev_stats(lcd_spidev_stats_t * counters, uint8_t reset) {
+    *counters = stats;
+    if(reset)
+	memset(&stats, 0, sizeof(stats));
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]***************************************/
+
+/*
+    @brief Function for sending a single byte through the shift register
+
+    @note the driver wakes the panel up with 8 bit function sets, the panel is already in 4 bit mode by then,
+	  clear and return home owe their longer execution time to the next byte
+*/
+static void spidev_send(uint8_t value, uint8_t mode) {
+    uint16_t wait_us = exec_gap;
+
+    if(!mode && (value & 0xE0) == LCD_FUNCTIONSET)
+	value &= ~LCD_8BITMODE;
+    if(!mode && value != 0 && (value & 0xFC) == 0)
+	wait_us = LCD_SPIDEV_CLEAR_US;
+
+    emit_byte(value, mode ? HC595_RS : 0, wait_us);
+    if(!in_batch)
+	frame_send();
+}
+
+/*
+    @brief Function for sending a burst of bytes to one LCD register
+*/
+static void spidev_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode) {
+    uint16_t i;
+
+    for(i = 0; i < length; i++)
+	emit_byte(data[i], mode ? HC595_RS : 0, exec_gap);
+    if(!in_batch)
+	frame_send();
+}
+
+/*
+    @brief Function for holding the bytes of a flush plan back and sending them as one chain
+*/
+static void spidev_batch(uint8_t open) {
+    if(open) {
+	batch_open = 1;
+	in_batch = (grouping == LCD_SPIDEV_PER_FRAME);
+	batch_used = 0;
+	return;
+    }
+
+    frame_send();
+    batch_open = 0;
+    in_batch = 0;
+    if(batch_used)
+	stats.frames++;
+}
+
+/*
+    @brief Function for encoding an LCD byte as shift register bytes
+
+    @note a byte only reaches the outputs when it is latched, after the delay of its transfer, so the wait the
+	  previous LCD byte owes goes on the first transfer of this one, before enable can fall again, register select
+	  gets a byte of its own only when it changes
+*/
+static void emit_byte(uint8_t value, uint8_t rs, uint16_t wait_us) {
+    const uint8_t high = (value & 0xF0) | rs | HC595_BACKLIGHT;
+    const uint8_t low = (uint8_t)(value << 4) | rs | HC595_BACKLIGHT;
+
+    if((level & HC595_RS) != rs)
+	frame_put(level ^ HC595_RS);
+
+    frame_put(high | HC595_EN);
+    frame_put(high);
+    frame_put(low | HC595_EN);
+    frame_put(low);
+    owed = wait_us;
+    stats.bytes++;
+}
+
+/*
+    @brief Function for strobing a single nibble to the instruction register during the wake up
+
+    @param[in] wait_us Time to wait before the strobe, up to the 65ms a transfer delay can hold
+*/
+static void emit_wake(uint8_t nibble, uint32_t wait_us) {
+    const uint8_t bits = (uint8_t)(nibble << 4) | HC595_BACKLIGHT;
+
+    owed = (wait_us > 0xFFFF) ? 0xFFFF : wait_us;
+    frame_put(bits | HC595_EN);
+    frame_put(bits);
+}
+
+/*
+    @brief Function for appending a shift register byte to the frame, with the wait owed so far as its delay
+
+    @note a full frame is sent early rather than dropping bytes
+*/
+static void frame_put(uint8_t bits) {
+    if(frame_length == FRAME_SIZE)
+	frame_send();
+    frame[frame_length] = bits;
+    frame_delay[frame_length] = owed;
+    frame_length++;
+    owed = 0;
+    level = bits;
+    batch_used |= batch_open;
+}
+
+/*
+    @brief Function for sending the frame with the grouping in use
+*/
+static void frame_send(void) {
+    uint16_t i;
+
+    if(grouping == LCD_SPIDEV_PER_BYTE) {
+	for(i = 0; i < frame_length; i++)
+	    spi_transfer(&frame[i], &frame_delay[i], 1);
+    }
+    else if(frame_length != 0) {
+	spi_transfer(frame, frame_delay, frame_length);
+    }
+    frame_length = 0;
+}
+
+/*
+    @brief Function for sending shift register bytes as chains of one byte transfers
+
+    @note every transfer but the last of a chain deselects the chip after its delay, the rising chip select latches the
+	  byte and the last one is latched when the chain ends. spidev takes up to LCD_SPIDEV_MAX_XFERS transfers and
+	  its bufsiz bytes per call, if it answers EMSGSIZE the chains are halved for good
+*/
+static void spi_transfer(const uint8_t * data, const uint16_t * delay, uint16_t length) {
+    uint16_t chunk;
+    uint16_t i;
+
+    while(length > 0) {
+	chunk = (length > spi_config.max_xfers) ? spi_config.max_xfers : length;
+
+	memset(xfers, 0, chunk * sizeof(xfers[0]));
+	for(i = 0; i < chunk; i++) {
+	    xfers[i].tx_buf = (uintptr_t)&data[i];
+	    xfers[i].len = 1;
+	    xfers[i].speed_hz = spi_config.speed_hz;
+	    xfers[i].bits_per_word = 8;
+	    xfers[i].delay_usecs = delay[i];
+	    xfers[i].cs_change = (i + 1 < chunk);
+	}
+
+	stats.syscalls++;
+	if(spi_call(SPI_IOC_MESSAGE(chunk), xfers) < 0) {
+	    stats.errors++;
+	    if(errno == EMSGSIZE && spi_config.max_xfers > 1) {
+		spi_config.max_xfers /= 2;
+		continue;
+	    }
+	    return; // the rest of the frame is dropped
+	}
+
+	stats.xfers += chunk;
+	data += chunk;
+	delay += chunk;
+	length -= chunk;
+    }
+}
+
+/*
+    @brief Function for an ioctl on the controller, through the stand-in if there is one
+*/
+static int spi_call(unsigned long request, void * arg) {
+    if(spi_ioctl != NULL)
+	return spi_ioctl(spi_fd, request, arg);
+    return ioctl(spi_fd, request, arg);
+}
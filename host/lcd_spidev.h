@@ -0,0 +1,118 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_spidev.h
+
+  @Summary
+    Linux spidev transport for a panel behind a 74HC595 shift register
+
+  @Description
+    Drives a panel wired to a 74HC595 from a Linux board through
+    /dev/spidevB.C, with the register's latch clock on chip select. Every
+    state of the LCD pins is one byte shifted in and latched by chip select
+    going high, so an LCD byte is four or five transfers and the LCD's
+    execution time has to pass between them. The transport describes a whole
+    flush plan as a chain of one byte transfers, cs_change latching each one
+    and delay_usecs holding the bus for the instruction time, and hands the
+    chain to the kernel with one SPI_IOC_MESSAGE ioctl, so no sleep is made
+    in user space between bytes.
+
+    The ioctl can be replaced, e.g. by a stand-in that decodes the transfers
+    into the HD44780 simulator instead of talking to a controller.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_SPIDEV_H
+#define LCD_SPIDEV_H
+
+// 74HC595 outputs, D4-D7 on Q4-Q7
+#ifndef HC595_RS
+#define HC595_RS 0x01
+#endif
+#ifndef HC595_EN
+#define HC595_EN 0x04
+#endif
+#ifndef HC595_BACKLIGHT
+#define HC595_BACKLIGHT 0x08
+#endif
+
+#define LCD_SPIDEV_MAX_XFERS 511 // transfers that fit the size field of SPI_IOC_MESSAGE
+#define LCD_SPIDEV_EXEC_US 37 // instruction time between two bytes
+#define LCD_SPIDEV_CLEAR_US 1520 // clear and return home
+
+// how the transfers are grouped into syscalls
+#define LCD_SPIDEV_PER_BYTE 0 // one ioctl per shift register byte
+#define LCD_SPIDEV_PER_CALL 1 // one ioctl per call from the driver
+#define LCD_SPIDEV_PER_FRAME 2 // one ioctl per flush plan
+
+/*
+    @brief Stand-in for ioctl(), same arguments and return value
+*/
+typedef int (*spidev_ioctl_fn)(int fd, unsigned long request, void * arg);
+
+/*
+    @brief Controller settings
+*/
+typedef struct {
+    uint32_t speed_hz; // SPI clock
+    uint16_t max_xfers; // transfers per ioctl, 0 for LCD_SPIDEV_MAX_XFERS
+} lcd_spidev_config_t;
+
+/*
+    @brief Counters of the traffic since the last reset
+*/
+typedef struct {
+    uint64_t frames; // batches sent
+    uint64_t syscalls; // ioctl calls, failed ones included
+    uint64_t xfers; // transfers, each one latched byte
+    uint64_t bytes; // LCD bytes
+    uint64_t errors; // failed calls
+} lcd_spidev_stats_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Open the controller and initialize the LCD behind the shift register
+
+    @note the panel is woken up in 4 bit mode by the transport, then the full initialization runs through
+	  lcd_init_transport(), the function sets it sends are turned into their 4 bit form
+
+    @param[in] path Controller, e.g. /dev/spidev0.0
+
+    @param[in] config Settings, copied
+
+    @return 0 if the controller could not be opened or set up
+*/
+uint8_t lcd_spidev_init(const char * path, const lcd_spidev_config_t * config);
+
+/*
+    @brief Close the controller
+*/
+void lcd_spidev_close(void);
+
+/*
+    @brief Set how the transfers are grouped into syscalls
+
+    @param[in] mode LCD_SPIDEV_PER_BYTE, LCD_SPIDEV_PER_CALL or LCD_SPIDEV_PER_FRAME (the default)
+*/
+void lcd_spidev_grouping(uint8_t mode);
+
+/*
+    @brief Replace the ioctl used for every transfer
+
+    @param[in] fn Stand-in, NULL for ioctl()
+*/
+void lcd_spidev_set_ioctl(spidev_ioctl_fn fn);
+
+/*
+    @brief Read the traffic counters
+
+    @param[out] counters Counters
+
+    @param[in] reset 1 to start counting again from zero
+*/
+void lcd_spidev_stats(lcd_spidev_stats_t * counters, uint8_t reset);
+
+#endif
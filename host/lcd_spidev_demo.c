@@ -0,0 +1,241 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_spidev_demo.c
+
+  @Summary
+    Syscalls and throughput of the spidev transport
+
+  @Description
+    Initializes the LCD behind a 74HC595 through lcd_spidev.c and sends the
+    same frames with each grouping of transfers into syscalls, then prints
+    the syscalls and transfers per frame and the LCD bytes per second. Given
+    /dev/spidevB.C it drives a real panel. Otherwise the ioctl is replaced by
+    a stand-in controller that decodes every chain of transfers into the
+    HD44780 simulator on the virtual clock of the host shim, checks what the
+    panel shows and counts strobes that came while it was busy. The stand-in
+    times the shifting and the transfer delays only, -s adds a cost per
+    syscall in microseconds, 10 by default, and -x gives it a limit on the
+    transfers per call.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_spidev_demo lcd_spidev_demo.c lcd_spidev.c hd44780_sim.c nrf_shim.c ../src/lcd_16x2.c
+    and on the board, where the delays have to be real, with:
+      cc -O2 -DSPIDEV_BOARD -I. -I../src -o lcd_spidev_demo lcd_spidev_demo.c lcd_spidev.c lcd_mmio.c hd44780_sim.c \
+        ../src/lcd_16x2.c -lpthread
+
+    Usage:
+      lcd_spidev_demo [-k spi hz] [-s syscall us] [-x max transfers] [-f frames] [/dev/spidev0.0]
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "lcd_16x2.h"
+#include "lcd_spidev.h"
+#include "hd44780_sim.h"
+#ifndef SPIDEV_BOARD
+#include "nrf_shim.h"
+#endif
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/spi/spidev.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static hd44780_sim_t sim;
+#ifndef SPIDEV_BOARD
+static uint32_t syscall_us = 10; // cost of a call on the stand-in
+static uint32_t controller_xfers = LCD_SPIDEV_MAX_XFERS; // limit of the stand-in controller
+static uint8_t outputs = HC595_BACKLIGHT; // latched shift register outputs
+static uint64_t bus_ns = 0; // bus time not yet added to the virtual clock
+
+static int controller_ioctl(int fd, unsigned long request, void * arg);
+#endif
+static uint64_t clock_us(void);
+static void draw(uint32_t frame, char text[2][17]);
+
+int main(int argc, char * argv[]) {
+    static const char * const names[3] = {"per byte", "per call", "per frame"};
+    lcd_spidev_config_t config = {1000000, 0};
+    lcd_spidev_stats_t stats;
+    const char * device = "/dev/null";
+    uint32_t frames = 100;
+    uint32_t frame;
+    uint64_t start_us;
+    uint64_t elapsed_us;
+    uint8_t grouping;
+    uint8_t fake;
+    uint8_t ok = 1;
+    char text[2][17];
+    char line[17];
+    int opt;
+
+    while((opt = getopt(argc, argv, "k:s:x:f:")) != -1) {
+	switch(opt) {
+	case 'k': config.speed_hz = strtoul(optarg, NULL, 0); break;
+#ifndef SPIDEV_BOARD
+	case 's': syscall_us = strtoul(optarg, NULL, 0); break;
+	case 'x': controller_xfers = strtoul(optarg, NULL, 0); break;
+#endif
+	case 'f': frames = strtoul(optarg, NULL, 0); break;
+	default:
+	    fprintf(stderr, "usage: %s [-k spi hz] [-s syscall us] [-x max transfers] [-f frames] [/dev/spidev0.0]\n",
+		    argv[0]);
+	    return 1;
+	}
+    }
+#ifdef SPIDEV_BOARD
+    fake = 0;
+#else
+    fake = optind >= argc;
+#endif
+    if(optind < argc)
+	device = argv[optind];
+
+    if(fake) {
+	if(!hd44780_sim_init(&sim, 1)) {
+	    fprintf(stderr, "out of memory\n");
+	    return 1;
+	}
+#ifndef SPIDEV_BOARD
+	lcd_spidev_set_ioctl(controller_ioctl);
+#endif
+    }
+
+    if(!lcd_spidev_init(device, &config)) {
+	fprintf(stderr, "%s: cannot open or set up\n", device);
+	return 1;
+    }
+    lcd_write_combine_on();
+
+    printf("| grouping | syscalls/frame | transfers/frame | us/frame | LCD bytes/s |\n");
+    printf("|---|---|---|---|---|\n");
+
+    for(grouping = LCD_SPIDEV_PER_BYTE; grouping <= LCD_SPIDEV_PER_FRAME; grouping++) {
+	lcd_spidev_grouping(grouping);
+	lcd_spidev_stats(&stats, 1);
+	start_us = clock_us();
+
+	for(frame = 0; frame < frames; frame++)
+	    draw(frame, text);
+
+	elapsed_us = clock_us() - start_us;
+	lcd_spidev_stats(&stats, 0);
+	if(stats.frames == 0)
+	    stats.frames = 1;
+	printf("| %s | %.1f | %.1f | %.0f | %.0f |\n", names[grouping], (double)stats.syscalls / stats.frames,
+	       (double)stats.xfers / stats.frames, (double)elapsed_us / stats.frames,
+	       elapsed_us ? stats.bytes * 1e6 / elapsed_us : 0.0);
+	if(stats.errors != 0)
+	    printf("  %" PRIu64 " failed calls, the chains were shortened\n", stats.errors);
+    }
+
+    lcd_spidev_close();
+
+    if(fake) {
+	hd44780_sim_line(&sim, 0, 0, 16, line);
+	ok &= strcmp(line, text[0]) == 0;
+	printf("row 0: \"%s\"\n", line);
+	hd44780_sim_line(&sim, 0, 1, 16, line);
+	ok &= strcmp(line, text[1]) == 0;
+	printf("row 1: \"%s\"\n", line);
+	printf("strobes %" PRIu32 ", while busy %" PRIu32 "\n", sim.strobes[0], sim.busy_strobes[0]);
+	ok &= sim.busy_strobes[0] == 0;
+	hd44780_sim_free(&sim);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/*
+    @brief Function for drawing one frame, a counter and a bar that both change every frame
+*/
+static void draw(uint32_t frame, char text[2][17]) {
+    uint8_t i;
+
+    snprintf(text[0], 17, "frame %-10" PRIu32, frame);
+    for(i = 0; i < 16; i++)
+	text[1][i] = (i <= frame % 17 && frame % 17 != 0) ? '#' : '.';
+    text[1][16] = '\0';
+
+    lcd_set_cursor(0, 0);
+    lcd_write_string(text[0]);
+    lcd_set_cursor(0, 1);
+    lcd_write_string(text[1]);
+    lcd_flush();
+}
+
+/*
+    @brief Function for reading the virtual clock, or the wall clock on a board
+*/
+static uint64_t clock_us(void) {
+#ifdef SPIDEV_BOARD
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+    return shim_now_us;
+#endif
+}
+
+#ifndef SPIDEV_BOARD
+/*
+    @brief Function standing in for a controller, decodes the transfers into the simulator
+
+    @note a transfer shifts its bytes at the clock rate and then waits its delay, the last byte is latched when chip
+	  select rises, after a transfer with cs_change and at the end of the chain, and a panel strobe is made when
+	  that drops enable
+*/
+static int controller_ioctl(int fd, unsigned long request, void * arg) {
+    const struct spi_ioc_transfer * xfer = arg;
+    uint32_t count;
+    uint32_t t;
+    uint32_t total = 0;
+    uint8_t latch;
+    uint8_t rs;
+    uint8_t nibble;
+    uint8_t bits;
+
+    (void)fd;
+
+    if(request == SPI_IOC_WR_MODE || request == SPI_IOC_WR_BITS_PER_WORD || request == SPI_IOC_WR_MAX_SPEED_HZ)
+	return 0;
+    if(_IOC_TYPE(request) != SPI_IOC_MAGIC || _IOC_NR(request) != 0 || _IOC_DIR(request) != _IOC_WRITE) {
+	errno = ENOTTY;
+	return -1;
+    }
+
+    count = _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer);
+    shim_now_us += syscall_us;
+    if(count > controller_xfers) {
+	errno = EMSGSIZE;
+	return -1;
+    }
+
+    for(t = 0; t < count; t++) {
+	bus_ns += xfer[t].len * 8000000000ull / xfer[t].speed_hz + xfer[t].delay_usecs * 1000ull;
+	total += xfer[t].len;
+
+	latch = xfer[t].cs_change || t + 1 == count;
+	if(!latch || xfer[t].len == 0)
+	    continue;
+
+	bits = ((const uint8_t *)(uintptr_t)xfer[t].tx_buf)[xfer[t].len - 1];
+	if((outputs & HC595_EN) && !(bits & HC595_EN)) {
+	    rs = (bits & HC595_RS) != 0;
+	    nibble = bits >> 4;
+	    hd44780_sim_strobe(&sim, 0, 1, &rs, &nibble, shim_now_us + bus_ns / 1000);
+	}
+	outputs = bits;
+    }
+
+    shim_now_us += bus_ns / 1000;
+    bus_ns %= 1000;
+    return (int)total;
+}
+#endif
@@ -0,0 +1,250 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_st7032_demo.c
+
+  @Summary
+    ST7032 transport against a model of the serial controller
+
+  @Description
+    Runs lcd_st7032.c on the host with i2c_write() replaced by a model of the
+    ST7032 serial interface: control bytes with the Co and RS flags, the IS
+    bit of function set and the extended instruction table, which the model
+    keeps for itself (bias/osc, contrast, power/icon and follower). Every
+    other byte goes to the HD44780 simulator at the time its 9th clock ends
+    on the virtual clock of the host shim. The simulator's busy counter uses
+    HD44780 times, so the model checks the ST7032 times itself, 26.3us for
+    an instruction and 1.08ms for clear and home. Sets the module up, draws,
+    changes contrast and booster and draws again, then checks the registers,
+    what the panel shows and that no byte arrived while the controller was
+    busy. Fails at 400kHz, which is why i2c_init() defaults to 250kHz.
+
+    Build on the host with:
+      cc -O2 -I. -I../src -o lcd_st7032_demo lcd_st7032_demo.c hd44780_sim.c nrf_shim.c ../src/lcd_st7032.c \
+        ../src/lcd_16x2.c
+
+    Usage:
+      lcd_st7032_demo [bus hz]
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "lcd_i2c.h"
+#include "lcd_st7032.h"
+#include "hd44780_sim.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ST7032_EXEC_NS 26300 // instruction and data write time at the nominal oscillator
+#define ST7032_CLEAR_NS 1080000 // clear display and return home
+
+static hd44780_sim_t sim;
+static uint32_t bus_hz = 0; // 0 until i2c_init(), I2C_FREQ_DEFAULT when not given
+static uint64_t bus_ns = 0; // bus time not yet added to the virtual clock
+static uint64_t i2c_bytes = 0; // bytes on the bus, address bytes included
+
+// the controller
+static uint8_t st_is = 0; // extended instruction table selected
+static uint8_t st_bias = 0; // 4 or 5 for 1/4 or 1/5, 0 until set
+static uint8_t st_osc = 0; // F2..F0
+static uint8_t st_contrast = 0; // C5..C0
+static uint8_t st_power = 0; // Ion and Bon
+static uint8_t st_follower = 0; // Fon and Rab2..0
+static uint64_t st_busy_ns = 0; // time the last instruction finishes
+static uint32_t st_bytes = 0; // bytes that reached the controller
+static uint32_t st_busy = 0; // bytes that arrived while busy
+
+static void st7032_byte(uint8_t rs, uint8_t value, uint64_t now_ns);
+static uint8_t check(const char * row0, const char * row1);
+static uint8_t check_registers(uint8_t contrast, uint8_t booster);
+
+int main(int argc, char * argv[]) {
+    static const char * const text[2] = {"ST7032 over I2C", "0123456789ABCDEF"};
+    uint64_t start;
+    uint8_t ok = 1;
+
+    if(argc > 1)
+	bus_hz = strtoul(argv[1], NULL, 0);
+    if(!hd44780_sim_init(&sim, 1)) {
+	fprintf(stderr, "usage: %s [bus hz]\n", argv[0]);
+	return 1;
+    }
+
+    i2c_init(0, 0, bus_hz);
+    printf("bus %" PRIu32 " Hz, %.2f us per I2C byte\n", bus_hz, 9 * 1e6 / bus_hz);
+
+    start = shim_now_us;
+    lcd_st7032_init(ST7032_ADDRESS, 40, 1);
+    printf("init: %" PRIu64 " I2C bytes in %" PRIu64 " us\n", i2c_bytes, shim_now_us - start);
+    ok &= check_registers(40, 1);
+
+    lcd_set_cursor(0, 0);
+    lcd_write_string((char *)text[0]);
+    lcd_set_cursor(0, 1);
+    lcd_write_string((char *)text[1]);
+    ok &= check(text[0], text[1]);
+
+    // the extended table must not disturb the address counter or the driver's mirror of it
+    lcd_st7032_set_contrast(20);
+    lcd_st7032_set_booster(0);
+    ok &= check_registers(20, 0);
+    lcd_set_cursor(0, 1);
+    lcd_write_string("contrast 20");
+    ok &= check(text[0], "contrast 20BCDEF");
+
+    // both lines as single runs through the flush plan
+    lcd_clear();
+    lcd_write_combine_on();
+    lcd_set_cursor(0, 0);
+    lcd_write_string((char *)text[1]);
+    lcd_set_cursor(0, 1);
+    lcd_write_string((char *)text[0]);
+    lcd_flush();
+    lcd_write_combine_off();
+    ok &= check(text[1], text[0]);
+
+    printf("controller bytes %" PRIu32 ", while busy %" PRIu32 "\n", st_bytes, st_busy);
+    ok &= st_busy == 0;
+    hd44780_sim_free(&sim);
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/*
+    @brief Function for comparing what the panel shows with the text drawn, blank padded to 16 characters
+*/
+static uint8_t check(const char * row0, const char * row1) {
+    const char * const want[2] = {row0, row1};
+    char line[17];
+    char padded[17];
+    uint8_t ok = 1;
+    uint8_t row;
+
+    for(row = 0; row < 2; row++) {
+	snprintf(padded, sizeof(padded), "%-16s", want[row]);
+	hd44780_sim_line(&sim, 0, row, 16, line);
+	if(strcmp(line, padded) != 0) {
+	    printf("  row %u shows \"%s\", expected \"%s\"\n", row, line, padded);
+	    ok = 0;
+	}
+    }
+    return ok;
+}
+
+/*
+    @brief Function for comparing the extended registers with the settings asked for, and the table with table 0
+*/
+static uint8_t check_registers(uint8_t contrast, uint8_t booster) {
+    uint8_t ok = 1;
+
+    printf("  bias 1/%u, osc %u, contrast %u, power/icon 0x%02X, follower 0x%02X, table %u\n", st_bias, st_osc,
+	   st_contrast, st_power, st_follower, st_is);
+
+    // the modules are made for 1/5 bias, the datasheet's default oscillator setting
+    ok &= st_bias == 5;
+    ok &= st_osc == 4;
+    ok &= st_contrast == contrast;
+    ok &= st_power == (booster ? ST7032_BOOSTERON : 0);
+    ok &= st_follower == ((ST7032_FOLLOWERON | ST7032_FOLLOWER_GAIN) & 0x0F);
+    ok &= st_is == 0; // the driver only speaks table 0
+    if(!ok)
+	printf("  registers differ from contrast %u, booster %u\n", contrast, booster);
+    return ok;
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function standing in for lcd_i2c.c, sets the bus rate of the model
+*/
+void i2c_init(uint32_t scl, uint32_t sda, uint32_t frequency) {
+    (void)scl;
+    (void)sda;
+    bus_hz = frequency ? frequency : I2C_FREQ_DEFAULT;
+}
+
+/*
+    @brief Function standing in for lcd_i2c.c, the bus rate of the model
+*/
+uint32_t i2c_frequency(void) {
+    return bus_hz;
+}
+
+/*
+    @brief Function standing in for lcd_i2c.c, feeds a write transaction to the controller model
+
+    @note the first byte after the address is a control byte, with Co set only the next byte is covered and another
+	  control byte follows it, with Co clear every byte up to the stop goes to the register picked by RS
+*/
+void i2c_write(uint8_t address, const uint8_t * data, uint8_t length) {
+    uint8_t control = 1; // next byte is a control byte
+    uint8_t co = 0;
+    uint8_t rs = 0;
+    uint8_t i;
+
+    i2c_bytes += 1 + length;
+    bus_ns += 10 * 1000000000ull / bus_hz;
+
+    for(i = 0; i < length; i++) {
+	bus_ns += 9 * 1000000000ull / bus_hz;
+	if(address != ST7032_ADDRESS)
+	    continue; // nobody acknowledges
+
+	if(control) {
+	    co = (data[i] & ST7032_CONTROL_CONTINUE) != 0;
+	    rs = (data[i] & ST7032_CONTROL_DATA) != 0;
+	    control = 0;
+	}
+	else {
+	    st7032_byte(rs, data[i], shim_now_us * 1000 + bus_ns);
+	    control = co;
+	}
+    }
+
+    bus_ns += 1000000000ull / bus_hz;
+    shim_now_us += bus_ns / 1000;
+    bus_ns %= 1000;
+}
+
+/*
+    @brief Function for a byte reaching the controller, table 1 instructions stay in the model
+*/
+static void st7032_byte(uint8_t rs, uint8_t value, uint64_t now_ns) {
+    uint64_t exec = ST7032_EXEC_NS;
+
+    st_bytes++;
+    if(now_ns < st_busy_ns)
+	st_busy++;
+
+    if(!rs && (value & 0xE0) == LCD_FUNCTIONSET)
+	st_is = value & ST7032_INSTRUCTION_SET;
+
+    if(!rs && st_is && (value & 0xF0) == ST7032_BIASOSC) {
+	st_bias = (value & 0x08) ? 4 : 5; // BS
+	st_osc = value & 0x07;
+    }
+    else if(!rs && st_is && (value & 0xF0) == ST7032_POWERICON) {
+	st_power = value & (ST7032_ICONON | ST7032_BOOSTERON);
+	st_contrast = (st_contrast & 0x0F) | ((value & 0x03) << 4);
+    }
+    else if(!rs && st_is && (value & 0xF0) == ST7032_FOLLOWER) {
+	st_follower = value & 0x0F;
+    }
+    else if(!rs && st_is && (value & 0xF0) == ST7032_CONTRASTLOW) {
+	st_contrast = (st_contrast & 0x30) | (value & 0x0F);
+    }
+    else if(!rs && st_is && (value & 0xF0) == 0x40) {
+	// icon RAM address, no icons on these modules
+    }
+    else {
+	if(!rs && (value == LCD_CLEARDISPLAY || (value & 0xFE) == LCD_RETURNHOME))
+	    exec = ST7032_CLEAR_NS;
+	hd44780_sim_byte(&sim, 0, rs, value, now_ns / 1000);
+    }
+
+    st_busy_ns = now_ns + exec;
+}
@@ -0,0 +1,280 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_warm_demo.c
+
+  @Summary
+    Warm restart against the HD44780 simulator on the host
+
+  @Description
+    Runs lcd_warm_init() against the host shim with the pin writes fed into
+    the HD44780 simulator, which keeps its DDRAM and CGRAM across the reset
+    like a panel that stayed powered. The shadow is built into its own
+    section, as on the target, so the demo can damage it the way a reset
+    can.
+
+    A screen with a custom character is drawn and sealed, and the reset
+    leaves the controller halfway through a byte. With the shadow intact the
+    warm start has to return 1, send no clear and no data byte, and never
+    change the glass. Drawing the next screen through lcd_flush() then has
+    to send a data byte only for each cell that differs from the retained
+    image, and setting up the same custom character again sends nothing.
+
+    Then the shadow is broken three ways: a write after the last seal, a
+    bit flipped in the retained RAM so only the Fletcher-16 checksum can
+    tell, and RAM cleared by a cold power up. Each time lcd_warm_init() has
+    to return 0 and fall back to a full initialization with a clear. The
+    bytes and the bus time of every case are printed.
+
+    Build on the host with:
+      cc -O2 -DLCD_RETAINED_SECTION=\"lcd_retained\" -I. -I../src -o lcd_warm_demo lcd_warm_demo.c hd44780_sim.c \
+        nrf_shim.c ../src/lcd_16x2.c
+
+    The section name has to be a C identifier, the GNU and LLVM linkers then
+    provide __start_lcd_retained and __stop_lcd_retained around it.
+
+    Usage:
+      lcd_warm_demo
+******************************************************************************/
+
+#include "lcd_16x2.h"
+#include "hd44780_sim.h"
+#include "nrf_shim.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// pins of the demo wiring, all on port 0
+#define PIN_RS 1
+#define PIN_EN 2
+#define PIN_D4 3
+#define PIN_D5 4
+#define PIN_D6 5
+#define PIN_D7 6
+
+#define WARM_PINS PIN_RS, PIN_EN, PIN_D4, PIN_D5, PIN_D6, PIN_D7
+
+// the retained RAM holding the shadow
+extern uint8_t __start_lcd_retained[];
+extern uint8_t __stop_lcd_retained[];
+
+typedef enum {
+    DAMAGE_NONE,
+    DAMAGE_UNSEALED, // drawn after the last lcd_retain()
+    DAMAGE_BIT_FLIP, // one bit of the retained RAM flipped
+    DAMAGE_COLD // retained RAM cleared, power was lost
+} damage_t;
+
+static const char * const damage_names[4] = {"shadow intact", "drawn after the seal", "bit flipped",
+					     "cold power up"};
+static const uint8_t bell[8] = {0x04, 0x0E, 0x0E, 0x0E, 0x1F, 0x00, 0x04, 0x00};
+static const char screen_a[2][17] = {"Temp  21.5 C   \x01", "Set   22.0 C    "};
+static const char screen_b[2][17] = {"Temp  21.7 C   \x01", "Set   22.5 C    "};
+
+static hd44780_sim_t sim;
+static uint8_t sim_en_level = 0; // to see falling edges, the shim reports every write
+
+// what the controller took in since capture_start()
+static uint8_t glass[2][17]; // what the glass showed when the capture started
+static uint32_t strobes = 0;
+static uint32_t commands = 0;
+static uint32_t data_bytes = 0;
+static uint32_t clears = 0;
+static uint32_t glass_changed = 0; // strobes after which the glass differed from the start
+static uint8_t watch_glass = 0; // check the glass after every strobe
+
+static void capture_start(uint8_t watch);
+static void draw(const char screen[2][17]);
+static uint8_t shows(const char screen[2][17]);
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us);
+
+int main(void) {
+    uint64_t start_us;
+    uint8_t result;
+    uint8_t ok;
+    int fail = 0;
+    uint32_t diff;
+    uint8_t row;
+    uint8_t col;
+    damage_t damage;
+
+    if(!hd44780_sim_init(&sim, 1))
+	return 1;
+
+    shim_set_pin_hook(sim_pin);
+    lcd_init(WARM_PINS);
+    lcd_create_char(1, bell);
+    draw(screen_a);
+    lcd_retain();
+
+    printf("%-22s %7s %8s %9s %11s %7s %10s\n", "case", "result", "strobes", "commands", "data bytes", "clears",
+	   "bus us");
+    for(damage = DAMAGE_NONE; damage <= DAMAGE_COLD; damage++) {
+	if(damage == DAMAGE_UNSEALED) {
+	    lcd_set_cursor(0, 1);
+	    lcd_write_string("Off ");
+	}
+	else if(damage == DAMAGE_BIT_FLIP)
+	    __start_lcd_retained[(__stop_lcd_retained - __start_lcd_retained) / 2] ^= 0x10;
+	else if(damage == DAMAGE_COLD)
+	    memset(__start_lcd_retained, 0, __stop_lcd_retained - __start_lcd_retained);
+
+	// the reset came between the two nibbles of a byte
+	pin_write(PIN_RS, 0);
+	lcd_write_data(0x08);
+
+	capture_start(damage == DAMAGE_NONE);
+	start_us = shim_now_us;
+	result = lcd_warm_init(WARM_PINS);
+	printf("%-22s %7u %8" PRIu32 " %9" PRIu32 " %11" PRIu32 " %7" PRIu32 " %10" PRIu64 "\n", damage_names[damage],
+	       result, strobes, commands, data_bytes, clears, shim_now_us - start_us);
+
+	if(damage == DAMAGE_NONE) {
+	    ok = result == 1 && clears == 0 && data_bytes == 0 && glass_changed == 0 && shows(screen_a);
+	    if(!ok)
+		printf("  the warm start touched the glass, %" PRIu32 " strobes changed it\n", glass_changed);
+	}
+	else {
+	    ok = result == 0 && clears != 0 && shim_now_us - start_us >= LCD_POWER_UP_MS * 1000;
+	    if(!ok)
+		printf("  the damaged shadow was trusted\n");
+	}
+	if(!ok)
+	    fail = 1;
+
+	if(damage == DAMAGE_NONE) {
+	    // only the cells that differ from the retained image go out
+	    diff = 0;
+	    for(row = 0; row < 2; row++)
+		for(col = 0; col < 16; col++)
+		    diff += screen_a[row][col] != screen_b[row][col];
+
+	    capture_start(0);
+	    lcd_create_char(1, bell);
+	    printf("%-22s %7s %8" PRIu32 " %9" PRIu32 " %11" PRIu32 "\n", "  same custom char", "", strobes, commands,
+		   data_bytes);
+	    if(strobes != 0)
+		fail = 1;
+
+	    capture_start(0);
+	    lcd_write_combine_on();
+	    draw(screen_b);
+	    lcd_flush();
+	    lcd_write_combine_off();
+	    printf("%-22s %7s %8" PRIu32 " %9" PRIu32 " %11" PRIu32 "   %" PRIu32 " cells differ\n", "  next screen", "",
+		   strobes, commands, data_bytes, diff);
+	    if(data_bytes != diff || !shows(screen_b)) {
+		printf("  the next screen sent more than the cells that differ\n");
+		fail = 1;
+	    }
+	}
+	else {
+	    // seal a screen again for the next case
+	    lcd_create_char(1, bell);
+	    draw(screen_b);
+	    lcd_retain();
+	    if(!shows(screen_b))
+		fail = 1;
+	}
+    }
+
+    printf("\nstrobes while the controller was busy: %" PRIu32 "\n", sim.busy_strobes[0]);
+    if(sim.busy_strobes[0] != 0)
+	fail = 1;
+
+    hd44780_sim_free(&sim);
+    return fail;
+}
+
+/*
+    @brief Function for starting to count what the controller takes in
+
+    @param[in] watch 1 to check the glass against what it shows now after every strobe
+*/
+static void capture_start(uint8_t watch) {
+    uint8_t row;
+
+    for(row = 0; row < 2; row++)
+	hd44780_sim_line(&sim, 0, row, 16, (char *)glass[row]);
+    strobes = 0;
+    commands = 0;
+    data_bytes = 0;
+    clears = 0;
+    glass_changed = 0;
+    watch_glass = watch;
+}
+
+/*
+    @brief Function for drawing a screen, the usual way or into the frame buffer with write combining on
+*/
+static void draw(const char screen[2][17]) {
+    uint8_t row;
+
+    for(row = 0; row < 2; row++) {
+	lcd_set_cursor(0, row);
+	lcd_write_string((char *)screen[row]);
+    }
+}
+
+/*
+    @brief Function for checking what the panel shows
+*/
+static uint8_t shows(const char screen[2][17]) {
+    char line[17];
+    uint8_t row;
+
+    for(row = 0; row < 2; row++) {
+	hd44780_sim_line(&sim, 0, row, 16, line);
+	if(memcmp(line, screen[row], 16) != 0)
+	    return 0;
+    }
+    return 1;
+}
+
+/*
+    @brief Function for feeding the pin writes into the simulator and decoding the bytes it takes in
+*/
+static void sim_pin(uint32_t pin_no, uint32_t value, uint64_t now_us) {
+    char line[17];
+    uint8_t completes;
+    uint8_t byte;
+    uint8_t rs;
+    uint8_t nibble;
+    uint8_t row;
+
+    if(pin_no != PIN_EN)
+	return;
+
+    // the controller latches when enable falls
+    if(sim_en_level && !value) {
+	rs = shim_pin_level[PIN_RS];
+	nibble = shim_pin_level[PIN_D4] | (shim_pin_level[PIN_D5] << 1) | (shim_pin_level[PIN_D6] << 2)
+		 | (shim_pin_level[PIN_D7] << 3);
+
+	// in 8 bit mode every strobe is an instruction with the low half of the bus low
+	completes = !sim.four_bit[0] || sim.phase[0];
+	byte = sim.four_bit[0] ? (sim.high[0] << 4) | nibble : nibble << 4;
+	hd44780_sim_strobe(&sim, 0, 1, &rs, &nibble, now_us);
+
+	strobes++;
+	if(completes) {
+	    if(rs)
+		data_bytes++;
+	    else
+		commands++;
+	    if(!rs && byte == LCD_CLEARDISPLAY)
+		clears++;
+	}
+
+	for(row = 0; watch_glass && row < 2; row++) {
+	    hd44780_sim_line(&sim, 0, row, 16, line);
+	    if(memcmp(line, glass[row], 16) != 0) {
+		glass_changed++;
+		break;
+	    }
+	}
+    }
+    sim_en_level = value;
+}
@@ -0,0 +1,48 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    nrf.h
+
+  @Summary
+    Host stand-in for the nRF52 device header
+
+  @Description
+    Provides the DWT cycle counter, counting 64 cycles per microsecond of the
+    virtual clock, and the port 0 register block
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef NRF_H
+#define NRF_H
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t OUT;
+} NRF_GPIO_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+
+extern CoreDebug_Type shim_core_debug;
+extern NRF_GPIO_Type shim_p0;
+
+/*
+    @brief Function for reading the DWT registers with CYCCNT following the virtual clock
+*/
+DWT_Type * shim_dwt(void);
+
+#define CoreDebug (&shim_core_debug)
+#define DWT (shim_dwt())
+#define NRF_P0 (&shim_p0)
+
+#endif
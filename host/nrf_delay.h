@@ -0,0 +1,23 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    nrf_delay.h
+
+  @Summary
+    Host stand-in for the nRF5 SDK delay functions
+
+  @Description
+    Delays advance the virtual clock in nrf_shim.c and return straight away
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef NRF_DELAY_H
+#define NRF_DELAY_H
+
+void nrf_delay_us(uint32_t us_time);
+
+void nrf_delay_ms(uint32_t ms_time);
+
+#endif
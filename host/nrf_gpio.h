@@ -0,0 +1,38 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    nrf_gpio.h
+
+  @Summary
+    Host stand-in for the nRF5 SDK gpio functions
+
+  @Description
+    Pin writes are recorded by nrf_shim.c, port 0 is pins 0-31
+******************************************************************************/
+
+#include <inttypes.h>
+#include "nrf.h"
+
+#ifndef NRF_GPIO_H
+#define NRF_GPIO_H
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP = 3
+} nrf_gpio_pin_pull_t;
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+
+void nrf_gpio_port_out_set(NRF_GPIO_Type * p_reg, uint32_t set_mask);
+
+void nrf_gpio_port_out_clear(NRF_GPIO_Type * p_reg, uint32_t clr_mask);
+
+#endif
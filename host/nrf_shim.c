@@ -0,0 +1,145 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    nrf_shim.c
+
+  @Summary
+    Host stand-in for the parts of the nRF5 SDK the driver uses
+
+  @Description
+    Implements the virtual clock and the pin recorder behind nrf_delay.h,
+    nrf_gpio.h and nrf.h
+******************************************************************************/
+
+#include "nrf_shim.h"
+#include "nrf_delay.h"
+#include "nrf_gpio.h"
+#include "nrf.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+uint64_t shim_now_us = 0;
+uint32_t shim_pin_level[SHIM_NUM_PINS];
+uint8_t shim_pin_output[SHIM_NUM_PINS];
+uint64_t shim_gpio_writes = 0;
+uint64_t shim_delay_calls = 0;
+
+CoreDebug_Type shim_core_debug;
+NRF_GPIO_Type shim_p0;
+
+static DWT_Type shim_dwt_regs;
+static shim_pin_fn pin_hook = NULL;
+static uint32_t (*read_hook)(uint32_t pin_no) = NULL;
+static void (*dwt_hook)(void) = NULL;
+
+static void shim_pin_write(uint32_t pin_no, uint32_t value);
+
+/*
+    @brief Reset the counters, the clock keeps running
+*/
+void shim_reset_counts(void) {
+    shim_gpio_writes = 0;
+    shim_delay_calls = 0;
+}
+
+/*
+    @brief Set the callback seeing every pin write, e.g. a controller model
+
+    @param[in] hook Callback, NULL for none
+*/
+void shim_set_pin_hook(shim_pin_fn hook) {
+    pin_hook = hook;
+}
+
+/*
+    @brief Set the callback supplying the level of input pins
+
+    @param[in] read Callback returning the level of a pin, NULL to read back the last level written
+*/
+void shim_set_read_hook(uint32_t (*read)(uint32_t pin_no)) {
+    read_hook = read;
+}
+
+/*
+    @brief Set the callback run on every access to the DWT registers
+
+    @note the clock only moves in delays, so a busy wait on time_us() needs the callback to advance it
+
+    @param[in] hook Callback, NULL for none
+*/
+void shim_set_dwt_hook(void (*hook)(void)) {
+    dwt_hook = hook;
+}
+
+/*
+    @brief Function for reading the DWT registers with CYCCNT following the virtual clock
+*/
+DWT_Type * shim_dwt(void) {
+    if(dwt_hook != NULL)
+	dwt_hook();
+    shim_dwt_regs.CYCCNT = (uint32_t)(shim_now_us * 64);
+    return &shim_dwt_regs;
+}
+
+/*******************************[ SDK Functions ]****************************************/
+
+void nrf_delay_us(uint32_t us_time) {
+    shim_now_us += us_time;
+    shim_delay_calls++;
+}
+
+void nrf_delay_ms(uint32_t ms_time) {
+    shim_now_us += (uint64_t)ms_time * 1000;
+    shim_delay_calls++;
+}
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value) {
+    shim_gpio_writes++;
+    shim_pin_write(pin_number, value);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+    if(read_hook != NULL)
+	return read_hook(pin_number);
+    return shim_pin_level[pin_number % SHIM_NUM_PINS];
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+    shim_pin_output[pin_number % SHIM_NUM_PINS] = 1;
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+    (void)pull_config;
+    shim_pin_output[pin_number % SHIM_NUM_PINS] = 0;
+}
+
+void nrf_gpio_port_out_set(NRF_GPIO_Type * p_reg, uint32_t set_mask) {
+    uint32_t pin;
+
+    p_reg->OUT |= set_mask;
+    shim_gpio_writes++; // one register store whatever the number of pins
+    for(pin = 0; pin < 32; pin++)
+	if(set_mask & ((uint32_t)1 << pin))
+	    shim_pin_write(pin, 1);
+}
+
+void nrf_gpio_port_out_clear(NRF_GPIO_Type * p_reg, uint32_t clr_mask) {
+    uint32_t pin;
+
+    p_reg->OUT &= ~clr_mask;
+    shim_gpio_writes++;
+    for(pin = 0; pin < 32; pin++)
+	if(clr_mask & ((uint32_t)1 << pin))
+	    shim_pin_write(pin, 0);
+}
+
+/*
+    @brief Function for recording the new level of a pin
+*/
+static void shim_pin_write(uint32_t pin_no, uint32_t value) {
+    pin_no %= SHIM_NUM_PINS;
+    shim_pin_level[pin_no] = value ? 1 : 0;
+    if(pin_hook != NULL)
+	pin_hook(pin_no, shim_pin_level[pin_no], shim_now_us);
+}
@@ -0,0 +1,68 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    nrf_shim.h
+
+  @Summary
+    Host stand-in for the parts of the nRF5 SDK the driver uses
+
+  @Description
+    Lets the unmodified driver build and run on a Linux host. Delays advance a
+    virtual clock instead of waiting and every pin write is recorded, so bus
+    time and GPIO traffic can be measured without hardware.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef NRF_SHIM_H
+#define NRF_SHIM_H
+
+#define SHIM_NUM_PINS 64 // two ports of 32 pins like the nRF52840
+
+/*
+    @brief Callback seeing every pin write
+
+    @param[in] pin_no Pin written
+
+    @param[in] value Level written
+
+    @param[in] now_us Virtual time of the write
+*/
+typedef void (*shim_pin_fn)(uint32_t pin_no, uint32_t value, uint64_t now_us);
+
+extern uint64_t shim_now_us; // virtual clock, advanced by the delays
+extern uint32_t shim_pin_level[SHIM_NUM_PINS]; // last level written to every pin
+extern uint8_t shim_pin_output[SHIM_NUM_PINS]; // pin is an output
+extern uint64_t shim_gpio_writes; // gpio register writes since the last shim_reset_counts(), a port write counts once
+extern uint64_t shim_delay_calls; // delay calls since the last shim_reset_counts()
+
+/*
+    @brief Reset the counters, the clock keeps running
+*/
+void shim_reset_counts(void);
+
+/*
+    @brief Set the callback seeing every pin write, e.g. a controller model
+
+    @param[in] hook Callback, NULL for none
+*/
+void shim_set_pin_hook(shim_pin_fn hook);
+
+/*
+    @brief Set the callback supplying the level of input pins
+
+    @param[in] read Callback returning the level of a pin, NULL to read back the last level written
+*/
+void shim_set_read_hook(uint32_t (*read)(uint32_t pin_no));
+
+/*
+    @brief Set the callback run on every access to the DWT registers
+
+    @note the clock only moves in delays, so a busy wait on time_us() needs the callback to advance it
+
+    @param[in] hook Callback, NULL for none
+*/
+void shim_set_dwt_hook(void (*hook)(void));
+
+#endif
@@ -12,13 +12,18 @@
 ******************************************************************************/
 
 #include "lcd_16x2.h"
+#include "lcd_trace.h"
+#include "lcd_latency.h"
 #include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "nrf_delay.h" // Nordic nRF5 SDK specific library for delays
 #include "nrf_gpio.h" // Nordic nRF5 SDK specific library for gpio config
+#include "nrf.h" // Nordic nRF5 SDK specific device header, used for the DWT cycle counter
 
 static uint32_t rs_pin = 0; // register select pin
-static uint32_t en_pin = 0; // enable pin
+static uint32_t en_pins[LCD_MAX_PANELS]; // enable pin of every panel on the data bus
 static uint32_t dat4_pin = 0; // data pins
 static uint32_t dat5_pin = 0;
 static uint32_t dat6_pin = 0;
@@ -29,6 +34,128 @@ uint8_t display_control = 0; // used to turns display, cursor, and blink on and
 uint8_t display_mode = 0; // use to turn autoscroll on and off, and change text entry
 uint8_t row_offsets[4] = {0x00, 0x40, 0x10, 0x50}; // used for setting the cursor
 
+static const lcd_transport_t * lcd_transport = NULL; // NULL means the 4 bit gpio bus set up by lcd_init()
+
+// mirror of the controller registers, what has actually been sent
+static uint8_t address_counter = 0; // DDRAM address the next data byte lands on
+static uint8_t ac_valid = 0; // address_counter is known
+static uint8_t ac_in_cgram = 0; // the controller is pointing into CGRAM
+static uint8_t sent_control = 0xFF; // last display control command, 0xFF if unknown
+static uint8_t sent_mode = 0xFF; // last entry mode command, 0xFF if unknown, may differ from display_mode until a write needs it
+static uint8_t display_shift = 0; // columns the display has been shifted left, 0 to LCD_LINE_LENGTH - 1
+static uint8_t cgram_address = 0; // CGRAM address the next data byte lands on when ac_in_cgram is set
+
+// panels sharing rs and the data pins, every selected panel latches the same strobe
+static uint8_t num_panels = 1;
+static uint8_t panel_mask = 0x01; // bit per panel that takes part in transfers
+
+// bus pins as masks of port 0, so a nibble or strobe is one port write
+static uint8_t port_ok = 0; // every bus pin is on port 0
+static uint32_t nibble_set[16]; // data pins set for every nibble
+static uint32_t data_mask = 0; // all data pins
+static uint32_t en_mask = 0; // enable pins of the selected panels
+
+// put the shadow in RAM that survives a warm reset by building with e.g. -DLCD_RETAINED_SECTION=\".noinit\"
+#ifdef LCD_RETAINED_SECTION
+#define LCD_RETAINED __attribute__((section(LCD_RETAINED_SECTION)))
+#else
+#define LCD_RETAINED
+#endif
+
+#define LCD_RETAINED_MAGIC 0x4C434421 // "LCD!"
+
+// shadow of what the controller holds, sealed with a checksum by lcd_retain()
+typedef struct {
+    uint32_t magic;
+    uint8_t ddram[LCD_MAX_PANELS][LCD_DDRAM_SIZE]; // what is on the glass of every panel
+    uint8_t cgram[64]; // custom characters
+    uint8_t display_function;
+    uint8_t display_control;
+    uint8_t display_mode;
+    uint8_t display_shift;
+    uint16_t checksum;
+} lcd_shadow_t;
+
+static lcd_shadow_t shadow LCD_RETAINED;
+
+// what the application has drawn, ahead of the controller when write combining is on
+static uint8_t frame_buffer[LCD_DDRAM_SIZE]; // contents of every DDRAM cell
+static uint32_t dirty[LCD_DIRTY_WORDS]; // bit per cell written but not yet sent
+static uint8_t cursor_address = 0; // DDRAM address of the application's cursor
+static uint8_t cursor_in_cgram = 0; // the application is writing CGRAM
+static uint8_t write_combine = 0; // buffer writes until lcd_flush()
+static uint8_t page_flip = 0; // lcd_set_cursor() draws into the hidden page
+
+// cell attributes and how they are currently shown
+static uint8_t cell_attr[LCD_DDRAM_SIZE]; // LCD_ATTR_BLINK and LCD_ATTR_INVERSE for every cell
+static uint8_t attr_changed = 0; // a cell with attributes was written, pick the mechanism again
+static uint8_t blink_mechanism = LCD_BLINK_NONE;
+static uint8_t blink_hidden = 0; // blinking cells are in their off phase
+static uint8_t blink_cell = 0; // the cell blinking with the hardware cursor
+static uint8_t blink_slot = 0; // the CGRAM slot swapped for a blank
+static uint8_t blink_glyph[8]; // bitmap of blink_slot while it is swapped out
+static uint8_t inverted_slots = 0; // bit per CGRAM slot holding an inverted bitmap
+
+// bytes encoded for the next flush, data runs are stored back to back so they can go out as bursts
+static uint8_t plan_value[LCD_PLAN_SIZE]; // command or data byte
+static uint8_t plan_mode[LCD_PLAN_SIZE]; // register select for each byte
+static uint8_t plan_length = 0;
+static uint8_t plan_ac = 0; // address counter once the plan has been sent
+static uint8_t plan_ac_valid = 0;
+static uint8_t plan_start_ac = 0; // address counter the plan was predicted from
+static uint8_t plan_pos = 0; // next byte of the plan to send
+
+// background work done by lcd_idle_task() while the bus is free
+static uint8_t prefetch_rows[8][8]; // custom characters queued by lcd_prefetch_char()
+static uint8_t prefetch_pending = 0; // bit per CGRAM slot still to upload
+static uint8_t cgram_known[8]; // bit per row of each CGRAM slot the shadow holds for sure
+static uint8_t scrub = 0; // rewrite the glass from the shadow when there is nothing else to do
+static uint8_t scrub_cell = 0; // next cell to scrub
+
+// bus access windows
+static lcd_window_fn bus_window = NULL; // NULL means the bus is always available
+static lcd_gap_fn bus_gap = NULL; // borrows the data pins between bytes
+static lcd_window_stats_t window_stats;
+
+static void lcd_wake(void);
+static void bus_idle_ms(uint32_t ms_time);
+static void lcd_setup(void);
+static void lcd_send_data(uint8_t value);
+static void lcd_send_command(uint8_t cmd);
+static void lcd_bus_send(uint8_t value, uint8_t mode);
+static void lcd_bus_put(uint8_t value, uint8_t mode);
+static void lcd_bus_write_buffer(const uint8_t * data, uint16_t length);
+static void lcd_bus_locate(uint8_t address);
+static void lcd_bus_entry(uint8_t mode);
+static void lcd_send_data_back(uint8_t value);
+static uint8_t cell_index(uint8_t address);
+static uint8_t cell_address(uint8_t cell);
+static uint8_t ddram_step(uint8_t address, uint8_t forward);
+static uint8_t cursor_step(uint8_t address, uint8_t forward);
+static void plan_add(uint8_t value, uint8_t mode);
+static void plan_locate(uint8_t address);
+static uint8_t lcd_play_plan(uint8_t wait);
+static void bus_batch(uint8_t open);
+static uint8_t bus_window_open(uint16_t bytes);
+static void bus_window_wait(uint16_t bytes);
+static uint32_t bus_byte_us(void);
+static void bus_track(uint8_t value, uint8_t mode);
+static void bus_track_data(uint8_t value);
+static void port_setup(void);
+static uint8_t glass_shows(uint8_t cell, uint8_t value);
+static uint16_t shadow_checksum(void);
+static void lcd_restore(void);
+static uint8_t cursor_to_address(uint16_t col, uint8_t row);
+static uint8_t cell_visible(uint8_t cell);
+static void attr_choose(void);
+static void attr_upload(uint8_t slot, const uint8_t * rows);
+static void attr_rewrite(uint8_t hide);
+static uint8_t idle_prefetch(void);
+static uint8_t blink_park(void);
+static uint8_t idle_prerender(void);
+static uint8_t idle_scrub(void);
+static uint8_t slot_on_glass(uint8_t slot);
+
 /*******************************[ High-Level Sensor Functions For General Use ]****************************************/
 
 /*
@@ -51,17 +178,34 @@ uint8_t row_offsets[4] = {0x00, 0x40, 0x10, 0x50}; // used for setting the curso
 void lcd_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t dat6, uint32_t dat7) {
     // set pins
     rs_pin = rs;
-    en_pin = en;
+    en_pins[0] = en;
     dat4_pin = dat4;
     dat5_pin = dat5;
     dat6_pin = dat6;
     dat7_pin = dat7;
+    num_panels = 1;
+    panel_mask = 0x01;
+    port_setup();
     
     display_function = LCD_4BITMODE | LCD_2LINE | LCD_5x8DOTS;
     
+    LCD_TRACE_BEGIN(LCD_TRACE_INIT);
+
     // according to data sheet, wait at least 40ms after power before sending commands
-    delay_ms(50);
+    delay_ms(LCD_POWER_UP_MS);
+
+    lcd_wake();
+    lcd_setup();
+
+    LCD_TRACE_END(LCD_TRACE_INIT);
+}
+
+/*
+    @brief Function for putting the selected panels into 4 bit mode
 
+    @note implements the nibble sequence from the datasheet, the power up delay must already be over
+*/
+static void lcd_wake(void) {
     // set rs_pin low to begin commands
     pin_write(rs_pin, 0);
 
@@ -70,18 +214,121 @@ void lcd_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t d
     
     // we start in 8 bit mode, try to set 4 bit mode
     lcd_write_data(0x03);
-    delay_ms(5); // wait min 4.1ms
+    bus_idle_ms(LCD_WAKE_MS); // wait min 4.1ms
 
     // second try
     lcd_write_data(0x03);
-    delay_ms(5);
+    bus_idle_ms(LCD_WAKE_MS);
 
     // third try
     lcd_write_data(0x03);
-    delay_us(150);
+    delay_us(LCD_WAKE_LAST_US);
 
     // finally, set to 4 bit interface
     lcd_write_data(0x02);
+}
+
+/*
+    @brief Add another panel on the same data bus
+
+    @note the panel shares rs and the data pins with the first one and only has its own enable pin, it is initialized
+	  on its own and then every panel is selected, so everything drawn afterwards goes to all of them at once.
+	  Call it right after lcd_init(), the initialization clears the frame buffer. Only for the 4 bit gpio bus
+
+    @param[in] en Enable pin number of the new panel
+
+    @return number of the panel for lcd_select_panels(), 0xFF if LCD_MAX_PANELS are already in use
+*/
+uint8_t lcd_add_panel(uint32_t en) {
+    uint8_t panel;
+
+    if(lcd_transport != NULL || num_panels >= LCD_MAX_PANELS)
+	return 0xFF;
+
+    panel = num_panels++;
+    en_pins[panel] = en;
+    pin_write(en, 0);
+
+    // powered up together with the first panel, lcd_init() already waited
+    lcd_select_panels(1 << panel);
+    lcd_wake();
+    lcd_setup();
+
+    lcd_select_panels((1 << num_panels) - 1);
+    return panel;
+}
+
+/*
+    @brief Choose the panels that take part in transfers
+
+    @note every selected panel latches the same strobes, so mirroring any number of panels costs the bus time of one.
+	  The driver keeps a shadow of each panel's glass, a cell is only sent when a selected panel doesn't already
+	  show it. Display shift and custom characters are tracked once, keep them the same on every panel
+
+    @param[in] mask Bit per panel, bit 0 is the panel set up by lcd_init()
+*/
+void lcd_select_panels(uint8_t mask) {
+    mask &= (1 << num_panels) - 1;
+    if(mask == 0 || mask == panel_mask)
+	return;
+
+    // pending cells belong to the old selection
+    if(write_combine)
+	lcd_flush();
+
+    panel_mask = mask;
+    port_setup();
+
+    // the new selection may not agree on the registers, put them in a known state
+    ac_valid = 0;
+    lcd_bus_send(LCD_DISPLAYCONTROL | display_control | ((blink_mechanism == LCD_BLINK_CURSOR) ? LCD_BLINKON : 0), 0);
+    lcd_bus_send(LCD_ENTRYMODESET | display_mode, 0);
+}
+
+/*
+    @brief Initialize the LCD through a byte wide transport
+
+    @note implements the 8 bit initialization sequence according to datasheet, for transports that move whole bytes (8-bit bus or serial controllers)
+
+    @param[in] transport Transport used for every transfer from now on, must stay valid
+*/
+void lcd_init_transport(const lcd_transport_t * transport) {
+    lcd_transport = transport;
+
+    display_function = LCD_8BITMODE | LCD_2LINE | LCD_5x8DOTS;
+
+    // according to data sheet, wait at least 40ms after power before sending commands
+    delay_ms(LCD_POWER_UP_MS);
+
+    // same wake up as 4 bit mode, but each function set is a whole byte
+    lcd_command(LCD_FUNCTIONSET | LCD_8BITMODE);
+    delay_ms(LCD_WAKE_MS); // wait min 4.1ms
+
+    lcd_command(LCD_FUNCTIONSET | LCD_8BITMODE);
+    delay_ms(LCD_WAKE_MS);
+
+    lcd_command(LCD_FUNCTIONSET | LCD_8BITMODE);
+    delay_us(LCD_WAKE_LAST_US);
+
+    lcd_setup();
+}
+
+/*
+    @brief Function for the part of initialization shared by every bus
+
+    @note the controller must already be awake and in the bus mode given by display_function
+*/
+static void lcd_setup(void) {
+    // nothing sent so far is trusted
+    ac_valid = 0;
+    ac_in_cgram = 0;
+    sent_control = 0xFF;
+    sent_mode = 0xFF;
+    display_shift = 0; // the clear below resets the shift
+    cursor_in_cgram = 0;
+    memset(dirty, 0, sizeof(dirty));
+    LCD_LATENCY_RESET();
+    memset(cgram_known, 0, sizeof(cgram_known)); // CGRAM holds garbage after power up
 
     // set # lines, font size, etc
     lcd_command(LCD_FUNCTIONSET | display_function);
@@ -97,6 +344,159 @@ void lcd_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t d
     display_mode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
     // set the entry mode
     lcd_command(LCD_ENTRYMODESET | display_mode);
+
+    lcd_retain();
+}
+
+/*
+    @brief Warm start the LCD for 4-bit interface
+
+    @note if the shadow kept in retained RAM is intact the panel still shows it, so only the nibble phase is resynced
+	  and the registers are restored, nothing is cleared and drawing the same screen again sends only the cells
+	  that differ, otherwise falls back to lcd_init()
+
+    @param[in] rs Register Select pin number
+
+    @param[in] en Enable pin number
+    
+    @param[in] dat4 Data4 pin number
+
+    @param[in] dat5 Data5 pin number
+
+    @param[in] dat6 Data6 pin number
+
+    @param[in] dat7 Data7 pin number
+
+    @return 1 if the panel was picked up as it was, 0 if it was initialized from scratch
+*/
+uint8_t lcd_warm_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t dat6, uint32_t dat7) {
+    if(shadow.magic != LCD_RETAINED_MAGIC || shadow.checksum != shadow_checksum()
+       || (shadow.display_function & LCD_8BITMODE)) {
+	lcd_init(rs, en, dat4, dat5, dat6, dat7);
+	return 0;
+    }
+
+    rs_pin = rs;
+    en_pins[0] = en;
+    dat4_pin = dat4;
+    dat5_pin = dat5;
+    dat6_pin = dat6;
+    dat7_pin = dat7;
+    num_panels = 1;
+    panel_mask = 0x01;
+    port_setup();
+    lcd_transport = NULL;
+
+    pin_write(rs_pin, 0);
+
+    // whatever nibble the controller was waiting for, three 0x3 nibbles leave it in 8 bit mode,
+    // the first may complete a return home so give it time
+    lcd_write_data(0x03);
+    bus_idle_ms(LCD_CLEAR_MS);
+    lcd_write_data(0x03);
+    lcd_write_data(0x03);
+    lcd_write_data(0x02);
+
+    lcd_restore();
+    return 1;
+}
+
+/*
+    @brief Warm start the LCD through a byte wide transport
+
+    @note same as lcd_warm_init() for transports that move whole bytes, falls back to lcd_init_transport()
+
+    @param[in] transport Transport used for every transfer from now on, must stay valid
+
+    @return 1 if the panel was picked up as it was, 0 if it was initialized from scratch
+*/
+uint8_t lcd_warm_init_transport(const lcd_transport_t * transport) {
+    if(shadow.magic != LCD_RETAINED_MAGIC || shadow.checksum != shadow_checksum()
+       || !(shadow.display_function & LCD_8BITMODE)) {
+	lcd_init_transport(transport);
+	return 0;
+    }
+
+    lcd_transport = transport;
+
+    // a whole byte per transfer, there is no phase to lose
+    lcd_command(LCD_FUNCTIONSET | LCD_8BITMODE);
+    delay_ms(LCD_CLEAR_MS); // a pending return home may still be running
+
+    lcd_restore();
+    return 1;
+}
+
+/*
+    @brief Function for picking up the state kept in the shadow after a warm start
+
+    @note the controller must already be awake and in the bus mode kept in the shadow
+*/
+static void lcd_restore(void) {
+    const uint8_t shift = shadow.display_shift;
+    uint8_t i;
+
+    ac_valid = 0;
+    ac_in_cgram = 0;
+    sent_control = 0xFF;
+    sent_mode = 0xFF;
+    cursor_in_cgram = 0;
+    cursor_address = 0;
+    memset(dirty, 0, sizeof(dirty));
+    LCD_LATENCY_RESET();
+    memset(cgram_known, 0xFF, sizeof(cgram_known)); // CGRAM kept its contents along with DDRAM
+
+    display_function = shadow.display_function;
+    display_control = shadow.display_control;
+    display_mode = shadow.display_mode;
+    memcpy(frame_buffer, shadow.ddram[0], sizeof(frame_buffer));
+
+    lcd_command(LCD_FUNCTIONSET | display_function);
+    lcd_command(LCD_DISPLAYCONTROL | display_control);
+    lcd_command(LCD_ENTRYMODESET | display_mode);
+
+    // the resync may have returned home, put the shift back
+    display_shift = 0;
+    if(shift != 0) {
+	lcd_home();
+	for(i = 0; i < shift; i++)
+	    lcd_shift_left();
+    }
+
+    lcd_retain();
+}
+
+/*
+    @brief Seal the shadow of the panel so a warm start can trust it
+
+    @note called by lcd_flush(), call it after drawing without write combining, anything sent
+	  after the last seal makes lcd_warm_init() fall back to a full initialization
+*/
+void lcd_retain(void) {
+    shadow.magic = LCD_RETAINED_MAGIC;
+    shadow.display_function = display_function;
+    shadow.display_control = display_control;
+    shadow.display_mode = display_mode;
+    shadow.display_shift = display_shift;
+    shadow.checksum = shadow_checksum();
+}
+
+/*
+    @brief Function for computing the Fletcher-16 checksum of the shadow
+*/
+static uint16_t shadow_checksum(void) {
+    const uint8_t * bytes = (const uint8_t *)&shadow;
+    const uint16_t length = offsetof(lcd_shadow_t, checksum);
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+    uint16_t i;
+
+    for(i = 0; i < length; i++) {
+	sum1 = (sum1 + bytes[i]) % 255;
+	sum2 = (sum2 + sum1) % 255;
+    }
+
+    return (sum2 << 8) | sum1;
 }
 
 /*
@@ -121,8 +521,10 @@ void lcd_display_on(void) {
     @note sets the cursor position to zero
 */
 void lcd_clear(void) {
+    LCD_TRACE_BEGIN(LCD_TRACE_CLEAR);
     lcd_command(LCD_CLEARDISPLAY); // clear display, set cursor position to zero
-    delay_ms(2); 
+    bus_idle_ms(LCD_CLEAR_MS);
+    LCD_TRACE_END(LCD_TRACE_CLEAR);
 }
 
 /*
@@ -132,7 +534,7 @@ void lcd_clear(void) {
 */
 void lcd_home(void) {
     lcd_command(LCD_RETURNHOME); // set cursor position to zero
-    delay_ms(2);
+    bus_idle_ms(LCD_CLEAR_MS);
 }
 
 /*
@@ -201,6 +603,9 @@ void lcd_autoscroll_off(void) {
 
 /*
     @brief Function for writing text right to left
+
+    @note each character lands left of the one before, with write combining on nothing is sent, the controller
+	  follows with the next write that needs it
 */
 void lcd_right_to_left(void) {
     display_mode &= ~LCD_ENTRYLEFT;
@@ -209,6 +614,8 @@ void lcd_right_to_left(void) {
 
 /*
     @brief Function for writing text left to right
+
+    @note with write combining on nothing is sent, the controller follows with the next write that needs it
 */
 void lcd_left_to_right(void) {
     display_mode |= LCD_ENTRYLEFT;
@@ -223,17 +630,69 @@ void lcd_left_to_right(void) {
     @param[in] col column number
 */
 void lcd_set_cursor(uint16_t col, uint8_t row) {
-    const size_t max_lines = sizeof(row_offsets) / sizeof(*row_offsets);
+    lcd_command(LCD_SETDDRAMADDR | cursor_to_address(col, row));
+}
 
-    if(row >= max_lines) {
-	row = max_lines - 1;
-    }	
-    if(row >= NUM_LINES) {
-	row = NUM_LINES - 1;
+/*
+    @brief Set the attributes of a run of cells
+
+    @note the cheapest way to show them is picked every time attributes change: a single blinking cell uses the
+	  hardware cursor blink (0 bus bytes per blink period), a blinking whole screen toggles the display
+	  (2 commands per period), blinking cells that all show one CGRAM character swap that slot for a blank
+	  (2 x 9 bytes per period), anything else rewrites the cells (an address command and a byte per cell,
+	  twice per period). Inverse swaps the CGRAM slot shown in the cell for its inverted bitmap, so it only
+	  works on custom characters and applies to every cell showing that character
+
+    @param[in] col column number, same as lcd_set_cursor()
+
+    @param[in] row row number
+
+    @param[in] length number of cells
+
+    @param[in] attr LCD_ATTR_BLINK and/or LCD_ATTR_INVERSE, 0 for plain cells
+*/
+void lcd_set_attr(uint16_t col, uint8_t row, uint8_t length, uint8_t attr) {
+    uint8_t address = cursor_to_address(col, row);
+
+    while(length--) {
+	cell_attr[cell_index(address)] = attr;
+	address = cursor_step(address, 1);
     }
 
-    lcd_command(LCD_SETDDRAMADDR | (col + row_offsets[row]));
+    attr_choose();
+}
+
+/*
+    @brief Advance the blink phase
 
+    @note call this every half blink period, e.g. every 500ms from a timer
+*/
+void lcd_attr_tick(void) {
+    if(attr_changed)
+	attr_choose();
+
+    blink_hidden = !blink_hidden;
+
+    switch(blink_mechanism) {
+    case LCD_BLINK_DISPLAY:
+	if(blink_hidden)
+	    lcd_bus_send(LCD_DISPLAYCONTROL | (display_control & ~LCD_DISPLAYON), 0);
+	else
+	    lcd_bus_send(LCD_DISPLAYCONTROL | display_control, 0);
+	break;
+
+    case LCD_BLINK_GLYPH:
+	attr_upload(blink_slot, blink_hidden ? NULL : blink_glyph);
+	break;
+
+    case LCD_BLINK_REWRITE:
+	attr_rewrite(blink_hidden);
+	break;
+
+    default:
+	// the hardware cursor blinks on its own
+	break;
+    }
 }
 
 /*
@@ -254,154 +713,1644 @@ void lcd_write_char(char data) {
 */
 void lcd_write_string(char * str) {
     uint32_t i;
+    LCD_TRACE_BEGIN(LCD_TRACE_WRITE_STRING);
     for(i = 0; str[i] != '\0'; i++)
 	lcd_write_char(str[i]);
+    LCD_TRACE_END(LCD_TRACE_WRITE_STRING);
 }
 
 /*
-    @brief Function for printing an integer to the LCD
+    @brief Write a buffer of ROM codes to LCD at current position
 
-    @note copies the integer into a string and calls lcd_write_string()
+    @note bulk write path, the buffer is not null terminated so any of the 256 ROM codes can be sent
 
-    @param[in] num 32-bit integer to write to the LCD
+    @param[in] data Buffer of character codes to be written to the screen
+
+    @param[in] length Number of bytes in the buffer
 */
-void lcd_write_int(uint32_t num) {
-    char str[10];
-    sprintf(str, "%d", num);
-    lcd_write_string(str);
+void lcd_write_buffer(const uint8_t * data, uint16_t length) {
+    uint8_t next;
+    uint8_t wrapped;
+    uint16_t i;
+
+    LCD_TRACE_BEGIN(LCD_TRACE_WRITE_BUFFER);
+
+    if(write_combine || (display_mode & LCD_ENTRYSHIFTINCREMENT)) {
+	for(i = 0; i < length; i++)
+	    lcd_write(data[i]);
+	LCD_TRACE_END(LCD_TRACE_WRITE_BUFFER);
+	return;
+    }
+
+    if(cursor_in_cgram) {
+	lcd_bus_entry(LCD_ENTRYLEFT); // glyph rows always go out counting up
+	lcd_bus_write_buffer(data, length);
+	LCD_TRACE_END(LCD_TRACE_WRITE_BUFFER);
+	return;
+    }
+
+    lcd_bus_entry(display_mode);
+
+    // one run per stretch the address counter covers, in page flip mode the cursor wraps inside the line
+    while(length > 0) {
+	lcd_bus_locate(cursor_address);
+	i = 0;
+	do {
+	    frame_buffer[cell_index(cursor_address)] = data[i];
+	    LCD_LATENCY_WRITE(cell_index(cursor_address));
+	    next = cursor_step(cursor_address, display_mode & LCD_ENTRYLEFT);
+	    wrapped = next != ddram_step(cursor_address, display_mode & LCD_ENTRYLEFT);
+	    cursor_address = next;
+	    i++;
+	} while(i < length && !wrapped);
+
+	lcd_bus_write_buffer(data, i);
+	data += i;
+	length -= i;
+    }
+    blink_park();
+    LCD_TRACE_END(LCD_TRACE_WRITE_BUFFER);
 }
 
 /*
-    @brief Function for printing a float to the LCD
+    @brief Write a buffer of ROM codes ending at the current position
 
-    @note copies the float into a string and calls lcd_write_string()
+    @note the last byte lands on the cursor and the others to its left, the buffer is sent from its end with the
+	  address counter counting down, so right aligned text needs neither its width worked out nor an address
+	  command per character. The cursor is left on the cell before the first byte, nothing is written while the
+	  cursor is in CGRAM
 
-    @param[in] num float to write to the LCD
+    @param[in] data Buffer of character codes to be written to the screen
+
+    @param[in] length Number of bytes in the buffer
 */
-void lcd_write_float(float num) {
-    char str[10];
-    sprintf(str, "%.4f", num);
-    lcd_write_string(str);
+void lcd_write_buffer_right(const uint8_t * data, uint16_t length) {
+    LCD_TRACE_BEGIN(LCD_TRACE_WRITE_BUFFER);
+    while(length > 0)
+	lcd_send_data_back(data[--length]);
+    LCD_TRACE_END(LCD_TRACE_WRITE_BUFFER);
 }
 
 /*
-    @brief Function for sending a command to LCD
+    @brief Load a custom character into CGRAM
 
-    @note middle man function, tells lcd_send() to set the register select to 0 (instruction register)
+    @note the character is printed with lcd_write_char(location), the cursor position is lost so call lcd_set_cursor() afterwards
 
-    @param[in] cmd Command to send to LCD
+    @note nothing is sent if the slot already holds the bitmap
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
 */
-inline void lcd_command(uint8_t cmd) {
-    lcd_send(cmd, 0);
+void lcd_create_char(uint8_t location, const uint8_t charmap[8]) {
+    location &= 0x07; // only 8 slots available
+    prefetch_pending &= ~(1 << location); // the slot is wanted now
+
+    // nothing to do if the slot already holds it, lcd_idle_task() may have uploaded it
+    if(cgram_known[location] == 0xFF && memcmp(&shadow.cgram[location << 3], charmap, 8) == 0)
+	return;
+
+    LCD_TRACE_BEGIN(LCD_TRACE_CREATE_CHAR);
+    lcd_command(LCD_SETCGRAMADDR | (location << 3));
+    lcd_write_buffer(charmap, 8);
+    LCD_TRACE_END(LCD_TRACE_CREATE_CHAR);
 }
 
 /*
-    @brief Function for printing to the LCD
+    @brief Function for turning on page flip mode
 
-    @note middle man function, tells lcd_send() to set the register select to 1 (data register)
+    @note lcd_set_cursor() now draws into the NUM_COLS hidden columns right after the visible ones,
+	  lcd_flip_page() then brings them on screen in one go, writes wrap inside the line like the page does
+*/
+void lcd_page_flip_on(void) {
+    page_flip = 1;
+}
 
-    @param[in] value ASCII value to print to the LCD
+/*
+    @brief Function for turning off page flip mode
+
+    @note lcd_set_cursor() goes back to plain DDRAM columns, the display shift is kept
 */
-void lcd_write(uint8_t value) {
-    lcd_send(value, 1);
-} 
+void lcd_page_flip_off(void) {
+    page_flip = 0;
+}
 
 /*
-    @brief Function for sending something to the LCD
+    @brief Show the hidden page
 
-    @note sets the register select pin to instruction register or data register based on mode input
+    @note shifts the display left by NUM_COLS, or returns home when that lands on shift 0, the old page becomes hidden
+	  and is the next one drawn, draw the whole page since it still holds older content
+*/
+void lcd_flip_page(void) {
+    const uint8_t target = (display_shift + NUM_COLS) % LCD_LINE_LENGTH;
+    uint8_t i;
 
-    @note since the LCD is in 4 bit mode, we write the upper 4 bits and then the lower 4 bits of the command/value
+    lcd_flush();
 
-    @param[in] value Command or ASCII character to write to LCD
+    if(target == 0) {
+	lcd_home(); // one command instead of a run of shifts
+	return;
+    }
 
-    @param[in] mode Instruction or Data (0 or 1)
+    for(i = 0; i < NUM_COLS; i++)
+	lcd_shift_left();
+}
+
+/*
+    @brief Function for turning on write combining
+
+    @note writes are kept in the frame buffer and sent by lcd_flush(), cursor moves are free,
+	  consecutive cells are sent as one run and cells written twice are only sent once
 */
-void lcd_send(uint8_t value, uint8_t mode) {
-    pin_write(rs_pin, mode);
+void lcd_write_combine_on(void) {
+    write_combine = 1;
+}
 
-    lcd_write_data(value >> 4);
-    lcd_write_data(value);
-}  
+/*
+    @brief Function for turning off write combining
+
+    @note flushes anything still pending
+*/
+void lcd_write_combine_off(void) {
+    lcd_flush();
+    write_combine = 0;
+
+    // the controller has to follow the application's cursor again
+    if(!cursor_in_cgram)
+	lcd_bus_locate(cursor_address);
+}
 
 /*
-    @brief Function for transmitting 4-bit data to LCD
+    @brief Send every pending cell to the LCD
 
-    @note sets the data pins to low or high based on the data to be sent
+    @note one address command per run of consecutive cells, skipped if the address counter is already there
+*/
+void lcd_flush(void) {
+    LCD_TRACE_BEGIN(LCD_TRACE_FLUSH);
+    lcd_prepare_flush();
+    lcd_play_plan(1);
+    blink_park();
+    lcd_retain();
+    LCD_TRACE_END(LCD_TRACE_FLUSH);
+}
 
-    @param[in] data 4-bit Data to send to LCD
+/*
+    @brief Encode every pending cell into the flush plan without touching the bus
+
+    @note the plan is sent by the next lcd_flush() or lcd_present_at(), cells written afterwards are added to it
 */
-void lcd_write_data(uint8_t data) {
-    if(data & 1)
-	pin_write(dat4_pin, 1);
-    else
-	pin_write(dat4_pin, 0);
-    if(data & 2)
-	pin_write(dat5_pin, 1);
-    else
-	pin_write(dat5_pin, 0);
-    if(data & 4)
-	pin_write(dat6_pin, 1);
-    else
-	pin_write(dat6_pin, 0);
-    if(data & 8)
-	pin_write(dat7_pin, 1);
-    else
-	pin_write(dat7_pin, 0);
+void lcd_prepare_flush(void) {
+    const uint8_t forward = sent_mode & LCD_ENTRYLEFT;
+    uint32_t bits;
+    uint32_t bit;
+    uint8_t word;
+    uint8_t start;
+    uint8_t end;
+    uint8_t cell;
+
+#ifdef LCD_TRACE
+    // part of the last frame is on the glass and the rest goes out with this one
+    for(word = 0; plan_pos != 0 && word < LCD_DIRTY_WORDS; word++) {
+	if(dirty[word] != 0) {
+	    LCD_TRACE_DROP();
+	    break;
+	}
+    }
+#endif
+
+    for(word = 0; word < LCD_DIRTY_WORDS; word++) {
+	bits = dirty[word];
+	dirty[word] = 0;
+
+	// cells that already show the right thing don't need sending, only the set bits are visited
+	for(bit = bits; bit != 0; bit &= bit - 1) {
+	    cell = (word << 5) + __builtin_ctz(bit);
+	    if(glass_shows(cell, frame_buffer[cell])) {
+		bits &= ~((uint32_t)1 << (cell & 31));
+		LCD_LATENCY_SHOWN(cell);
+	    }
+	}
+
+	// pull out runs of set bits, a run crossing into the next word costs no extra command
+	// since the address counter is already there
+	while(bits != 0) {
+	    start = __builtin_ctz(bits);
+	    bit = ~bits & (UINT32_MAX << start); // clear bits from the start of the run on
+	    end = (bit == 0) ? 32 : __builtin_ctz(bit);
+	    bits = (end == 32) ? 0 : (bits & (UINT32_MAX << end));
+
+	    if(forward) {
+		plan_locate(cell_address((word << 5) + start));
+		for(cell = (word << 5) + start; cell < (word << 5) + end; cell++)
+		    plan_add(frame_buffer[cell], 1);
+	    }
+	    else {
+		// address counter counts down, send the run from its right edge
+		plan_locate(cell_address((word << 5) + end - 1));
+		for(cell = (word << 5) + end; cell > (word << 5) + start; cell--)
+		    plan_add(frame_buffer[cell - 1], 1);
+	    }
+	}
+    }
 
-    enable_pulse();
+    LCD_TRACE_COUNT(LCD_TRACE_PLAN_DEPTH, plan_length - plan_pos);
 }
 
 /*
-    @brief Function for pulsing the enable pin 
+    @brief Get the part of the flush plan not sent yet
+
+    @note call lcd_prepare_flush() first, pass the bytes to lcd_cost_sequence() to know what sending them will cost
 
-    @note sends a 'clock' signal when sending data to the LCD
+    @param[out] value Set to the command and data bytes
+
+    @param[out] mode Set to the register select of each byte
+
+    @return number of bytes
 */
-void enable_pulse(void) {
-    pin_write(en_pin, 0);
-    delay_us(1);
-    pin_write(en_pin, 1);
-    delay_us(1);
-    pin_write(en_pin, 0);
-    delay_us(100);
+uint16_t lcd_plan_pending(const uint8_t ** value, const uint8_t ** mode) {
+    *value = &plan_value[plan_pos];
+    *mode = &plan_mode[plan_pos];
+    return plan_length - plan_pos;
 }
 
-/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+/*
+    @brief Send the flush plan when a timestamp is reached
+
+    @note prepares anything still pending, waits for the deadline and then only sends the plan,
+	  so the frame appears as close to the deadline as the bus allows
+
+    @param[in] timestamp Time to start sending, in time_us() microseconds
+
+    @return how late the plan started in microseconds, negative never happens unless time_us() wrapped
+*/
+int32_t lcd_present_at(uint32_t timestamp) {
+    uint32_t now;
+
+    LCD_TRACE_BEGIN(LCD_TRACE_PRESENT);
+    lcd_prepare_flush();
+
+    do {
+	now = time_us();
+    } while((int32_t)(timestamp - now) > 0);
+
+    lcd_play_plan(1);
+    lcd_retain();
+    LCD_TRACE_END(LCD_TRACE_PRESENT);
+
+    return (int32_t)(now - timestamp);
+}
 
 /*
-    @brief Function for waiting a desired amount of microseconds
+    @brief Send as much of the pending cells as fits the current bus window
 
-    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
-	  architecture you'll have to rewrite this to work with your own micro
+    @note never blocks, call it again when the next window opens, a byte is never split across windows
 
-    @param[in] us_time The desired wait time in microseconds
+    @return number of bytes still waiting, 0 once everything is on the glass
 */
-void delay_us(uint32_t us_time) {
-    nrf_delay_us(us_time);
+uint8_t lcd_flush_poll(void) {
+    uint8_t remaining;
+
+    LCD_TRACE_BEGIN(LCD_TRACE_FLUSH_POLL);
+    lcd_prepare_flush();
+    remaining = lcd_play_plan(0);
+    if(remaining == 0) {
+	blink_park();
+	lcd_retain();
+    }
+    LCD_TRACE_END(LCD_TRACE_FLUSH_POLL);
+
+    return remaining;
 }
 
 /*
-    @brief Function for waiting a desired amount of miliseconds
+    @brief Set the callback telling the driver when it may use the bus
 
-    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
-	  architecture you'll have to rewrite this to work with your own micro
+    @note every transfer waits for the callback to allow it, lcd_flush_poll() stops instead of waiting
 
-    @param[in] ms_time The desired wait time in miliseconds
+    @param[in] window Callback returning nonzero if a transfer of the given length in microseconds may start now,
+		      NULL to allow the bus at any time
 */
-void delay_ms(uint32_t ms_time) {
-    nrf_delay_ms(ms_time);
+void lcd_set_bus_window(lcd_window_fn window) {
+    bus_window = window;
 }
 
 /*
-    @brief Function for writing a value to a pin
+    @brief Read and reset the bus window statistics
 
-    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
-	  architecture you'll have to rewrite this to work with your own micro
+    @note utilisation is busy_us over the time the windows were open, deferred_us is the latency added by waiting
 
-    @param[in] pin_no Pin number to write to
+    @param[out] stats Statistics since the last call
+*/
+void lcd_get_window_stats(lcd_window_stats_t * stats) {
+    *stats = window_stats;
+    memset(&window_stats, 0, sizeof(window_stats));
+}
 
-    @param[in] value Value to write to the pin (0 or 1, but I used 32 bit because that's what the nrf function takes)
+/*
+    @brief Set the callback run between bytes on the 4 bit gpio bus
+
+    @note runs with enable low after both nibbles of a byte, so the nibble phase is never split, and every
+	  LCD_IDLE_POLL_US while clear, return home or wake up is executing. It may borrow the data pins, e.g. to
+	  scan a keypad, as long as they are outputs again when it returns
+
+    @param[in] gap Callback, NULL for none
 */
-void pin_write(uint32_t pin_no, uint32_t value) {
-    nrf_gpio_pin_write(pin_no, value);
-}
\ No newline at end of file
+void lcd_set_bus_gap(lcd_gap_fn gap) {
+    bus_gap = gap;
+}
+
+/*
+    @brief Do one byte of background work while the bus is free
+
+    @note call it whenever the application has nothing to draw, it sends at most one byte so anything in the
+	  foreground waits for a byte at most. Does nothing while a flush plan is pending or the application is
+	  writing CGRAM. In order: uploads queued custom characters to slots not on the glass, sends pending
+	  cells that are off screen (the hidden page in page flip mode), then rewrites visible cells from the
+	  shadow if scrubbing is on
+
+    @return 1 if a byte was sent, 0 if there was nothing to do or the bus window is closed
+*/
+uint8_t lcd_idle_task(void) {
+    if(cursor_in_cgram || plan_length != 0 || !bus_window_open(1))
+	return 0;
+
+    if(idle_prefetch())
+	return 1;
+    if(idle_prerender())
+	return 1;
+    if(scrub && idle_scrub())
+	return 1;
+    return blink_park();
+}
+
+/*
+    @brief Queue a custom character for upload by lcd_idle_task()
+
+    @note use it for characters the next screen is likely to need, e.g. the neighbours of a menu entry. A slot shown
+	  on the glass is not touched until it is no longer shown, lcd_create_char() with the same bitmap then sends
+	  nothing
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
+*/
+void lcd_prefetch_char(uint8_t location, const uint8_t charmap[8]) {
+    location &= 0x07;
+    memcpy(prefetch_rows[location], charmap, 8);
+    prefetch_pending |= 1 << location;
+}
+
+/*
+    @brief Function for turning on scrubbing
+
+    @note lcd_idle_task() rewrites the visible cells from the shadow one at a time when it has nothing else to do,
+	  which repairs a glass upset by noise. There is no RW pin so nothing is read back
+*/
+void lcd_scrub_on(void) {
+    scrub = 1;
+}
+
+/*
+    @brief Function for turning off scrubbing
+*/
+void lcd_scrub_off(void) {
+    scrub = 0;
+}
+
+/*
+    @brief Function for printing an integer to the LCD
+
+    @note copies the integer into a string and calls lcd_write_string()
+
+    @param[in] num 32-bit integer to write to the LCD
+*/
+void lcd_write_int(uint32_t num) {
+    char str[12]; // "4294967295" and the terminator, with room to spare
+    snprintf(str, sizeof(str), "%" PRIu32, num);
+    lcd_write_string(str);
+}
+
+/*
+    @brief Function for printing an integer right aligned on the current position
+
+    @note the digits are made from the last one up and written leftwards, see lcd_write_buffer_right(), cells up to
+	  width are blanked so a shorter number doesn't leave digits of a longer one behind
+
+    @param[in] num 32-bit integer to write to the LCD
+
+    @param[in] width Cells the field takes, 0 for just the number
+*/
+void lcd_write_int_right(int32_t num, uint8_t width) {
+    uint32_t magnitude = (num < 0) ? 0u - (uint32_t)num : (uint32_t)num;
+    uint8_t written = 0;
+
+    do {
+	lcd_send_data_back('0' + magnitude % 10);
+	magnitude /= 10;
+	written++;
+    } while(magnitude != 0);
+
+    if(num < 0) {
+	lcd_send_data_back('-');
+	written++;
+    }
+
+    for(; written < width; written++)
+	lcd_send_data_back(' ');
+}
+
+/*
+    @brief Function for printing a float to the LCD
+
+    @note copies the float into a string and calls lcd_write_string(), cut to one line of 16 characters
+
+    @param[in] num float to write to the LCD
+*/
+void lcd_write_float(float num) {
+    char str[17];
+    snprintf(str, sizeof(str), "%.4f", num);
+    lcd_write_string(str);
+}
+
+/*
+    @brief Function for sending a command to LCD
+
+    @note middle man function, tells lcd_send() to set the register select to 0 (instruction register)
+
+    @param[in] cmd Command to send to LCD
+*/
+inline void lcd_command(uint8_t cmd) {
+    lcd_send(cmd, 0);
+}
+
+/*
+    @brief Function for printing to the LCD
+
+    @note middle man function, tells lcd_send() to set the register select to 1 (data register)
+
+    @param[in] value ASCII value to print to the LCD
+*/
+void lcd_write(uint8_t value) {
+    lcd_send(value, 1);
+} 
+
+/*
+    @brief Function for sending something to the LCD
+
+    @note sets the register select pin to instruction register or data register based on mode input
+
+    @note since the LCD is in 4 bit mode, we write the upper 4 bits and then the lower 4 bits of the command/value
+
+    @note hands the byte to the transport instead when the LCD was set up with lcd_init_transport()
+
+    @note with write combining on, data and cursor moves are held back until lcd_flush()
+
+    @param[in] value Command or ASCII character to write to LCD
+
+    @param[in] mode Instruction or Data (0 or 1)
+*/
+void lcd_send(uint8_t value, uint8_t mode) {
+    if(mode)
+	lcd_send_data(value);
+    else
+	lcd_send_command(value);
+}  
+
+/*
+    @brief Function for handling a data byte from the application
+
+    @note stores the byte in the frame buffer, with write combining on it stays there until lcd_flush()
+*/
+static void lcd_send_data(uint8_t value) {
+    uint8_t cell;
+
+    if(cursor_in_cgram) {
+	lcd_bus_entry(LCD_ENTRYLEFT); // leaves the address counter alone, glyph rows always go out counting up
+	lcd_bus_send(value, 1); // the CGRAM address command already went out
+	inverted_slots &= ~(1 << (cgram_address >> 3)); // the application replaced the bitmap
+	attr_changed = 1;
+	return;
+    }
+
+    cell = cell_index(cursor_address);
+    frame_buffer[cell] = value;
+    LCD_LATENCY_WRITE(cell);
+    if(cell_attr[cell])
+	attr_changed = 1;
+
+    if(write_combine && !(display_mode & LCD_ENTRYSHIFTINCREMENT)) {
+	dirty[cell >> 5] |= (uint32_t)1 << (cell & 31);
+	cursor_address = cursor_step(cursor_address, display_mode & LCD_ENTRYLEFT);
+	return;
+    }
+
+    // autoscroll shifts the display on every write so order matters, send everything now
+    if(write_combine)
+	lcd_flush();
+
+    dirty[cell >> 5] &= ~((uint32_t)1 << (cell & 31));
+    lcd_bus_entry(display_mode);
+    lcd_bus_locate(cursor_address);
+    lcd_bus_send(value, 1);
+    cursor_address = cursor_step(cursor_address, display_mode & LCD_ENTRYLEFT);
+    blink_park();
+}
+
+/*
+    @brief Function for writing a data byte at the cursor and moving the cursor left
+
+    @note without write combining the controller is put in decrement mode, without display shift, so every byte after
+	  the first lands left of the one before with no address command, the mode is left for the next write that
+	  needs another one
+*/
+static void lcd_send_data_back(uint8_t value) {
+    const uint8_t cell = cell_index(cursor_address);
+
+    if(cursor_in_cgram)
+	return; // only DDRAM has cells to anchor to
+
+    frame_buffer[cell] = value;
+    LCD_LATENCY_WRITE(cell);
+    if(cell_attr[cell])
+	attr_changed = 1;
+
+    if(write_combine && !(display_mode & LCD_ENTRYSHIFTINCREMENT)) {
+	dirty[cell >> 5] |= (uint32_t)1 << (cell & 31);
+	cursor_address = cursor_step(cursor_address, 0);
+	return;
+    }
+
+    if(write_combine)
+	lcd_flush();
+
+    dirty[cell >> 5] &= ~((uint32_t)1 << (cell & 31));
+    lcd_bus_entry(LCD_ENTRYRIGHT | LCD_ENTRYSHIFTDECREMENT);
+    lcd_bus_locate(cursor_address);
+    lcd_bus_send(value, 1);
+    cursor_address = cursor_step(cursor_address, 0);
+    blink_park();
+}
+
+/*
+    @brief Function for handling a command from the application
+
+    @note with write combining on, cursor moves only change the application's cursor and repeated
+	  display control or entry mode commands are dropped, anything else flushes pending cells first, a changed
+	  display control too
+*/
+static void lcd_send_command(uint8_t cmd) {
+    // a single blinking cell borrows the hardware blink, keep it on whatever the application does to the cursor
+    if((cmd & 0xF8) == LCD_DISPLAYCONTROL && blink_mechanism == LCD_BLINK_CURSOR)
+	cmd |= LCD_BLINKON;
+
+    if((cmd & 0xFC) == LCD_ENTRYMODESET)
+	display_mode = cmd & 0x03; // the mode writes follow, even when it reaches the controller later
+
+    if(cmd & LCD_SETDDRAMADDR) {
+	cursor_address = cmd & 0x7F;
+	cursor_in_cgram = 0;
+	if(write_combine)
+	    return;
+	// the blinking cursor stays on its cell, the next write locates itself
+	if(blink_mechanism == LCD_BLINK_CURSOR)
+	    blink_park();
+	else
+	    lcd_bus_send(cmd, 0);
+	return;
+    }
+
+    if(write_combine) {
+	// a changed display control goes out after the pending cells, so off, draw, on never shows the drawing
+	if((cmd & 0xF8) == LCD_DISPLAYCONTROL && cmd == sent_control)
+	    return;
+	// the direction only matters to the application's cursor until a write goes out, the plan works either way
+	if((cmd & 0xFC) == LCD_ENTRYMODESET && (cmd == sent_mode || !((cmd | sent_mode) & LCD_ENTRYSHIFTINCREMENT)))
+	    return;
+	if((cmd & 0xF8) == LCD_CURSORSHIFT && !cursor_in_cgram) {
+	    cursor_address = ddram_step(cursor_address, cmd & LCD_MOVERIGHT);
+	    return;
+	}
+
+	lcd_flush();
+    }
+
+    if(cmd & LCD_SETCGRAMADDR) {
+	cursor_in_cgram = 1;
+    }
+    else if(cmd & (LCD_FUNCTIONSET | LCD_CURSORSHIFT | LCD_DISPLAYCONTROL | LCD_ENTRYMODESET)) {
+	if((cmd & 0xF8) == LCD_CURSORSHIFT && !cursor_in_cgram)
+	    cursor_address = ddram_step(cursor_address, cmd & LCD_MOVERIGHT);
+    }
+    else if(cmd & LCD_RETURNHOME) {
+	cursor_address = 0;
+	cursor_in_cgram = 0;
+    }
+    else if(cmd & LCD_CLEARDISPLAY) {
+	memset(frame_buffer, ' ', sizeof(frame_buffer));
+	memset(dirty, 0, sizeof(dirty));
+	LCD_LATENCY_RESET(); // the cells waiting to be sent never will be
+	cursor_address = 0;
+	cursor_in_cgram = 0;
+    }
+
+    lcd_bus_send(cmd, 0);
+    if(!cursor_in_cgram)
+	blink_park(); // cursor shifts and home move the blinking cursor too
+}
+
+/*
+    @brief Function for putting a byte on the bus
+
+    @note waits for the bus window first
+*/
+static void lcd_bus_send(uint8_t value, uint8_t mode) {
+    bus_window_wait(1);
+    lcd_bus_put(value, mode);
+}
+
+/*
+    @brief Function for putting a byte on the bus once the bus window allows it
+
+    @note keeps the register mirror in step with the controller
+*/
+static void lcd_bus_put(uint8_t value, uint8_t mode) {
+#ifdef LCD_TRACE
+    const uint32_t start = time_us();
+#endif
+
+    if(lcd_transport != NULL) {
+	lcd_transport->send(value, mode);
+	LCD_TRACE_BUS(panel_mask, start);
+    }
+    else {
+	pin_write(rs_pin, mode);
+
+	lcd_write_data(value >> 4);
+	lcd_write_data(value);
+	LCD_TRACE_BUS(panel_mask, start);
+
+	// both nibbles are latched, the data pins are free until the next byte
+	if(bus_gap != NULL)
+	    bus_gap(0);
+    }
+
+    bus_track(value, mode);
+}
+
+/*
+    @brief Function for following a byte in the register mirror
+*/
+static void bus_track(uint8_t value, uint8_t mode) {
+    uint8_t panel;
+
+    if(mode) {
+	bus_track_data(value);
+    }
+    else if(value & LCD_SETDDRAMADDR) {
+	address_counter = value & 0x7F;
+	ac_valid = 1;
+	ac_in_cgram = 0;
+    }
+    else if(value & LCD_SETCGRAMADDR) {
+	cgram_address = value & 0x3F;
+	ac_in_cgram = 1;
+    }
+    else if(value & LCD_FUNCTIONSET) {
+	// no effect on the mirror
+    }
+    else if(value & LCD_CURSORSHIFT) {
+	if(!(value & LCD_DISPLAYMOVE) && ac_in_cgram)
+	    cgram_address = (cgram_address + ((value & LCD_MOVERIGHT) ? 1 : 0x3F)) & 0x3F;
+	else if(!(value & LCD_DISPLAYMOVE))
+	    address_counter = ddram_step(address_counter, value & LCD_MOVERIGHT);
+	else if(value & LCD_MOVERIGHT)
+	    display_shift = (display_shift + LCD_LINE_LENGTH - 1) % LCD_LINE_LENGTH;
+	else
+	    display_shift = (display_shift + 1) % LCD_LINE_LENGTH;
+    }
+    else if(value & LCD_DISPLAYCONTROL) {
+	sent_control = value;
+    }
+    else if(value & LCD_ENTRYMODESET) {
+	sent_mode = value;
+    }
+    else if(value) {
+	// clear or return home
+	if(value == LCD_CLEARDISPLAY) {
+	    for(panel = 0; panel < num_panels; panel++)
+		if(panel_mask & (1 << panel))
+		    memset(shadow.ddram[panel], ' ', LCD_DDRAM_SIZE);
+	    sent_mode |= LCD_ENTRYLEFT; // clear sets I/D back to increment, the shift bit is kept
+	}
+	address_counter = 0;
+	ac_valid = 1;
+	ac_in_cgram = 0;
+	display_shift = 0;
+    }
+}
+
+/*
+    @brief Function for following a data byte in the register mirror and the shadow of the glass
+*/
+static void bus_track_data(uint8_t value) {
+    const uint8_t forward = sent_mode & LCD_ENTRYLEFT;
+    uint8_t panel;
+
+    if(ac_in_cgram) {
+	shadow.cgram[cgram_address] = value;
+	cgram_known[cgram_address >> 3] |= 1 << (cgram_address & 0x07);
+	cgram_address = (cgram_address + (forward ? 1 : 0x3F)) & 0x3F;
+	return;
+    }
+
+    if(ac_valid) {
+	for(panel = 0; panel < num_panels; panel++)
+	    if(panel_mask & (1 << panel))
+		shadow.ddram[panel][cell_index(address_counter)] = value;
+	if(value == frame_buffer[cell_index(address_counter)])
+	    LCD_LATENCY_SHOWN(cell_index(address_counter)); // not when a blinking cell is hidden
+    }
+    address_counter = ddram_step(address_counter, forward);
+}
+
+/*
+    @brief Function for checking whether every selected panel already shows a character in a cell
+*/
+static uint8_t glass_shows(uint8_t cell, uint8_t value) {
+    uint8_t panel;
+
+    for(panel = 0; panel < num_panels; panel++)
+	if((panel_mask & (1 << panel)) && shadow.ddram[panel][cell] != value)
+	    return 0;
+    return 1;
+}
+
+/*
+    @brief Function for putting a run of data bytes on the bus
+
+    @note uses the transport's burst write when there is one. The run goes out in one window when it fits, otherwise
+	  a byte per window, so windows shorter than the run never stall it
+*/
+static void lcd_bus_write_buffer(const uint8_t * data, uint16_t length) {
+    uint16_t chunk;
+    uint16_t i;
+#ifdef LCD_TRACE
+    uint32_t start;
+#endif
+
+    while(length > 0) {
+	chunk = bus_window_open(length) ? length : 1;
+	bus_window_wait(chunk);
+
+	if(lcd_transport == NULL || lcd_transport->write_buffer == NULL) {
+	    for(i = 0; i < chunk; i++)
+		lcd_bus_put(data[i], 1);
+	}
+	else {
+#ifdef LCD_TRACE
+	    start = time_us();
+#endif
+	    lcd_transport->write_buffer(data, chunk, 1);
+	    LCD_TRACE_BUS(panel_mask, start);
+	    for(i = 0; i < chunk; i++)
+		bus_track_data(data[i]);
+	}
+
+	data += chunk;
+	length -= chunk;
+    }
+}
+
+/*
+    @brief Function for pointing the controller at a DDRAM address
+
+    @note nothing is sent when the address counter is already there
+*/
+static void lcd_bus_locate(uint8_t address) {
+    if(ac_valid && !ac_in_cgram && address_counter == address)
+	return;
+    lcd_bus_send(LCD_SETDDRAMADDR | address, 0);
+}
+
+/*
+    @brief Function for putting the controller in an entry mode
+
+    @note nothing is sent when the register mirror shows it is already in it
+*/
+static void lcd_bus_entry(uint8_t mode) {
+    if(sent_mode != (LCD_ENTRYMODESET | mode))
+	lcd_bus_send(LCD_ENTRYMODESET | mode, 0);
+}
+
+/*
+    @brief Function for appending a byte to the flush plan
+
+    @note if the plan is full it is sent early rather than dropping bytes
+*/
+static void plan_add(uint8_t value, uint8_t mode) {
+    if(plan_length == LCD_PLAN_SIZE)
+	lcd_play_plan(1);
+
+    if(plan_length == 0) {
+	// start predicting from the controller's address counter
+	plan_ac = address_counter;
+	plan_ac_valid = ac_valid && !ac_in_cgram;
+	plan_start_ac = address_counter;
+    }
+
+    plan_value[plan_length] = value;
+    plan_mode[plan_length] = mode;
+    plan_length++;
+
+    if(mode)
+	plan_ac = ddram_step(plan_ac, sent_mode & LCD_ENTRYLEFT);
+    else {
+	plan_ac = value & 0x7F; // only DDRAM address commands are planned
+	plan_ac_valid = 1;
+    }
+}
+
+/*
+    @brief Function for planning a move of the address counter
+
+    @note nothing is planned when the address counter will already be there
+*/
+static void plan_locate(uint8_t address) {
+    if(plan_length == 0) {
+	plan_ac = address_counter;
+	plan_ac_valid = ac_valid && !ac_in_cgram;
+	plan_start_ac = address_counter;
+    }
+    if(plan_ac_valid && plan_ac == address)
+	return;
+    plan_add(LCD_SETDDRAMADDR | address, 0);
+}
+
+/*
+    @brief Function for sending the flush plan
+
+    @note runs of data bytes go out through the burst path, if the plan resumes with data and the address counter
+	  has moved since it was made or last stopped, an address command is sent first
+
+    @param[in] wait 1 to wait for bus windows, 0 to stop at the first byte that doesn't fit the current window
+
+    @return number of bytes still in the plan
+*/
+static uint8_t lcd_play_plan(uint8_t wait) {
+    // something else may have moved the address counter since the plan was made
+    const uint8_t relocate = plan_pos < plan_length && plan_mode[plan_pos];
+    uint8_t run;
+
+    if(relocate && !wait && !bus_window_open(2))
+	return plan_length - plan_pos; // room for the address command and a byte
+
+    bus_batch(1);
+    if(relocate)
+	lcd_bus_locate(plan_start_ac);
+
+    while(plan_pos < plan_length) {
+	if(!plan_mode[plan_pos]) {
+	    if(!wait && !bus_window_open(1))
+		break;
+	    lcd_bus_send(plan_value[plan_pos], 0);
+	    plan_pos++;
+	    continue;
+	}
+
+	run = plan_pos;
+	while(run < plan_length && plan_mode[run])
+	    run++;
+
+	if(!wait && !bus_window_open(run - plan_pos)) {
+	    // the whole run doesn't fit, see if a single byte does
+	    if(!bus_window_open(1))
+		break;
+	    run = plan_pos + 1;
+	}
+	lcd_bus_write_buffer(&plan_value[plan_pos], run - plan_pos);
+	plan_pos = run;
+    }
+
+    bus_batch(0);
+    LCD_TRACE_COUNT(LCD_TRACE_PLAN_DEPTH, plan_length - plan_pos);
+
+    if(plan_pos < plan_length) {
+	plan_start_ac = address_counter; // where the next byte of the plan expects the address counter
+	return plan_length - plan_pos;
+    }
+
+    plan_length = 0;
+    plan_pos = 0;
+    return 0;
+}
+
+/*
+    @brief Function for opening or closing a batch on transports that send a batch as one transfer
+*/
+static void bus_batch(uint8_t open) {
+    if(lcd_transport != NULL && lcd_transport->batch != NULL)
+	lcd_transport->batch(open);
+}
+
+/*
+    @brief Function for checking whether a transfer of some bytes fits the current bus window
+*/
+static uint8_t bus_window_open(uint16_t bytes) {
+    if(bus_window == NULL)
+	return 1;
+    return bus_window(bytes * bus_byte_us());
+}
+
+/*
+    @brief Function for waiting until a transfer of some bytes fits the current bus window
+
+    @note counts the bus time and the time spent waiting
+*/
+static void bus_window_wait(uint16_t bytes) {
+    const uint32_t duration = bytes * bus_byte_us();
+    uint32_t start;
+
+    window_stats.bytes += bytes;
+    window_stats.busy_us += duration;
+
+    if(bus_window == NULL || bus_window(duration))
+	return;
+
+    start = time_us();
+    window_stats.deferred++;
+    while(!bus_window(duration))
+	;
+    window_stats.deferred_us += time_us() - start;
+}
+
+/*
+    @brief Function for waiting out a long instruction
+
+    @note the data pins are free until it finishes, the bus gap callback gets them every LCD_IDLE_POLL_US with the
+	  time left, so a keypad scan doesn't have to wait for the next byte
+*/
+static void bus_idle_ms(uint32_t ms_time) {
+    const uint32_t wait_us = ms_time * 1000;
+    const uint32_t start = time_us();
+    uint32_t elapsed;
+
+    if(bus_gap == NULL || lcd_transport != NULL) {
+	delay_ms(ms_time);
+	return;
+    }
+
+    while((elapsed = time_us() - start) < wait_us) {
+	bus_gap(wait_us - elapsed);
+	elapsed = time_us() - start;
+	if(elapsed < wait_us)
+	    delay_us((wait_us - elapsed < LCD_IDLE_POLL_US) ? wait_us - elapsed : LCD_IDLE_POLL_US);
+    }
+
+    // a scan that fell due in the last step would otherwise wait for the next byte
+    bus_gap(0);
+}
+
+/*
+    @brief Function for the time one byte keeps the bus busy
+*/
+static uint32_t bus_byte_us(void) {
+    if(lcd_transport != NULL)
+	return lcd_transport->byte_us;
+    return LCD_BYTE_US;
+}
+
+/*
+    @brief Function for converting a column and row to a DDRAM address
+
+    @note columns follow the display shift, in page flip mode they start at the hidden page
+*/
+static uint8_t cursor_to_address(uint16_t col, uint8_t row) {
+    const size_t max_lines = sizeof(row_offsets) / sizeof(*row_offsets);
+
+    if(row >= max_lines) {
+	row = max_lines - 1;
+    }	
+    if(row >= NUM_LINES) {
+	row = NUM_LINES - 1;
+    }
+
+    if(page_flip)
+	col = (col + display_shift + NUM_COLS) % LCD_LINE_LENGTH;
+
+    return col + row_offsets[row];
+}
+
+/*
+    @brief Function for checking whether a cell is inside the visible window
+*/
+static uint8_t cell_visible(uint8_t cell) {
+    const uint8_t col = cell % LCD_LINE_LENGTH;
+
+    return (col + LCD_LINE_LENGTH - display_shift) % LCD_LINE_LENGTH < NUM_COLS;
+}
+
+/*
+    @brief Function for picking the cheapest way to show the cell attributes
+
+    @note puts back whatever the previous mechanism changed, then updates inverted CGRAM slots
+*/
+static void attr_choose(void) {
+    uint8_t blinking = 0; // number of blinking cells
+    uint8_t all_blink = 1; // every visible cell with something in it blinks
+    uint8_t slot = 0xFF; // CGRAM code shared by every blinking cell, 0xFF if they differ
+    uint8_t slot_shared = 0; // a cell that doesn't blink shows the same CGRAM code
+    uint8_t inverse = 0;
+    uint8_t rows[8];
+    uint8_t cell;
+    uint8_t i;
+
+    attr_changed = 0;
+
+    // undo the current mechanism
+    if(blink_hidden) {
+	if(blink_mechanism == LCD_BLINK_GLYPH)
+	    attr_upload(blink_slot, blink_glyph);
+	else if(blink_mechanism == LCD_BLINK_REWRITE)
+	    attr_rewrite(0);
+    }
+    if(blink_mechanism == LCD_BLINK_DISPLAY || blink_mechanism == LCD_BLINK_CURSOR)
+	lcd_bus_send(LCD_DISPLAYCONTROL | display_control, 0);
+    blink_hidden = 0;
+
+    for(cell = 0; cell < LCD_DDRAM_SIZE; cell++) {
+	if(cell_attr[cell] & LCD_ATTR_INVERSE && frame_buffer[cell] < 8)
+	    inverse |= 1 << frame_buffer[cell];
+
+	if(!(cell_attr[cell] & LCD_ATTR_BLINK)) {
+	    if(cell_visible(cell) && frame_buffer[cell] != ' ')
+		all_blink = 0;
+	    continue;
+	}
+
+	if(blinking == 0) {
+	    blink_cell = cell;
+	    slot = frame_buffer[cell];
+	}
+	else if(frame_buffer[cell] != slot) {
+	    slot = 0xFF;
+	}
+	blinking++;
+    }
+
+    if(slot < 8) {
+	for(cell = 0; cell < LCD_DDRAM_SIZE; cell++) {
+	    if(!(cell_attr[cell] & LCD_ATTR_BLINK) && frame_buffer[cell] == slot)
+		slot_shared = 1;
+	}
+    }
+
+    // inverted bitmaps first so a swapped out glyph is saved the right way round
+    for(i = 0; i < 8; i++) {
+	if(((inverse ^ inverted_slots) >> i) & 1) {
+	    for(cell = 0; cell < 8; cell++)
+		rows[cell] = shadow.cgram[(i << 3) + cell] ^ 0x1F;
+	    attr_upload(i, rows);
+	    inverted_slots ^= 1 << i;
+	}
+    }
+
+    if(blinking == 0) {
+	blink_mechanism = LCD_BLINK_NONE;
+    }
+    else if(blinking == 1) {
+	blink_mechanism = LCD_BLINK_CURSOR;
+	lcd_bus_send(LCD_DISPLAYCONTROL | display_control | LCD_BLINKON, 0);
+	blink_park();
+    }
+    else if(all_blink) {
+	blink_mechanism = LCD_BLINK_DISPLAY;
+    }
+    else if(slot < 8 && !slot_shared) {
+	blink_mechanism = LCD_BLINK_GLYPH;
+	blink_slot = slot;
+	memcpy(blink_glyph, &shadow.cgram[slot << 3], sizeof(blink_glyph));
+    }
+    else {
+	blink_mechanism = LCD_BLINK_REWRITE;
+    }
+}
+
+/*
+    @brief Function for writing a CGRAM slot straight to the bus
+
+    @note the application's cursor is left alone, NULL writes a blank
+*/
+static void attr_upload(uint8_t slot, const uint8_t * rows) {
+    static const uint8_t blank[8] = {0};
+
+    lcd_bus_entry(LCD_ENTRYLEFT); // counting down in right to left mode would write the rows backwards
+    lcd_bus_send(LCD_SETCGRAMADDR | (slot << 3), 0);
+    lcd_bus_write_buffer(rows ? rows : blank, 8);
+}
+
+/*
+    @brief Function for putting the blinking hardware cursor back on its cell
+
+    @note every byte written moves the address counter and the cursor with it
+
+    @return 1 if an address command was sent
+*/
+static uint8_t blink_park(void) {
+    const uint8_t address = cell_address(blink_cell);
+
+    if(blink_mechanism != LCD_BLINK_CURSOR || (ac_valid && !ac_in_cgram && address_counter == address))
+	return 0;
+    lcd_bus_send(LCD_SETDDRAMADDR | address, 0);
+    return 1;
+}
+
+/*
+    @brief Function for hiding or showing the blinking cells by rewriting them
+
+    @note only cells that don't already show the wanted character are sent
+*/
+static void attr_rewrite(uint8_t hide) {
+    uint8_t cell;
+    uint8_t value;
+
+    for(cell = 0; cell < LCD_DDRAM_SIZE; cell++) {
+	if(!(cell_attr[cell] & LCD_ATTR_BLINK))
+	    continue;
+
+	value = hide ? ' ' : frame_buffer[cell];
+	if(!glass_shows(cell, value)) {
+	    lcd_bus_locate(cell_address(cell));
+	    lcd_bus_send(value, 1);
+	}
+    }
+}
+
+/*
+    @brief Function for uploading a byte of a queued custom character
+
+    @return 1 if a byte was sent
+*/
+static uint8_t idle_prefetch(void) {
+    uint8_t slot;
+    uint8_t row;
+    uint8_t address;
+
+    for(slot = 0; slot < 8; slot++) {
+	if(!(prefetch_pending & (1 << slot)) || slot_on_glass(slot))
+	    continue;
+
+	for(row = 0; row < 8; row++) {
+	    address = (slot << 3) | row;
+	    if((cgram_known[slot] & (1 << row)) && shadow.cgram[address] == prefetch_rows[slot][row])
+		continue;
+
+	    if(sent_mode != (LCD_ENTRYMODESET | LCD_ENTRYLEFT))
+		lcd_bus_send(LCD_ENTRYMODESET | LCD_ENTRYLEFT, 0); // rows go out counting up
+	    else if(!ac_in_cgram || cgram_address != address)
+		lcd_bus_send(LCD_SETCGRAMADDR | address, 0);
+	    else
+		lcd_bus_send(prefetch_rows[slot][row], 1);
+	    return 1;
+	}
+
+	prefetch_pending &= ~(1 << slot);
+    }
+
+    return 0;
+}
+
+/*
+    @brief Function for sending a byte of a pending cell that is off screen
+
+    @return 1 if a byte was sent
+*/
+static uint8_t idle_prerender(void) {
+    uint32_t bits;
+    uint8_t word;
+    uint8_t cell;
+
+    for(word = 0; word < LCD_DIRTY_WORDS; word++) {
+	for(bits = dirty[word]; bits != 0; bits &= bits - 1) {
+	    cell = (word << 5) + __builtin_ctz(bits);
+	    if(cell_visible(cell))
+		continue;
+
+	    if(glass_shows(cell, frame_buffer[cell])) {
+		dirty[word] &= ~((uint32_t)1 << (cell & 31));
+		LCD_LATENCY_SHOWN(cell);
+		continue;
+	    }
+
+	    if(!ac_valid || ac_in_cgram || address_counter != cell_address(cell)) {
+		lcd_bus_send(LCD_SETDDRAMADDR | cell_address(cell), 0);
+		return 1;
+	    }
+
+	    lcd_bus_send(frame_buffer[cell], 1);
+	    dirty[word] &= ~((uint32_t)1 << (cell & 31));
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/*
+    @brief Function for rewriting a byte of the visible glass from the shadow
+
+    @note cells the selected panels don't agree on are skipped
+
+    @return 1 if a byte was sent
+*/
+static uint8_t idle_scrub(void) {
+    const uint8_t panel = __builtin_ctz(panel_mask);
+    uint8_t tries;
+    uint8_t value;
+
+    for(tries = 0; tries < LCD_DDRAM_SIZE; tries++) {
+	value = shadow.ddram[panel][scrub_cell];
+	if(!cell_visible(scrub_cell) || !glass_shows(scrub_cell, value)) {
+	    scrub_cell = (scrub_cell + 1) % LCD_DDRAM_SIZE;
+	    continue;
+	}
+
+	if(!ac_valid || ac_in_cgram || address_counter != cell_address(scrub_cell)) {
+	    lcd_bus_send(LCD_SETDDRAMADDR | cell_address(scrub_cell), 0);
+	    return 1;
+	}
+
+	lcd_bus_send(value, 1);
+	scrub_cell = (scrub_cell + 1) % LCD_DDRAM_SIZE;
+	return 1;
+    }
+
+    return 0;
+}
+
+/*
+    @brief Function for checking whether a CGRAM slot is shown anywhere in DDRAM of a selected panel
+*/
+static uint8_t slot_on_glass(uint8_t slot) {
+    uint8_t panel;
+    uint8_t cell;
+
+    for(panel = 0; panel < num_panels; panel++) {
+	if(!(panel_mask & (1 << panel)))
+	    continue;
+	for(cell = 0; cell < LCD_DDRAM_SIZE; cell++)
+	    if((shadow.ddram[panel][cell] & 0xF7) == slot)
+		return 1;
+    }
+
+    return 0;
+}
+
+/*
+    @brief Function for converting a DDRAM address to a frame buffer index
+
+    @note line 1 starts at 0x00 and line 2 at 0x40, each holds LCD_LINE_LENGTH cells
+*/
+static uint8_t cell_index(uint8_t address) {
+    uint8_t col = (address & 0x3F) % LCD_LINE_LENGTH;
+
+    if(address & 0x40)
+	return LCD_LINE_LENGTH + col;
+    return col;
+}
+
+/*
+    @brief Function for converting a frame buffer index to a DDRAM address
+*/
+static uint8_t cell_address(uint8_t cell) {
+    if(cell >= LCD_LINE_LENGTH)
+	return 0x40 | (cell - LCD_LINE_LENGTH);
+    return cell;
+}
+
+/*
+    @brief Function for stepping a DDRAM address the way the address counter does
+
+    @note in 2 line mode the counter runs from the end of line 1 to the start of line 2 and wraps at the end of line 2
+*/
+static uint8_t ddram_step(uint8_t address, uint8_t forward) {
+    uint8_t cell = cell_index(address);
+
+    if(forward)
+	cell = (cell + 1) % LCD_DDRAM_SIZE;
+    else
+	cell = (cell + LCD_DDRAM_SIZE - 1) % LCD_DDRAM_SIZE;
+
+    return cell_address(cell);
+}
+
+/*
+    @brief Function for stepping the cursor past a written cell
+
+    @note in page flip mode the cursor wraps inside its line the way the hidden page does, the address counter runs
+	  on into the other line so lcd_bus_locate() sends an address command at the wrap
+*/
+static uint8_t cursor_step(uint8_t address, uint8_t forward) {
+    uint8_t col = (address & 0x3F) % LCD_LINE_LENGTH;
+
+    if(!page_flip)
+	return ddram_step(address, forward);
+
+    if(forward)
+	col = (col + 1) % LCD_LINE_LENGTH;
+    else
+	col = (col + LCD_LINE_LENGTH - 1) % LCD_LINE_LENGTH;
+
+    return (address & 0x40) | col;
+}
+
+/*
+    @brief Function for working out the port masks of the bus pins
+
+    @note called whenever the pins or the selected panels change, port_ok stays clear if a pin is not on port 0
+*/
+static void port_setup(void) {
+    const uint32_t pins[4] = {dat4_pin, dat5_pin, dat6_pin, dat7_pin};
+    uint8_t nibble;
+    uint8_t bit;
+    uint8_t panel;
+
+    port_ok = 0;
+    if(rs_pin >= 32 || dat4_pin >= 32 || dat5_pin >= 32 || dat6_pin >= 32 || dat7_pin >= 32)
+	return;
+
+    en_mask = 0;
+    for(panel = 0; panel < num_panels; panel++) {
+	if(!(panel_mask & (1 << panel)))
+	    continue;
+	if(en_pins[panel] >= 32)
+	    return;
+	en_mask |= (uint32_t)1 << en_pins[panel];
+    }
+
+    data_mask = 0;
+    for(nibble = 0; nibble < 16; nibble++) {
+	nibble_set[nibble] = 0;
+	for(bit = 0; bit < 4; bit++)
+	    if(nibble & (1 << bit))
+		nibble_set[nibble] |= (uint32_t)1 << pins[bit];
+    }
+    for(bit = 0; bit < 4; bit++)
+	data_mask |= (uint32_t)1 << pins[bit];
+
+    port_ok = 1;
+}
+
+/*
+    @brief Encode bytes into port words for DMA or timer driven playback
+
+    @note every byte becomes 5 words: register select and the high nibble with enable low, so they are set up before
+	  enable rises, the same with enable high, enable low again to latch it, then the low nibble with enable high
+	  and with enable low. Register select only changes while enable is low, the low nibble goes on the data pins
+	  as enable rises since they are only latched when it falls. A word holds the level of the bus pins only, OR
+	  in the other pins of the port before writing it to the OUT register. Hold every word at least 1us and the
+	  last word of each byte for the execution time of the instruction. The register mirror is updated as if the
+	  words had been played, so play all of them
+
+    @param[in] value Bytes to send
+
+    @param[in] mode Register select for each byte, 0 for a command and 1 for data
+
+    @param[in] length Number of bytes
+
+    @param[out] words Port words, LCD_PORT_WORDS per byte
+
+    @param[in] words_size Number of words that fit in words
+
+    @return number of words written, 0 if they don't fit or a bus pin is not on port 0
+*/
+uint16_t lcd_encode_port_words(const uint8_t * value, const uint8_t * mode, uint16_t length, uint32_t * words, uint16_t words_size) {
+    const uint32_t rs_mask = (uint32_t)1 << rs_pin;
+    uint32_t high;
+    uint32_t low;
+    uint16_t i;
+
+    if(!port_ok || lcd_transport != NULL || (uint32_t)length * LCD_PORT_WORDS > words_size)
+	return 0;
+
+    for(i = 0; i < length; i++) {
+	high = nibble_set[value[i] >> 4] | (mode[i] ? rs_mask : 0);
+	low = nibble_set[value[i] & 0x0F] | (mode[i] ? rs_mask : 0);
+
+	words[LCD_PORT_WORDS * i] = high; // tAS, register select settles before enable rises
+	words[LCD_PORT_WORDS * i + 1] = high | en_mask;
+	words[LCD_PORT_WORDS * i + 2] = high;
+	words[LCD_PORT_WORDS * i + 3] = low | en_mask;
+	words[LCD_PORT_WORDS * i + 4] = low;
+
+	bus_track(value[i], mode[i]);
+    }
+
+    return LCD_PORT_WORDS * length;
+}
+
+/*
+    @brief Mask of the bus pins in the port words
+
+    @note rs, the data pins and the enable pins of the selected panels, 0 if a bus pin is not on port 0
+*/
+uint32_t lcd_port_mask(void) {
+    if(!port_ok)
+	return 0;
+    return ((uint32_t)1 << rs_pin) | data_mask | en_mask;
+}
+
+/*
+    @brief Function for transmitting 4-bit data to LCD
+
+    @note sets the data pins to low or high based on the data to be sent
+
+    @param[in] data 4-bit Data to send to LCD
+*/
+void lcd_write_data(uint8_t data) {
+    if(port_ok) {
+	// all four data pins in one write
+	port_write(nibble_set[data & 0x0F], data_mask & ~nibble_set[data & 0x0F]);
+	enable_pulse();
+	return;
+    }
+
+    if(data & 1)
+	pin_write(dat4_pin, 1);
+    else
+	pin_write(dat4_pin, 0);
+    if(data & 2)
+	pin_write(dat5_pin, 1);
+    else
+	pin_write(dat5_pin, 0);
+    if(data & 4)
+	pin_write(dat6_pin, 1);
+    else
+	pin_write(dat6_pin, 0);
+    if(data & 8)
+	pin_write(dat7_pin, 1);
+    else
+	pin_write(dat7_pin, 0);
+
+    enable_pulse();
+}
+
+/*
+    @brief Function for pulsing the enable pin 
+
+    @note sends a 'clock' signal when sending data to the LCD, every selected panel is clocked by the same pulse
+*/
+void enable_pulse(void) {
+    uint8_t panel;
+
+    if(port_ok) {
+	port_write(0, en_mask);
+	delay_us(LCD_EN_SETUP_US);
+	port_write(en_mask, 0);
+	delay_us(LCD_EN_PULSE_US);
+	port_write(0, en_mask);
+	delay_us(LCD_EXEC_US);
+	return;
+    }
+
+    for(panel = 0; panel < num_panels; panel++)
+	if(panel_mask & (1 << panel))
+	    pin_write(en_pins[panel], 0);
+    delay_us(LCD_EN_SETUP_US);
+    for(panel = 0; panel < num_panels; panel++)
+	if(panel_mask & (1 << panel))
+	    pin_write(en_pins[panel], 1);
+    delay_us(LCD_EN_PULSE_US);
+    for(panel = 0; panel < num_panels; panel++)
+	if(panel_mask & (1 << panel))
+	    pin_write(en_pins[panel], 0);
+    delay_us(LCD_EXEC_US);
+}
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function for waiting a desired amount of microseconds
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] us_time The desired wait time in microseconds
+*/
+void delay_us(uint32_t us_time) {
+    nrf_delay_us(us_time);
+}
+
+/*
+    @brief Function for waiting a desired amount of miliseconds
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] ms_time The desired wait time in miliseconds
+*/
+void delay_ms(uint32_t ms_time) {
+    nrf_delay_ms(ms_time);
+}
+
+/*
+    @brief Function for reading a free running microsecond clock
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @note counts DWT cycles at 64MHz, has to be called at least once every 67 seconds to catch every wrap
+
+    @return microseconds since the first call, wraps after about 71 minutes
+*/
+uint32_t time_us(void) {
+    static uint8_t started = 0;
+    static uint32_t last_cycles = 0;
+    static uint32_t cycles = 0; // cycles not yet counted as a whole microsecond
+    static uint32_t micros = 0;
+    uint32_t now;
+
+    if(!started) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	last_cycles = DWT->CYCCNT;
+	started = 1;
+    }
+
+    now = DWT->CYCCNT;
+    cycles += now - last_cycles;
+    last_cycles = now;
+
+    micros += cycles / 64;
+    cycles %= 64;
+
+    return micros;
+}
+
+/*
+    @brief Function for writing a value to a pin
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to write to
+
+    @param[in] value Value to write to the pin (0 or 1, but I used 32 bit because that's what the nrf function takes)
+*/
+void pin_write(uint32_t pin_no, uint32_t value) {
+    nrf_gpio_pin_write(pin_no, value);
+}
+
+/*
+    @brief Function for setting and clearing pins of a port in one go
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] set_mask Pins of port 0 to set
+
+    @param[in] clear_mask Pins of port 0 to clear
+*/
+void port_write(uint32_t set_mask, uint32_t clear_mask) {
+    nrf_gpio_port_out_set(NRF_P0, set_mask);
+    nrf_gpio_port_out_clear(NRF_P0, clear_mask);
+}
+
+/*
+    @brief Function for making a pin an output
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to configure
+*/
+void pin_output(uint32_t pin_no) {
+    nrf_gpio_cfg_output(pin_no);
+}
+
+/*
+    @brief Function for making a pin an input
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to configure
+
+    @param[in] pull_up 1 to enable the pull-up, 0 to leave the pin floating
+*/
+void pin_input(uint32_t pin_no, uint32_t pull_up) {
+    nrf_gpio_cfg_input(pin_no, pull_up ? NRF_GPIO_PIN_PULLUP : NRF_GPIO_PIN_NOPULL);
+}
+
+/*
+    @brief Function for reading a pin
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to read
+
+    @return level of the pin, 0 or 1
+*/
+uint32_t pin_read(uint32_t pin_no) {
+    return nrf_gpio_pin_read(pin_no);
+}
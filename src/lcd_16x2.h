@@ -55,6 +55,113 @@
 #define LCD_5x8DOTS 0x00
 
 #define NUM_LINES 2
+#define NUM_COLS 16
+
+// DDRAM layout, 2 lines of 40 cells whatever the size of the glass
+#define LCD_LINE_LENGTH 40
+#define LCD_DDRAM_SIZE (2 * LCD_LINE_LENGTH)
+
+// cell attributes
+#define LCD_ATTR_BLINK 0x01
+#define LCD_ATTR_INVERSE 0x02
+
+// ways of showing blinking cells, cheapest first
+#define LCD_BLINK_NONE 0
+#define LCD_BLINK_CURSOR 1 // hardware cursor blink on the only blinking cell
+#define LCD_BLINK_DISPLAY 2 // the whole screen blinks, toggle the display
+#define LCD_BLINK_GLYPH 3 // every blinking cell shows the same CGRAM character, swap it for a blank
+#define LCD_BLINK_REWRITE 4 // rewrite the cells
+
+// panels that can share the data bus, each on its own enable pin, build with e.g. -DLCD_MAX_PANELS=2
+#ifndef LCD_MAX_PANELS
+#define LCD_MAX_PANELS 1
+#endif
+
+// 32 bit words in the dirty cell bitmap
+#define LCD_DIRTY_WORDS ((LCD_DDRAM_SIZE + 31) / 32)
+
+// bytes held by the flush plan, a full screen needs LCD_DDRAM_SIZE + 1
+#define LCD_PLAN_SIZE (2 * (LCD_DDRAM_SIZE + 1))
+
+/*
+    @brief Transport used to move whole bytes to the LCD controller
+
+    @note lets the driver talk to an LCD behind an I2C expander or a serial controller instead of the 4 bit gpio bus
+
+    @note leave write_buffer NULL to send a buffer one byte at a time through send
+
+    @note batch is optional, the driver calls it with 1 before sending a flush plan and with 0 after, a transport
+	  with a high cost per transfer may hold the bytes in between back and send them as one
+*/
+typedef struct {
+    void (*send)(uint8_t value, uint8_t mode); // send a byte to the instruction (0) or data (1) register
+    void (*write_buffer)(const uint8_t * data, uint16_t length, uint8_t mode); // send a burst of bytes to one register
+    uint16_t byte_us; // time one byte keeps the bus busy, in microseconds
+    void (*batch)(uint8_t open); // open or close a batch of bytes that may go out together, NULL for none
+} lcd_transport_t;
+
+// timing profile of the controller, override them for slower clones
+#ifndef LCD_EN_SETUP_US
+#define LCD_EN_SETUP_US 1 // enable low before the pulse
+#endif
+#ifndef LCD_EN_PULSE_US
+#define LCD_EN_PULSE_US 1 // enable high
+#endif
+#ifndef LCD_EXEC_US
+#define LCD_EXEC_US 100 // after every nibble, most instructions take 37us
+#endif
+#ifndef LCD_CLEAR_MS
+#define LCD_CLEAR_MS 2 // clear display and return home take 1.52ms
+#endif
+#ifndef LCD_POWER_UP_MS
+#define LCD_POWER_UP_MS 50 // from power on to the first instruction, at least 40ms
+#endif
+#ifndef LCD_WAKE_MS
+#define LCD_WAKE_MS 5 // after the first two wake up function sets, at least 4.1ms
+#endif
+#ifndef LCD_WAKE_LAST_US
+#define LCD_WAKE_LAST_US 150 // after the third, at least 100us
+#endif
+
+// time one nibble keeps the 4 bit gpio bus busy, in microseconds
+#define LCD_NIBBLE_US (LCD_EN_SETUP_US + LCD_EN_PULSE_US + LCD_EXEC_US)
+
+// time one byte keeps the 4 bit gpio bus busy, two enable pulses, in microseconds
+#define LCD_BYTE_US (2 * LCD_NIBBLE_US)
+
+// how often the waits for clear, return home and wake up hand the data pins to the lcd_set_bus_gap() callback
+#ifndef LCD_IDLE_POLL_US
+#define LCD_IDLE_POLL_US 10
+#endif
+
+// port words lcd_encode_port_words() makes of every byte
+#define LCD_PORT_WORDS 5
+
+/*
+    @brief Callback deciding whether the bus may be used
+
+    @param[in] duration_us length of the transfer that wants to start now
+
+    @return nonzero if the transfer may start
+*/
+typedef uint8_t (*lcd_window_fn)(uint32_t duration_us);
+
+/*
+    @brief Callback run between bytes and during long waits on the 4 bit gpio bus
+
+    @param[in] free_us Time the data pins stay free for, 0 between bytes where the next byte is waiting
+*/
+typedef void (*lcd_gap_fn)(uint32_t free_us);
+
+/*
+    @brief Bus window statistics
+*/
+typedef struct {
+    uint32_t bytes; // bytes sent
+    uint32_t busy_us; // bus time used by those bytes
+    uint32_t deferred; // transfers that had to wait for a window
+    uint32_t deferred_us; // total time spent waiting
+} lcd_window_stats_t;
 
 /*******************************[ High-Level Sensor Functions For General Use ]****************************************/
 
@@ -77,6 +184,81 @@
 */
 void lcd_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t dat6, uint32_t dat7);
 
+/*
+    @brief Initialize the LCD through a byte wide transport
+
+    @note implements the 8 bit initialization sequence according to datasheet, for transports that move whole bytes (8-bit bus or serial controllers)
+
+    @param[in] transport Transport used for every transfer from now on, must stay valid
+*/
+void lcd_init_transport(const lcd_transport_t * transport);
+
+/*
+    @brief Add another panel on the same data bus
+
+    @note the panel shares rs and the data pins with the first one and only has its own enable pin, it is initialized
+	  on its own and then every panel is selected, so everything drawn afterwards goes to all of them at once.
+	  Call it right after lcd_init(), the initialization clears the frame buffer. Only for the 4 bit gpio bus
+
+    @param[in] en Enable pin number of the new panel
+
+    @return number of the panel for lcd_select_panels(), 0xFF if LCD_MAX_PANELS are already in use
+*/
+uint8_t lcd_add_panel(uint32_t en);
+
+/*
+    @brief Choose the panels that take part in transfers
+
+    @note every selected panel latches the same strobes, so mirroring any number of panels costs the bus time of one.
+	  The driver keeps a shadow of each panel's glass, a cell is only sent when a selected panel doesn't already
+	  show it. Display shift and custom characters are tracked once, keep them the same on every panel
+
+    @param[in] mask Bit per panel, bit 0 is the panel set up by lcd_init()
+*/
+void lcd_select_panels(uint8_t mask);
+
+/*
+    @brief Warm start the LCD for 4-bit interface
+
+    @note if the shadow kept in retained RAM is intact the panel still shows it, so only the nibble phase is resynced
+	  and the registers are restored, nothing is cleared and drawing the same screen again sends only the cells
+	  that differ, otherwise falls back to lcd_init()
+
+    @param[in] rs Register Select pin number
+
+    @param[in] en Enable pin number
+    
+    @param[in] dat4 Data4 pin number
+
+    @param[in] dat5 Data5 pin number
+
+    @param[in] dat6 Data6 pin number
+
+    @param[in] dat7 Data7 pin number
+
+    @return 1 if the panel was picked up as it was, 0 if it was initialized from scratch
+*/
+uint8_t lcd_warm_init(uint32_t rs, uint32_t en, uint32_t dat4, uint32_t dat5, uint32_t dat6, uint32_t dat7);
+
+/*
+    @brief Warm start the LCD through a byte wide transport
+
+    @note same as lcd_warm_init() for transports that move whole bytes, falls back to lcd_init_transport()
+
+    @param[in] transport Transport used for every transfer from now on, must stay valid
+
+    @return 1 if the panel was picked up as it was, 0 if it was initialized from scratch
+*/
+uint8_t lcd_warm_init_transport(const lcd_transport_t * transport);
+
+/*
+    @brief Seal the shadow of the panel so a warm start can trust it
+
+    @note called by lcd_flush(), call it after drawing without write combining, anything sent
+	  after the last seal makes lcd_warm_init() fall back to a full initialization
+*/
+void lcd_retain(void);
+
 /*
     @brief Function for turning the display off
 */
@@ -145,11 +327,16 @@ void lcd_autoscroll_off(void);
 
 /*
     @brief Function for writing text right to left
+
+    @note each character lands left of the one before, with write combining on nothing is sent, the controller
+	  follows with the next write that needs it
 */
 void lcd_right_to_left(void);
 
 /*
     @brief Function for writing text left to right
+
+    @note with write combining on nothing is sent, the controller follows with the next write that needs it
 */
 void lcd_left_to_right(void);
 
@@ -162,6 +349,33 @@ void lcd_left_to_right(void);
 */
 void lcd_set_cursor(uint16_t col, uint8_t row);
 
+/*
+    @brief Set the attributes of a run of cells
+
+    @note the cheapest way to show them is picked every time attributes change: a single blinking cell uses the
+	  hardware cursor blink (0 bus bytes per blink period), a blinking whole screen toggles the display
+	  (2 commands per period), blinking cells that all show one CGRAM character swap that slot for a blank
+	  (2 x 9 bytes per period), anything else rewrites the cells (an address command and a byte per cell,
+	  twice per period). Inverse swaps the CGRAM slot shown in the cell for its inverted bitmap, so it only
+	  works on custom characters and applies to every cell showing that character
+
+    @param[in] col column number, same as lcd_set_cursor()
+
+    @param[in] row row number
+
+    @param[in] length number of cells
+
+    @param[in] attr LCD_ATTR_BLINK and/or LCD_ATTR_INVERSE, 0 for plain cells
+*/
+void lcd_set_attr(uint16_t col, uint8_t row, uint8_t length, uint8_t attr);
+
+/*
+    @brief Advance the blink phase
+
+    @note call this every half blink period, e.g. every 500ms from a timer
+*/
+void lcd_attr_tick(void);
+
 /*
     @brief Function for printing a character to LCD at current position
 
@@ -178,6 +392,231 @@ void lcd_write_char(char data);
 */
 void lcd_write_string(char * str);
 
+/*
+    @brief Write a buffer of ROM codes to LCD at current position
+
+    @note bulk write path, the buffer is not null terminated so any of the 256 ROM codes can be sent
+
+    @param[in] data Buffer of character codes to be written to the screen
+
+    @param[in] length Number of bytes in the buffer
+*/
+void lcd_write_buffer(const uint8_t * data, uint16_t length);
+
+/*
+    @brief Write a buffer of ROM codes ending at the current position
+
+    @note the last byte lands on the cursor and the others to its left, the buffer is sent from its end with the
+	  address counter counting down, so right aligned text needs neither its width worked out nor an address
+	  command per character. The cursor is left on the cell before the first byte, nothing is written while the
+	  cursor is in CGRAM
+
+    @param[in] data Buffer of character codes to be written to the screen
+
+    @param[in] length Number of bytes in the buffer
+*/
+void lcd_write_buffer_right(const uint8_t * data, uint16_t length);
+
+/*
+    @brief Load a custom character into CGRAM
+
+    @note the character is printed with lcd_write_char(location), the cursor position is lost so call lcd_set_cursor() afterwards
+
+    @note nothing is sent if the slot already holds the bitmap
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
+*/
+void lcd_create_char(uint8_t location, const uint8_t charmap[8]);
+
+/*
+    @brief Send as much of the pending cells as fits the current bus window
+
+    @note never blocks, call it again when the next window opens, a byte is never split across windows
+
+    @return number of bytes still waiting, 0 once everything is on the glass
+*/
+uint8_t lcd_flush_poll(void);
+
+/*
+    @brief Set the callback telling the driver when it may use the bus
+
+    @note every transfer waits for the callback to allow it, lcd_flush_poll() stops instead of waiting
+
+    @param[in] window Callback returning nonzero if a transfer of the given length in microseconds may start now,
+		      NULL to allow the bus at any time
+*/
+void lcd_set_bus_window(lcd_window_fn window);
+
+/*
+    @brief Read and reset the bus window statistics
+
+    @note utilisation is busy_us over the time the windows were open, deferred_us is the latency added by waiting
+
+    @param[out] stats Statistics since the last call
+*/
+void lcd_get_window_stats(lcd_window_stats_t * stats);
+
+/*
+    @brief Set the callback run between bytes on the 4 bit gpio bus
+
+    @note runs with enable low after both nibbles of a byte, so the nibble phase is never split, and every
+	  LCD_IDLE_POLL_US while clear, return home or wake up is executing. It may borrow the data pins, e.g. to
+	  scan a keypad, as long as they are outputs again when it returns
+
+    @param[in] gap Callback, NULL for none
+*/
+void lcd_set_bus_gap(lcd_gap_fn gap);
+
+/*
+    @brief Do one byte of background work while the bus is free
+
+    @note call it whenever the application has nothing to draw, it sends at most one byte so anything in the
+	  foreground waits for a byte at most. Does nothing while a flush plan is pending or the application is
+	  writing CGRAM. In order: uploads queued custom characters to slots not on the glass, sends pending
+	  cells that are off screen (the hidden page in page flip mode), then rewrites visible cells from the
+	  shadow if scrubbing is on
+
+    @return 1 if a byte was sent, 0 if there was nothing to do or the bus window is closed
+*/
+uint8_t lcd_idle_task(void);
+
+/*
+    @brief Queue a custom character for upload by lcd_idle_task()
+
+    @note use it for characters the next screen is likely to need, e.g. the neighbours of a menu entry. A slot shown
+	  on the glass is not touched until it is no longer shown, lcd_create_char() with the same bitmap then sends
+	  nothing
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
+*/
+void lcd_prefetch_char(uint8_t location, const uint8_t charmap[8]);
+
+/*
+    @brief Function for turning on scrubbing
+
+    @note lcd_idle_task() rewrites the visible cells from the shadow one at a time when it has nothing else to do,
+	  which repairs a glass upset by noise. There is no RW pin so nothing is read back
+*/
+void lcd_scrub_on(void);
+
+/*
+    @brief Function for turning off scrubbing
+*/
+void lcd_scrub_off(void);
+
+/*
+    @brief Function for turning on page flip mode
+
+    @note lcd_set_cursor() now draws into the NUM_COLS hidden columns right after the visible ones,
+	  lcd_flip_page() then brings them on screen in one go, writes wrap inside the line like the page does
+*/
+void lcd_page_flip_on(void);
+
+/*
+    @brief Function for turning off page flip mode
+
+    @note lcd_set_cursor() goes back to plain DDRAM columns, the display shift is kept
+*/
+void lcd_page_flip_off(void);
+
+/*
+    @brief Show the hidden page
+
+    @note shifts the display left by NUM_COLS, or returns home when that lands on shift 0, the old page becomes hidden
+	  and is the next one drawn, draw the whole page since it still holds older content
+*/
+void lcd_flip_page(void);
+
+/*
+    @brief Function for turning on write combining
+
+    @note writes are kept in the frame buffer and sent by lcd_flush(), cursor moves are free,
+	  consecutive cells are sent as one run and cells written twice are only sent once
+*/
+void lcd_write_combine_on(void);
+
+/*
+    @brief Function for turning off write combining
+
+    @note flushes anything still pending
+*/
+void lcd_write_combine_off(void);
+
+/*
+    @brief Send every pending cell to the LCD
+
+    @note one address command per run of consecutive cells, skipped if the address counter is already there
+*/
+void lcd_flush(void);
+
+/*
+    @brief Encode every pending cell into the flush plan without touching the bus
+
+    @note the plan is sent by the next lcd_flush() or lcd_present_at(), cells written afterwards are added to it
+*/
+void lcd_prepare_flush(void);
+
+/*
+    @brief Get the part of the flush plan not sent yet
+
+    @note call lcd_prepare_flush() first, pass the bytes to lcd_cost_sequence() to know what sending them will cost
+
+    @param[out] value Set to the command and data bytes
+
+    @param[out] mode Set to the register select of each byte
+
+    @return number of bytes
+*/
+uint16_t lcd_plan_pending(const uint8_t ** value, const uint8_t ** mode);
+
+/*
+    @brief Send the flush plan when a timestamp is reached
+
+    @note prepares anything still pending, waits for the deadline and then only sends the plan,
+	  so the frame appears as close to the deadline as the bus allows
+
+    @param[in] timestamp Time to start sending, in time_us() microseconds
+
+    @return how late the plan started in microseconds, negative never happens unless time_us() wrapped
+*/
+int32_t lcd_present_at(uint32_t timestamp);
+
+/*
+    @brief Encode bytes into port words for DMA or timer driven playback
+
+    @note every byte becomes 5 words: register select and the high nibble with enable low, so they are set up before
+	  enable rises, the same with enable high, enable low again to latch it, then the low nibble with enable high
+	  and with enable low. Register select only changes while enable is low, the low nibble goes on the data pins
+	  as enable rises since they are only latched when it falls. A word holds the level of the bus pins only, OR
+	  in the other pins of the port before writing it to the OUT register. Hold every word at least 1us and the
+	  last word of each byte for the execution time of the instruction. The register mirror is updated as if the
+	  words had been played, so play all of them
+
+    @param[in] value Bytes to send
+
+    @param[in] mode Register select for each byte, 0 for a command and 1 for data
+
+    @param[in] length Number of bytes
+
+    @param[out] words Port words, LCD_PORT_WORDS per byte
+
+    @param[in] words_size Number of words that fit in words
+
+    @return number of words written, 0 if they don't fit or a bus pin is not on port 0
+*/
+uint16_t lcd_encode_port_words(const uint8_t * value, const uint8_t * mode, uint16_t length, uint32_t * words, uint16_t words_size);
+
+/*
+    @brief Mask of the bus pins in the port words
+
+    @note rs, the data pins and the enable pins of the selected panels, 0 if a bus pin is not on port 0
+*/
+uint32_t lcd_port_mask(void);
+
 /*
     @brief Function for printing an integer to the LCD
 
@@ -187,10 +626,22 @@ void lcd_write_string(char * str);
 */
 void lcd_write_int(uint32_t num);
 
+/*
+    @brief Function for printing an integer right aligned on the current position
+
+    @note the digits are made from the last one up and written leftwards, see lcd_write_buffer_right(), cells up to
+	  width are blanked so a shorter number doesn't leave digits of a longer one behind
+
+    @param[in] num 32-bit integer to write to the LCD
+
+    @param[in] width Cells the field takes, 0 for just the number
+*/
+void lcd_write_int_right(int32_t num, uint8_t width);
+
 /*
     @brief Function for printing a float to the LCD
 
-    @note copies the float into a string and calls lcd_write_string()
+    @note copies the float into a string and calls lcd_write_string(), cut to one line of 16 characters
 
     @param[in] num float to write to the LCD
 */
@@ -221,6 +672,10 @@ void lcd_write(uint8_t value);
 
     @note since the LCD is in 4 bit mode, we write the upper 4 bits and then the lower 4 bits of the command/value
 
+    @note hands the byte to the transport instead when the LCD was set up with lcd_init_transport()
+
+    @note with write combining on, data and cursor moves are held back until lcd_flush()
+
     @param[in] value Command or ASCII character to write to LCD
 
     @param[in] mode Instruction or Data (0 or 1)
@@ -239,7 +694,7 @@ void lcd_write_data(uint8_t data);
 /*
     @brief Function for pulsing the enable pin 
 
-    @note sends a 'clock' signal when sending data to the LCD
+    @note sends a 'clock' signal when sending data to the LCD, every selected panel is clocked by the same pulse
 */
 void enable_pulse(void);
 
@@ -265,6 +720,18 @@ void delay_ms(uint32_t ms_time);
 */
 void delay_us(uint32_t us_time);
 
+/*
+    @brief Function for reading a free running microsecond clock
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @note counts DWT cycles at 64MHz, has to be called at least once every 67 seconds to catch every wrap
+
+    @return microseconds since the first call, wraps after about 71 minutes
+*/
+uint32_t time_us(void);
+
 /*
     @brief Function for writing a value to a pin
 
@@ -277,4 +744,50 @@ void delay_us(uint32_t us_time);
 */
 void pin_write(uint32_t pin_no, uint32_t value);
 
+/*
+    @brief Function for setting and clearing pins of a port in one go
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] set_mask Pins of port 0 to set
+
+    @param[in] clear_mask Pins of port 0 to clear
+*/
+void port_write(uint32_t set_mask, uint32_t clear_mask);
+
+/*
+    @brief Function for making a pin an output
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to configure
+*/
+void pin_output(uint32_t pin_no);
+
+/*
+    @brief Function for making a pin an input
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to configure
+
+    @param[in] pull_up 1 to enable the pull-up, 0 to leave the pin floating
+*/
+void pin_input(uint32_t pin_no, uint32_t pull_up);
+
+/*
+    @brief Function for reading a pin
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] pin_no Pin number to read
+
+    @return level of the pin, 0 or 1
+*/
+uint32_t pin_read(uint32_t pin_no);
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,94 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_asset.c
+
+  @Summary
+    Streaming decoder for compressed LCD assets
+
+  @Description
+    Implements the decoder that plays a packed asset onto the LCD token by token
+******************************************************************************/
+
+#include "lcd_asset.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Play a packed asset onto the LCD
+
+    @note decodes the whole asset, literals are sent straight from flash through lcd_write_buffer()
+
+    @param[in] asset Packed asset, terminated by an END token
+*/
+void lcd_asset_play(const uint8_t * asset) {
+    lcd_asset_decoder_t dec;
+
+    lcd_asset_begin(&dec, asset);
+    while(lcd_asset_step(&dec))
+	;
+}
+
+/*
+    @brief Start decoding a packed asset one token at a time
+
+    @param[out] dec Decoder state
+
+    @param[in] asset Packed asset, terminated by an END token
+*/
+void lcd_asset_begin(lcd_asset_decoder_t * dec, const uint8_t * asset) {
+    dec->next = asset;
+    dec->done = 0;
+}
+
+/*
+    @brief Decode and send the next token of an asset
+
+    @note lets the caller interleave other work between tokens
+
+    @param[in,out] dec Decoder state
+
+    @return 1 while there are tokens left, 0 once the asset is finished
+*/
+uint8_t lcd_asset_step(lcd_asset_decoder_t * dec) {
+    uint8_t token;
+    uint8_t count;
+
+    if(dec->done)
+	return 0;
+
+    token = *dec->next++;
+
+    if(token < LCD_ASSET_RUN) {
+	// literal, send it in place
+	count = token + 1;
+	lcd_write_buffer(dec->next, count);
+	dec->next += count;
+    }
+    else if(token < LCD_ASSET_CURSOR) {
+	// run of one repeated ROM code
+	count = (token & 0x3F) + LCD_ASSET_MIN_RUN;
+	while(count--)
+	    lcd_write(*dec->next);
+	dec->next++;
+    }
+    else if(token == LCD_ASSET_CURSOR) {
+	lcd_command(LCD_SETDDRAMADDR | *dec->next++);
+    }
+    else if(token == LCD_ASSET_GLYPH) {
+	lcd_create_char(dec->next[0], &dec->next[1]);
+	dec->next += 9;
+    }
+    else if(token == LCD_ASSET_CLEAR) {
+	lcd_clear();
+    }
+    else {
+	// END or an unknown token, stop here rather than play garbage
+	dec->done = 1;
+    }
+
+    return !dec->done;
+}
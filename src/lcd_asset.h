@@ -0,0 +1,145 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_asset.h
+
+  @Summary
+    Compressed screen and glyph assets for the 16x2 LCD
+
+  @Description
+    Defines the packed asset format, the streaming decoder that plays an asset
+    straight onto the LCD and the packer used to build assets on the host.
+
+    An asset is a stream of tokens:
+
+      0x00-0x7F  LITERAL  (token + 1) ROM codes follow, 1 to 128 bytes
+      0x80-0xBF  RUN      the next byte is repeated (token & 0x3F) + 3 times, 3 to 66 bytes
+      0xC0       CURSOR   the next byte is a raw DDRAM address
+      0xC1       GLYPH    the next byte is a CGRAM slot followed by 8 rows of pixel data
+      0xC2       CLEAR    clears the display
+      0xFF       END      end of the asset
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_ASSET_H
+#define LCD_ASSET_H
+
+// asset tokens
+#define LCD_ASSET_LITERAL 0x00
+#define LCD_ASSET_RUN 0x80
+#define LCD_ASSET_CURSOR 0xC0
+#define LCD_ASSET_GLYPH 0xC1
+#define LCD_ASSET_CLEAR 0xC2
+#define LCD_ASSET_END 0xFF
+
+// token limits
+#define LCD_ASSET_MAX_LITERAL 128
+#define LCD_ASSET_MIN_RUN 3
+#define LCD_ASSET_MAX_RUN 66
+
+/*
+    @brief Streaming decoder state
+
+    @note a few bytes, the asset is read in place so no decompression buffer is needed
+*/
+typedef struct {
+    const uint8_t * next; // next unread byte of the asset
+    uint8_t done; // set once the END token has been played
+} lcd_asset_decoder_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Play a packed asset onto the LCD
+
+    @note decodes the whole asset, literals are sent straight from flash through lcd_write_buffer()
+
+    @param[in] asset Packed asset, terminated by an END token
+*/
+void lcd_asset_play(const uint8_t * asset);
+
+/*
+    @brief Start decoding a packed asset one token at a time
+
+    @param[out] dec Decoder state
+
+    @param[in] asset Packed asset, terminated by an END token
+*/
+void lcd_asset_begin(lcd_asset_decoder_t * dec, const uint8_t * asset);
+
+/*
+    @brief Decode and send the next token of an asset
+
+    @note lets the caller interleave other work between tokens
+
+    @param[in,out] dec Decoder state
+
+    @return 1 while there are tokens left, 0 once the asset is finished
+*/
+uint8_t lcd_asset_step(lcd_asset_decoder_t * dec);
+
+/*******************************[ Packer Functions, Host or Target ]****************************************/
+
+/*
+    @brief Pack a block of ROM codes into LITERAL and RUN tokens
+
+    @note runs shorter than LCD_ASSET_MIN_RUN are folded into the surrounding literal
+
+    @param[in] data ROM codes to pack
+
+    @param[in] length Number of ROM codes
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_text(const uint8_t * data, uint16_t length, uint8_t * out, uint16_t out_size);
+
+/*
+    @brief Append a CURSOR token
+
+    @param[in] col column number
+
+    @param[in] row row number
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_cursor(uint8_t col, uint8_t row, uint8_t * out, uint16_t out_size);
+
+/*
+    @brief Append a GLYPH token
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_glyph(uint8_t location, const uint8_t charmap[8], uint8_t * out, uint16_t out_size);
+
+/*
+    @brief Append a single byte token (CLEAR or END)
+
+    @param[in] token LCD_ASSET_CLEAR or LCD_ASSET_END
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_token(uint8_t token, uint8_t * out, uint16_t out_size);
+
+#endif
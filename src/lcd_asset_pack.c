@@ -0,0 +1,165 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_asset_pack.c
+
+  @Summary
+    Packer for compressed LCD assets
+
+  @Description
+    Implements the functions that build packed assets. Has no hardware
+    dependencies so it can be compiled into host tools as well as firmware.
+******************************************************************************/
+
+#include "lcd_asset.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const uint8_t pack_row_offsets[4] = {0x00, 0x40, 0x10, 0x50}; // same layout as lcd_set_cursor()
+
+/*
+    @brief Function for appending a literal token
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+static uint16_t pack_literal(const uint8_t * data, uint16_t length, uint8_t * out, uint16_t out_size) {
+    if(length == 0)
+	return 0;
+    if(length + 1 > out_size)
+	return 0;
+
+    out[0] = LCD_ASSET_LITERAL | (length - 1);
+    memcpy(&out[1], data, length);
+    return length + 1;
+}
+
+/*******************************[ Packer Functions, Host or Target ]****************************************/
+
+/*
+    @brief Pack a block of ROM codes into LITERAL and RUN tokens
+
+    @note runs shorter than LCD_ASSET_MIN_RUN are folded into the surrounding literal
+
+    @param[in] data ROM codes to pack
+
+    @param[in] length Number of ROM codes
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_text(const uint8_t * data, uint16_t length, uint8_t * out, uint16_t out_size) {
+    uint16_t pos = 0; // bytes written to out
+    uint16_t lit_start = 0; // start of the pending literal
+    uint16_t i = 0;
+    uint16_t run;
+    uint16_t written;
+
+    while(i < length) {
+	// measure the run starting here
+	run = 1;
+	while(i + run < length && data[i + run] == data[i] && run < LCD_ASSET_MAX_RUN)
+	    run++;
+
+	if(run >= LCD_ASSET_MIN_RUN) {
+	    written = pack_literal(&data[lit_start], i - lit_start, &out[pos], out_size - pos);
+	    if(i > lit_start && written == 0)
+		return 0;
+	    pos += written;
+
+	    if(pos + 2 > out_size)
+		return 0;
+	    out[pos++] = LCD_ASSET_RUN | (run - LCD_ASSET_MIN_RUN);
+	    out[pos++] = data[i];
+
+	    i += run;
+	    lit_start = i;
+	}
+	else {
+	    i++;
+	    if(i - lit_start == LCD_ASSET_MAX_LITERAL) {
+		written = pack_literal(&data[lit_start], i - lit_start, &out[pos], out_size - pos);
+		if(written == 0)
+		    return 0;
+		pos += written;
+		lit_start = i;
+	    }
+	}
+    }
+
+    written = pack_literal(&data[lit_start], length - lit_start, &out[pos], out_size - pos);
+    if(length > lit_start && written == 0)
+	return 0;
+    pos += written;
+
+    return pos;
+}
+
+/*
+    @brief Append a CURSOR token
+
+    @param[in] col column number
+
+    @param[in] row row number
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_cursor(uint8_t col, uint8_t row, uint8_t * out, uint16_t out_size) {
+    if(out_size < 2)
+	return 0;
+    if(row > 3)
+	row = 3;
+
+    out[0] = LCD_ASSET_CURSOR;
+    out[1] = col + pack_row_offsets[row];
+    return 2;
+}
+
+/*
+    @brief Append a GLYPH token
+
+    @param[in] location CGRAM slot number (0-7)
+
+    @param[in] charmap 8 rows of 5 bit pixel data
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_glyph(uint8_t location, const uint8_t charmap[8], uint8_t * out, uint16_t out_size) {
+    if(out_size < 10)
+	return 0;
+
+    out[0] = LCD_ASSET_GLYPH;
+    out[1] = location & 0x07;
+    memcpy(&out[2], charmap, 8);
+    return 10;
+}
+
+/*
+    @brief Append a single byte token (CLEAR or END)
+
+    @param[in] token LCD_ASSET_CLEAR or LCD_ASSET_END
+
+    @param[out] out Output buffer
+
+    @param[in] out_size Size of the output buffer
+
+    @return number of bytes written to out, 0 if out is too small
+*/
+uint16_t lcd_asset_pack_token(uint8_t token, uint8_t * out, uint16_t out_size) {
+    if(out_size < 1)
+	return 0;
+
+    out[0] = token;
+    return 1;
+}
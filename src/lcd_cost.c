@@ -0,0 +1,319 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_cost.c
+
+  @Summary
+    Bus time and CPU cost of LCD operations before they are sent
+
+  @Description
+    Implements the cost model, it follows the sequences lcd_16x2.c sends and
+    the delays it adds step by step
+******************************************************************************/
+
+#include "lcd_cost.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+
+#define COST_INT_CHARS 10 // "4294967295", lcd_write_int() prints unsigned
+#define COST_INT_RIGHT_CHARS 11 // "-2147483648", lcd_write_int_right() takes a signed number
+#define COST_ENTRY 1 // entry mode command a write may send first, see lcd_cost_api()
+#define COST_FLOAT_CHARS 16 // lcd_write_float() cuts the number to one line
+#define COST_GLYPH (1 + 8) // CGRAM address and the 8 rows of a custom character
+#define COST_PANELS 2 // display control and entry mode sent to a new panel selection
+
+static void cost_bytes(const lcd_cost_config_t * config, uint32_t bytes, lcd_cost_t * cost);
+static void cost_wait(uint32_t wait_us, lcd_cost_t * cost);
+static uint32_t cost_blink_bytes(uint16_t length);
+static void cost_flip(const lcd_cost_config_t * config, lcd_cost_t * cost);
+static void cost_warm(const lcd_cost_config_t * config, lcd_cost_t * cost);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up the cost of the 4 bit gpio bus
+
+    @param[out] config Configuration to fill in
+*/
+void lcd_cost_config_gpio(lcd_cost_config_t * config) {
+    config->byte_us = LCD_BYTE_US;
+    config->cpu_byte_us = LCD_BYTE_US; // every enable pulse is waited out
+    config->gap_us = 0;
+    config->byte_wide = 0;
+}
+
+/*
+    @brief Set up the cost of a byte wide transport
+
+    @note the driver waits for every byte the transport sends, lower cpu_byte_us afterwards if it doesn't
+
+    @param[out] config Configuration to fill in
+
+    @param[in] transport Transport given to lcd_init_transport()
+*/
+void lcd_cost_config_transport(lcd_cost_config_t * config, const lcd_transport_t * transport) {
+    config->byte_us = transport->byte_us;
+    config->cpu_byte_us = transport->byte_us;
+    config->gap_us = 0;
+    config->byte_wide = 1;
+}
+
+/*
+    @brief Add the cost of a byte sequence
+
+    @note clear and return home count with the wait lcd_clear() and lcd_home() add after them, every cost
+	  function adds to cost so the parts of an update can be summed, clear it first
+
+    @param[in] config Bus
+
+    @param[in] value Command and data bytes
+
+    @param[in] mode Register select of each byte, 0 for commands
+
+    @param[in] length Number of bytes
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_sequence(const lcd_cost_config_t * config, const uint8_t * value, const uint8_t * mode, uint16_t length,
+		       lcd_cost_t * cost) {
+    uint16_t i;
+
+    cost_bytes(config, length, cost);
+
+    for(i = 0; i < length; i++)
+	if(!mode[i] && value[i] != 0 && (value[i] & ~(LCD_CLEARDISPLAY | LCD_RETURNHOME)) == 0)
+	    cost_wait((uint32_t)LCD_CLEAR_MS * 1000, cost);
+}
+
+/*
+    @brief Add the cost of writing a string without write combining
+
+    @note one address command and a byte per character, the command is left out when the address counter is
+	  already there
+
+    @param[in] config Bus
+
+    @param[in] length Number of characters
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_string(const lcd_cost_config_t * config, uint16_t length, lcd_cost_t * cost) {
+    // the address counter follows the cursor from one character to the next, even across the line wrap
+    if(length != 0)
+	cost_bytes(config, (uint32_t)length + 1, cost);
+}
+
+/*
+    @brief Add the cost of initializing the LCD from power up
+
+    @param[in] config Bus, byte_wide picks lcd_init_transport() over lcd_init()
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_init(const lcd_cost_config_t * config, lcd_cost_t * cost) {
+    static const uint8_t setup_value[] = {LCD_FUNCTIONSET, LCD_DISPLAYCONTROL, LCD_CLEARDISPLAY, LCD_ENTRYMODESET};
+    static const uint8_t setup_mode[] = {0, 0, 0, 0};
+
+    cost_wait((uint32_t)LCD_POWER_UP_MS * 1000, cost);
+
+    // three function sets with their waits, then 4 bit mode on the gpio bus, as 4 nibbles that take as long as
+    // 2 bytes and skip the gap callback
+    if(config->byte_wide) {
+	cost_bytes(config, 3, cost);
+    }
+    else {
+	cost->bytes += 2;
+	cost->bus_us += 2 * config->byte_us;
+	cost->cpu_us += 2 * config->cpu_byte_us;
+    }
+    cost_wait((uint32_t)LCD_WAKE_MS * 1000 * 2 + LCD_WAKE_LAST_US, cost);
+
+    lcd_cost_sequence(config, setup_value, setup_mode, sizeof(setup_value), cost);
+}
+
+/*
+    @brief Add the worst case cost of a public API
+
+    @note assumes write combining is off, a single panel and no bus window, with write combining on writes cost
+	  nothing until lcd_flush() and commands other than cursor moves and repeated display control flush first. Writes
+	  include the entry mode command that puts the direction back after a right aligned write
+
+    @param[in] config Bus
+
+    @param[in] api LCD_COST_...
+
+    @param[in] length Characters or bytes for LCD_COST_WRITE_STRING and LCD_COST_WRITE_BUFFER, cells for
+		      LCD_COST_WRITE_INT_RIGHT, blinking cells for LCD_COST_SET_ATTR and LCD_COST_ATTR_TICK, ignored
+		      otherwise
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_api(const lcd_cost_config_t * config, uint8_t api, uint16_t length, lcd_cost_t * cost) {
+    switch(api) {
+    case LCD_COST_INIT:
+	lcd_cost_init(config, cost);
+	break;
+
+    case LCD_COST_WARM_INIT:
+	cost_warm(config, cost);
+	break;
+
+    case LCD_COST_CLEAR:
+    case LCD_COST_HOME:
+	cost_bytes(config, 1, cost);
+	cost_wait((uint32_t)LCD_CLEAR_MS * 1000, cost);
+	break;
+
+    case LCD_COST_COMMAND:
+	cost_bytes(config, 1, cost);
+	break;
+
+    case LCD_COST_WRITE_CHAR:
+	cost_bytes(config, COST_ENTRY, cost);
+	lcd_cost_string(config, 1, cost);
+	break;
+
+    case LCD_COST_WRITE_STRING:
+    case LCD_COST_WRITE_BUFFER:
+	if(length != 0)
+	    cost_bytes(config, COST_ENTRY, cost);
+	lcd_cost_string(config, length, cost);
+	break;
+
+    case LCD_COST_WRITE_INT:
+	cost_bytes(config, COST_ENTRY, cost);
+	lcd_cost_string(config, COST_INT_CHARS, cost);
+	break;
+
+    case LCD_COST_WRITE_INT_RIGHT:
+	// the whole number is written even when it is wider than the field
+	cost_bytes(config, COST_ENTRY, cost);
+	lcd_cost_string(config, (length > COST_INT_RIGHT_CHARS) ? length : COST_INT_RIGHT_CHARS, cost);
+	break;
+
+    case LCD_COST_CREATE_CHAR:
+	cost_bytes(config, COST_ENTRY + COST_GLYPH, cost);
+	break;
+
+    case LCD_COST_FLUSH:
+    case LCD_COST_PRESENT_AT:
+    case LCD_COST_FLUSH_POLL:
+	// every cell in one run from a single address command, and parking a blinking cursor afterwards
+	cost_bytes(config, LCD_DDRAM_SIZE + 2, cost);
+	break;
+
+    case LCD_COST_WRITE_FLOAT:
+	cost_bytes(config, COST_ENTRY, cost);
+	lcd_cost_string(config, COST_FLOAT_CHARS, cost);
+	break;
+
+    case LCD_COST_SET_ATTR:
+	// putting back the hidden cells or glyph, every CGRAM slot inverted or restored, then blink on and parking
+	cost_bytes(config, COST_ENTRY + cost_blink_bytes(length) + 8 * COST_GLYPH + 2, cost);
+	break;
+
+    case LCD_COST_ATTR_TICK:
+	// picking the mechanism again, then hiding the cells or the glyph
+	lcd_cost_api(config, LCD_COST_SET_ATTR, length, cost);
+	cost_bytes(config, cost_blink_bytes(length), cost);
+	break;
+
+    case LCD_COST_FLIP_PAGE:
+	lcd_cost_api(config, LCD_COST_FLUSH, 0, cost);
+	cost_flip(config, cost);
+	break;
+
+    case LCD_COST_SELECT_PANELS:
+	lcd_cost_api(config, LCD_COST_FLUSH, 0, cost);
+	cost_bytes(config, COST_PANELS, cost);
+	break;
+
+    default:
+	break;
+    }
+}
+
+/*
+    @brief Function for adding the cost of bytes on the bus
+*/
+static void cost_bytes(const lcd_cost_config_t * config, uint32_t bytes, lcd_cost_t * cost) {
+    cost->bytes += bytes;
+    cost->bus_us += bytes * (config->byte_us + config->gap_us);
+    cost->cpu_us += bytes * (config->cpu_byte_us + config->gap_us);
+}
+
+/*
+    @brief Function for the bytes showing or hiding the blinking cells once
+
+    @note rewriting them takes an address command and a byte per cell at worst, swapping a glyph one CGRAM upload
+*/
+static uint32_t cost_blink_bytes(uint16_t length) {
+    return (2 * (uint32_t)length > COST_GLYPH) ? 2 * (uint32_t)length : COST_GLYPH;
+}
+
+/*
+    @brief Function for adding the cost of bringing the hidden page on screen
+
+    @note NUM_COLS shifts, or a return home when that lands on shift 0, whichever takes longer
+*/
+static void cost_flip(const lcd_cost_config_t * config, lcd_cost_t * cost) {
+    lcd_cost_t shifts = {0, 0, 0};
+    lcd_cost_t home = {0, 0, 0};
+    const lcd_cost_t * longer;
+
+    cost_bytes(config, NUM_COLS, &shifts);
+    lcd_cost_api(config, LCD_COST_HOME, 0, &home);
+    longer = (home.bus_us > shifts.bus_us) ? &home : &shifts;
+
+    cost->bytes += shifts.bytes;
+    cost->bus_us += longer->bus_us;
+    cost->cpu_us += longer->cpu_us;
+}
+
+/*
+    @brief Function for adding the cost of a warm start, picked up or falling back, whichever is worse
+
+    @note picking the panel up is the resync, the registers, a return home and the longest shift put back, then the
+	  first flush and the custom characters with every cell and slot differing from the retained image. The
+	  fallback is lcd_cost_init(), each of bytes, bus and CPU time is the larger of the two
+*/
+static void cost_warm(const lcd_cost_config_t * config, lcd_cost_t * cost) {
+    lcd_cost_t warm = {0, 0, 0};
+    lcd_cost_t cold = {0, 0, 0};
+    uint8_t slot;
+
+    // three 0x3 nibbles and 0x2 on the gpio bus, as long as 2 bytes without the gap callback,
+    // or a whole 8 bit function set, then time for a return home the reset may have cut short
+    if(config->byte_wide) {
+	cost_bytes(config, 1, &warm);
+    }
+    else {
+	warm.bytes += 2;
+	warm.bus_us += 2 * config->byte_us;
+	warm.cpu_us += 2 * config->cpu_byte_us;
+    }
+    cost_wait((uint32_t)LCD_CLEAR_MS * 1000, &warm);
+
+    // function set, display control and entry mode, then the shift
+    cost_bytes(config, 3, &warm);
+    lcd_cost_api(config, LCD_COST_HOME, 0, &warm);
+    cost_bytes(config, LCD_LINE_LENGTH - 1, &warm);
+
+    lcd_cost_api(config, LCD_COST_FLUSH, 0, &warm);
+    for(slot = 0; slot < 8; slot++)
+	lcd_cost_api(config, LCD_COST_CREATE_CHAR, 0, &warm);
+
+    lcd_cost_init(config, &cold);
+    cost->bytes += (warm.bytes > cold.bytes) ? warm.bytes : cold.bytes;
+    cost->bus_us += (warm.bus_us > cold.bus_us) ? warm.bus_us : cold.bus_us;
+    cost->cpu_us += (warm.cpu_us > cold.cpu_us) ? warm.cpu_us : cold.cpu_us;
+}
+
+/*
+    @brief Function for adding a delay the driver waits out, it holds the CPU and the bus alike
+*/
+static void cost_wait(uint32_t wait_us, lcd_cost_t * cost) {
+    cost->bus_us += wait_us;
+    cost->cpu_us += wait_us;
+}
@@ -0,0 +1,148 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_cost.h
+
+  @Summary
+    Bus time and CPU cost of LCD operations before they are sent
+
+  @Description
+    Works out from the timing profile in lcd_16x2.h what a byte sequence, a
+    string or an initialization costs on a given bus, and the worst case of
+    every public API, so a scheduler can check that an update fits the time
+    it has before starting it. For a pending flush, pass the bytes
+    lcd_plan_pending() returns to lcd_cost_sequence(). Has no hardware
+    dependencies and doesn't link against the driver, tools/lcd_wcet.c
+    prints the worst case table on the host.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "lcd_16x2.h"
+
+#ifndef LCD_COST_H
+#define LCD_COST_H
+
+// public APIs with a worst case, see lcd_cost_api()
+#define LCD_COST_INIT 0 // lcd_init() or lcd_init_transport()
+#define LCD_COST_WARM_INIT 1 // lcd_warm_init() or lcd_warm_init_transport() and the first redraw, or the fallback
+#define LCD_COST_CLEAR 2 // lcd_clear()
+#define LCD_COST_HOME 3 // lcd_home()
+#define LCD_COST_COMMAND 4 // lcd_set_cursor(), display, cursor, blink, shift, autoscroll and direction
+#define LCD_COST_WRITE_CHAR 5 // lcd_write_char()
+#define LCD_COST_WRITE_STRING 6 // lcd_write_string() of length characters
+#define LCD_COST_WRITE_BUFFER 7 // lcd_write_buffer() or lcd_write_buffer_right() of length bytes
+#define LCD_COST_WRITE_INT 8 // lcd_write_int()
+#define LCD_COST_CREATE_CHAR 9 // lcd_create_char()
+#define LCD_COST_FLUSH 10 // lcd_flush() of a whole screen
+#define LCD_COST_WRITE_INT_RIGHT 11 // lcd_write_int_right() of a length cell field
+#define LCD_COST_SET_ATTR 12 // lcd_set_attr() with up to length cells blinking before and after
+#define LCD_COST_ATTR_TICK 13 // lcd_attr_tick() with up to length cells blinking, attributes changed since the last tick
+#define LCD_COST_FLIP_PAGE 14 // lcd_flip_page(), flushing a whole screen first
+#define LCD_COST_SELECT_PANELS 15 // lcd_select_panels(), flushing a whole screen first
+#define LCD_COST_WRITE_FLOAT 16 // lcd_write_float()
+#define LCD_COST_PRESENT_AT 17 // lcd_present_at() of a whole screen, from the deadline on
+#define LCD_COST_FLUSH_POLL 18 // lcd_flush_poll() of a whole screen with the bus window open throughout
+#define LCD_COST_APIS 19
+
+/*
+    @brief Bus the cost is worked out for
+*/
+typedef struct {
+    uint32_t byte_us; // bus time of one byte
+    uint32_t cpu_byte_us; // time the CPU waits for one byte, the same as byte_us unless the transport queues bytes
+    uint32_t gap_us; // time the lcd_set_bus_gap() callback takes after every byte, 0 if none
+    uint8_t byte_wide; // bytes go through a transport, the wake up uses whole 8 bit function sets
+} lcd_cost_config_t;
+
+/*
+    @brief Cost of an operation
+*/
+typedef struct {
+    uint32_t bytes; // bytes on the bus
+    uint32_t bus_us; // time until the bus is free again, including the waits after slow instructions
+    uint32_t cpu_us; // time the CPU spends waiting in the driver
+} lcd_cost_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up the cost of the 4 bit gpio bus
+
+    @param[out] config Configuration to fill in
+*/
+void lcd_cost_config_gpio(lcd_cost_config_t * config);
+
+/*
+    @brief Set up the cost of a byte wide transport
+
+    @note the driver waits for every byte the transport sends, lower cpu_byte_us afterwards if it doesn't
+
+    @param[out] config Configuration to fill in
+
+    @param[in] transport Transport given to lcd_init_transport()
+*/
+void lcd_cost_config_transport(lcd_cost_config_t * config, const lcd_transport_t * transport);
+
+/*
+    @brief Add the cost of a byte sequence
+
+    @note clear and return home count with the wait lcd_clear() and lcd_home() add after them, every cost
+	  function adds to cost so the parts of an update can be summed, clear it first
+
+    @param[in] config Bus
+
+    @param[in] value Command and data bytes
+
+    @param[in] mode Register select of each byte, 0 for commands
+
+    @param[in] length Number of bytes
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_sequence(const lcd_cost_config_t * config, const uint8_t * value, const uint8_t * mode, uint16_t length,
+		       lcd_cost_t * cost);
+
+/*
+    @brief Add the cost of writing a string without write combining
+
+    @note one address command and a byte per character, the command is left out when the address counter is
+	  already there
+
+    @param[in] config Bus
+
+    @param[in] length Number of characters
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_string(const lcd_cost_config_t * config, uint16_t length, lcd_cost_t * cost);
+
+/*
+    @brief Add the cost of initializing the LCD from power up
+
+    @param[in] config Bus, byte_wide picks lcd_init_transport() over lcd_init()
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_init(const lcd_cost_config_t * config, lcd_cost_t * cost);
+
+/*
+    @brief Add the worst case cost of a public API
+
+    @note assumes write combining is off, a single panel and no bus window, with write combining on writes cost
+	  nothing until lcd_flush() and commands other than cursor moves and repeated display control flush first. Writes
+	  include the entry mode command that puts the direction back after a right aligned write
+
+    @param[in] config Bus
+
+    @param[in] api LCD_COST_...
+
+    @param[in] length Characters or bytes for LCD_COST_WRITE_STRING and LCD_COST_WRITE_BUFFER, cells for
+		      LCD_COST_WRITE_INT_RIGHT, blinking cells for LCD_COST_SET_ATTR and LCD_COST_ATTR_TICK, ignored
+		      otherwise
+
+    @param[in,out] cost Cost to add to
+*/
+void lcd_cost_api(const lcd_cost_config_t * config, uint8_t api, uint16_t length, lcd_cost_t * cost);
+
+#endif
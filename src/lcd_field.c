@@ -0,0 +1,185 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_field.c
+
+  @Summary
+    Numeric fields with update suppression
+
+  @Description
+    Implements the update policies of numeric fields, a reading is only drawn
+    when the number shown meaningfully changes
+******************************************************************************/
+
+#include "lcd_field.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static void field_format(const lcd_field_t * field, float value, char * text);
+static uint8_t field_passes(const lcd_field_t * field, float value);
+static void field_draw(lcd_field_t * field, const char * text, uint32_t now);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up a field with every policy off
+
+    @param[out] field Field to set up
+
+    @param[in] col column number
+
+    @param[in] row row number
+
+    @param[in] width Characters the field takes, at most LCD_FIELD_MAX_WIDTH
+
+    @param[in] precision Digits after the point
+*/
+void lcd_field_init(lcd_field_t * field, uint8_t col, uint8_t row, uint8_t width, uint8_t precision) {
+    memset(field, 0, sizeof(*field));
+    field->col = col;
+    field->row = row;
+    field->width = (width > LCD_FIELD_MAX_WIDTH) ? LCD_FIELD_MAX_WIDTH : width;
+    field->precision = precision;
+}
+
+/*
+    @brief Pass a new reading to a field
+
+    @note the reading is drawn if it gets through the policy, a change held back by min_interval_us is drawn by a
+	  later lcd_field_update() or lcd_field_poll(), unless a reading back inside the deadband or hysteresis
+	  replaces it first
+
+    @param[in,out] field Field to update
+
+    @param[in] value New reading
+
+    @return 1 if the field was redrawn, 0 if the reading was suppressed
+*/
+uint8_t lcd_field_update(lcd_field_t * field, float value) {
+    field->latest = value;
+
+    // every reading decides again, a held change is dropped when the reading comes back inside the band
+    if(field->valid)
+	field->held = field_passes(field, value);
+
+    if(lcd_field_poll(field))
+	return 1;
+
+    field->stats.suppressed++;
+    return 0;
+}
+
+/*
+    @brief Draw a held back or stale reading once its time has come
+
+    @note call it from the main loop when readings don't arrive often enough to do it through lcd_field_update()
+
+    @param[in,out] field Field to check
+
+    @return 1 if the field was redrawn
+*/
+uint8_t lcd_field_poll(lcd_field_t * field) {
+    const uint32_t now = time_us();
+    const uint32_t age = now - field->shown_at;
+    char text[LCD_FIELD_MAX_WIDTH + 1];
+
+    if(!field->valid) {
+	field_format(field, field->latest, text);
+	field_draw(field, text, now);
+	return 1;
+    }
+
+    if(!field->held && !(field->max_stale_us != 0 && age >= field->max_stale_us))
+	return 0;
+    if(age < field->min_interval_us)
+	return 0;
+
+    field_format(field, field->latest, text);
+    if(strcmp(text, field->text) == 0) {
+	// the glass is up to date, start the stale timer again
+	field->held = 0;
+	field->shown_at = now;
+	return 0;
+    }
+
+    field_draw(field, text, now);
+    return 1;
+}
+
+/*
+    @brief Read and reset the statistics of a field
+
+    @param[in,out] field Field to read
+
+    @param[out] stats Counters since the last call
+*/
+void lcd_field_get_stats(lcd_field_t * field, lcd_field_stats_t * stats) {
+    *stats = field->stats;
+    memset(&field->stats, 0, sizeof(field->stats));
+}
+
+/*
+    @brief Function for formatting a reading the way the field shows it
+
+    @note right aligned, a number that doesn't fit is shown as '#' characters
+*/
+static void field_format(const lcd_field_t * field, float value, char * text) {
+    char str[32];
+    int length;
+
+    length = snprintf(str, sizeof(str), "%*.*f", field->width, field->precision, value);
+    if(length < 0 || length > field->width) {
+	memset(text, '#', field->width);
+	text[field->width] = '\0';
+	return;
+    }
+
+    memcpy(text, str, field->width + 1);
+}
+
+/*
+    @brief Function for checking a reading against the deadbands and the hysteresis
+
+    @return 1 if the change is big enough to show
+*/
+static uint8_t field_passes(const lcd_field_t * field, float value) {
+    const float change = fabsf(value - field->shown);
+    float step = 1.0f; // one step of the last digit
+    float shown_rounded;
+    uint8_t i;
+
+    if(change < field->deadband)
+	return 0;
+    if(change < field->deadband_rel * fabsf(field->shown))
+	return 0;
+
+    if(field->hysteresis > 0) {
+	// the number on the glass only changes once the reading is past the rounding boundary by the hysteresis
+	for(i = 0; i < field->precision; i++)
+	    step /= 10.0f;
+	shown_rounded = roundf(field->shown / step) * step;
+	if(fabsf(value - shown_rounded) < step * (0.5f + field->hysteresis))
+	    return 0;
+    }
+
+    return 1;
+}
+
+/*
+    @brief Function for putting the text of a field on the glass
+*/
+static void field_draw(lcd_field_t * field, const char * text, uint32_t now) {
+    lcd_set_cursor(field->col, field->row);
+    lcd_write_buffer((const uint8_t *)text, field->width);
+
+    memcpy(field->text, text, field->width + 1);
+    field->shown = field->latest;
+    field->shown_at = now;
+    field->held = 0;
+    field->valid = 1;
+    field->stats.updates++;
+}
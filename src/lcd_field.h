@@ -0,0 +1,121 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_field.h
+
+  @Summary
+    Numeric fields with update suppression
+
+  @Description
+    A field is a fixed place on the LCD showing a number. Every new reading is
+    passed through the field's policy and only reaches the bus when the number
+    shown meaningfully changes, so a sensor jittering in the last digit doesn't
+    keep the bus busy or make the digit flicker.
+
+    Policies, any of them can be left off by setting it to 0:
+      deadband       the reading must move this far from the value shown
+      deadband_rel   the same as a fraction of the value shown
+      hysteresis     the reading must pass a rounding boundary by this fraction of one step of the last digit
+      min_interval   the field is redrawn at most this often
+      max_stale      a suppressed change is shown anyway once the field is this old
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_FIELD_H
+#define LCD_FIELD_H
+
+// widest field, a whole line
+#define LCD_FIELD_MAX_WIDTH 16
+
+/*
+    @brief Field statistics
+*/
+typedef struct {
+    uint32_t updates; // readings that were drawn
+    uint32_t suppressed; // readings that were held back or dropped
+} lcd_field_stats_t;
+
+/*
+    @brief Numeric field
+
+    @note set up with lcd_field_init(), then set the policy members directly
+*/
+typedef struct {
+    // where and how the number is shown
+    uint8_t col;
+    uint8_t row;
+    uint8_t width; // characters, the number is right aligned
+    uint8_t precision; // digits after the point
+
+    // update policy
+    float deadband; // smallest change shown, 0 for none
+    float deadband_rel; // smallest change shown as a fraction of the value shown, 0 for none
+    float hysteresis; // fraction of a step past the rounding boundary, 0 to 0.5
+    uint32_t min_interval_us; // shortest time between redraws, 0 for none
+    uint32_t max_stale_us; // longest a suppressed change stays hidden, 0 for forever
+
+    // state
+    float shown; // reading currently on the glass
+    float latest; // last reading passed to lcd_field_update()
+    uint32_t shown_at; // time_us() of the last redraw
+    uint8_t valid; // something has been drawn
+    uint8_t held; // a change passed the policy but is waiting for min_interval_us
+    char text[LCD_FIELD_MAX_WIDTH + 1]; // characters on the glass
+    lcd_field_stats_t stats;
+} lcd_field_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up a field with every policy off
+
+    @param[out] field Field to set up
+
+    @param[in] col column number
+
+    @param[in] row row number
+
+    @param[in] width Characters the field takes, at most LCD_FIELD_MAX_WIDTH
+
+    @param[in] precision Digits after the point
+*/
+void lcd_field_init(lcd_field_t * field, uint8_t col, uint8_t row, uint8_t width, uint8_t precision);
+
+/*
+    @brief Pass a new reading to a field
+
+    @note the reading is drawn if it gets through the policy, a change held back by min_interval_us is drawn by a
+	  later lcd_field_update() or lcd_field_poll(), unless a reading back inside the deadband or hysteresis
+	  replaces it first
+
+    @param[in,out] field Field to update
+
+    @param[in] value New reading
+
+    @return 1 if the field was redrawn, 0 if the reading was suppressed
+*/
+uint8_t lcd_field_update(lcd_field_t * field, float value);
+
+/*
+    @brief Draw a held back or stale reading once its time has come
+
+    @note call it from the main loop when readings don't arrive often enough to do it through lcd_field_update()
+
+    @param[in,out] field Field to check
+
+    @return 1 if the field was redrawn
+*/
+uint8_t lcd_field_poll(lcd_field_t * field);
+
+/*
+    @brief Read and reset the statistics of a field
+
+    @param[in,out] field Field to read
+
+    @param[out] stats Counters since the last call
+*/
+void lcd_field_get_stats(lcd_field_t * field, lcd_field_stats_t * stats);
+
+#endif
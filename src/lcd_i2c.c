@@ -0,0 +1,93 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_i2c.c
+
+  @Summary
+    I2C bus access for the LCD transports
+
+  @Description
+    Implements the I2C functions shared by the transports that reach the LCD
+    over I2C (port expanders and serial controllers)
+******************************************************************************/
+
+#include "lcd_i2c.h"
+#include <inttypes.h>
+#include "app_util_platform.h" // Nordic nRF5 SDK specific library for interrupt priorities
+#include "nrf_drv_twi.h" // Nordic nRF5 SDK specific library for the TWI (I2C) master
+
+static const nrf_drv_twi_t twi = NRF_DRV_TWI_INSTANCE(0); // TWI instance used for the LCD
+static uint32_t twi_hz = I2C_FREQ_DEFAULT; // bus rate actually set up
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function for setting up the I2C bus
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] scl Clock pin number
+
+    @param[in] sda Data pin number
+
+    @param[in] frequency Bus rate in Hz, the fastest rate of the TWI master not above it is used, 0 for
+			 I2C_FREQ_DEFAULT
+*/
+void i2c_init(uint32_t scl, uint32_t sda, uint32_t frequency) {
+    nrf_drv_twi_config_t config = {
+	.scl = scl,
+	.sda = sda,
+	.frequency = NRF_DRV_TWI_FREQ_250K,
+	.interrupt_priority = APP_IRQ_PRIORITY_HIGH,
+	.clear_bus_init = false
+    };
+
+    if(frequency == 0)
+	frequency = I2C_FREQ_DEFAULT;
+
+    // the TWI master only runs at 100, 250 and 400kHz, never go faster than asked
+    if(frequency >= 400000) {
+	config.frequency = NRF_DRV_TWI_FREQ_400K;
+	twi_hz = 400000;
+    }
+    else if(frequency >= 250000) {
+	config.frequency = NRF_DRV_TWI_FREQ_250K;
+	twi_hz = 250000;
+    }
+    else {
+	config.frequency = NRF_DRV_TWI_FREQ_100K;
+	twi_hz = 100000;
+    }
+
+    nrf_drv_twi_init(&twi, &config, NULL, NULL); // no event handler, transfers are blocking
+    nrf_drv_twi_enable(&twi);
+}
+
+/*
+    @brief Function for reading the bus rate set up by i2c_init()
+
+    @note the transports work out their byte time from it
+
+    @return bus rate in Hz
+*/
+uint32_t i2c_frequency(void) {
+    return twi_hz;
+}
+
+/*
+    @brief Function for writing bytes to an I2C device in one transaction
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] address 7 bit device address
+
+    @param[in] data Bytes to write
+
+    @param[in] length Number of bytes to write
+*/
+void i2c_write(uint8_t address, const uint8_t * data, uint8_t length) {
+    nrf_drv_twi_tx(&twi, address, data, length, false);
+}
@@ -0,0 +1,64 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_i2c.h
+
+  @Summary
+    I2C bus access for the LCD transports
+
+  @Description
+    Defines the I2C functions shared by the transports that reach the LCD
+    over I2C (port expanders and serial controllers)
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_I2C_H
+#define LCD_I2C_H
+
+// bus rate used when i2c_init() is given 0, slow enough that every byte of an ST7032 takes longer than the 26.3us
+// instruction time, the other transports only get slower
+#define I2C_FREQ_DEFAULT 250000
+
+/*******************************[ Low-Level Functions Specific to Hardware/SDK ]****************************************/
+
+/*
+    @brief Function for setting up the I2C bus
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] scl Clock pin number
+
+    @param[in] sda Data pin number
+
+    @param[in] frequency Bus rate in Hz, the fastest rate of the TWI master not above it is used, 0 for
+			 I2C_FREQ_DEFAULT
+*/
+void i2c_init(uint32_t scl, uint32_t sda, uint32_t frequency);
+
+/*
+    @brief Function for reading the bus rate set up by i2c_init()
+
+    @note the transports work out their byte time from it
+
+    @return bus rate in Hz
+*/
+uint32_t i2c_frequency(void);
+
+/*
+    @brief Function for writing bytes to an I2C device in one transaction
+
+    @note This is written to work with the Nordic nRF52 SDK, if you're using a different chip 
+	  architecture you'll have to rewrite this to work with your own micro
+
+    @param[in] address 7 bit device address
+
+    @param[in] data Bytes to write
+
+    @param[in] length Number of bytes to write
+*/
+void i2c_write(uint8_t address, const uint8_t * data, uint8_t length);
+
+#endif
@@ -0,0 +1,218 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_keypad.c
+
+  @Summary
+    4x4 keypad sharing the LCD data pins
+
+  @Description
+    Implements the keypad scan and the time sharing of D4-D7 with the LCD
+******************************************************************************/
+
+#include "lcd_keypad.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+#include <string.h>
+
+static uint32_t row_pins[4];
+static uint32_t col_pins[4];
+static uint32_t scan_interval = 0;
+static uint32_t last_scan = 0; // time_us() of the last scan
+static uint32_t next_scan = 0; // time_us() the next scan is due
+static uint8_t scanned = 0; // last_scan is valid
+
+static uint16_t key_state = 0; // debounced keys held down
+static uint16_t last_raw = 0; // keys seen by the last scan
+
+static uint8_t queue[LCD_KEYPAD_QUEUE]; // key presses not yet read
+static uint8_t queue_head = 0;
+static uint8_t queue_tail = 0;
+
+static lcd_keypad_stats_t keypad_stats;
+
+static void keypad_gap(uint32_t free_us);
+static uint8_t keypad_due(void);
+static uint32_t keypad_scan(void);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up the keypad and start scanning between LCD bytes
+
+    @note call it after lcd_init(), only for the 4 bit gpio bus
+
+    @param[in] rows Pin numbers of the 4 rows
+
+    @param[in] cols Pin numbers of the 4 columns, the same pins as D4-D7
+
+    @param[in] interval_us Time between scans, a key is seen within two intervals with debouncing
+*/
+void lcd_keypad_init(const uint32_t rows[4], const uint32_t cols[4], uint32_t interval_us) {
+    uint8_t i;
+
+    memcpy(row_pins, rows, sizeof(row_pins));
+    memcpy(col_pins, cols, sizeof(col_pins));
+    scan_interval = interval_us;
+
+    // rows float until they are scanned
+    for(i = 0; i < 4; i++)
+	pin_input(row_pins[i], 0);
+
+    key_state = 0;
+    last_raw = 0;
+    queue_head = 0;
+    queue_tail = 0;
+    scanned = 0;
+    memset(&keypad_stats, 0, sizeof(keypad_stats));
+
+    keypad_scan();
+    lcd_set_bus_gap(keypad_gap);
+}
+
+/*
+    @brief Scan the keypad if a scan is due
+
+    @note call it from the main loop, scans between LCD bytes and during long waits only happen while the LCD is
+	  being written
+
+    @return microseconds until the next scan is due, sleep no longer than that to keep the scan rate
+*/
+uint32_t lcd_keypad_poll(void) {
+    int32_t left;
+
+    if(keypad_due())
+	keypad_scan();
+
+    left = (int32_t)(next_scan - time_us());
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+/*
+    @brief Read the next key press
+
+    @return key number, row * 4 + column, or LCD_KEYPAD_NONE
+*/
+uint8_t lcd_keypad_get(void) {
+    uint8_t key;
+
+    if(queue_head == queue_tail)
+	return LCD_KEYPAD_NONE;
+
+    key = queue[queue_tail];
+    queue_tail = (queue_tail + 1) % LCD_KEYPAD_QUEUE;
+    return key;
+}
+
+/*
+    @brief Read the keys held down
+
+    @return bit per key, debounced
+*/
+uint16_t lcd_keypad_state(void) {
+    return key_state;
+}
+
+/*
+    @brief Read and reset the keypad statistics
+
+    @param[out] stats Statistics since the last call
+*/
+void lcd_keypad_get_stats(lcd_keypad_stats_t * stats) {
+    *stats = keypad_stats;
+    memset(&keypad_stats, 0, sizeof(keypad_stats));
+}
+
+/*
+    @brief Function run by the LCD driver between bytes and while it waits for a long instruction
+
+    @note only the part of a scan that runs past the time the data pins are free holds the LCD up
+*/
+static void keypad_gap(uint32_t free_us) {
+    uint32_t took;
+
+    if(!keypad_due())
+	return;
+
+    took = keypad_scan();
+    if(took > free_us)
+	keypad_stats.stolen_us += took - free_us;
+    if(free_us != 0)
+	keypad_stats.free_scans++;
+}
+
+/*
+    @brief Function for checking whether the deadline of the next scan has passed
+*/
+static uint8_t keypad_due(void) {
+    return (int32_t)(time_us() - next_scan) >= 0;
+}
+
+/*
+    @brief Function for scanning the matrix once
+
+    @note the columns are D4-D7, they are inputs with pull-ups during the scan and outputs again afterwards,
+	  the next nibble sent sets their levels. A change is taken once two scans in a row agree. The next
+	  deadline follows the last one, so a scan run late doesn't push the rest back, unless it missed a whole
+	  interval
+
+    @return time the scan took in microseconds
+*/
+static uint32_t keypad_scan(void) {
+    const uint32_t start = time_us();
+    uint16_t raw = 0;
+    uint16_t pressed;
+    uint8_t row;
+    uint8_t col;
+    uint8_t key;
+
+    for(col = 0; col < 4; col++)
+	pin_input(col_pins[col], 1);
+
+    for(row = 0; row < 4; row++) {
+	pin_output(row_pins[row]);
+	pin_write(row_pins[row], 0);
+	delay_us(2); // let the pull-ups settle
+	for(col = 0; col < 4; col++)
+	    if(!pin_read(col_pins[col]))
+		raw |= 1 << (row * 4 + col);
+	pin_input(row_pins[row], 0);
+    }
+
+    for(col = 0; col < 4; col++)
+	pin_output(col_pins[col]);
+
+    if(scanned) {
+	if(start - last_scan > keypad_stats.max_gap_us)
+	    keypad_stats.max_gap_us = start - last_scan;
+	if(start - next_scan > LCD_BYTE_US)
+	    keypad_stats.late++;
+	next_scan += scan_interval;
+	if((int32_t)(start - next_scan) >= 0)
+	    next_scan = start + scan_interval;
+    }
+    else
+	next_scan = start + scan_interval;
+    keypad_stats.scans++;
+    last_scan = start;
+    scanned = 1;
+
+    // debounce
+    if(raw == last_raw) {
+	pressed = raw & ~key_state;
+	key_state = raw;
+
+	for(key = 0; key < 16; key++) {
+	    if(!(pressed & (1 << key)))
+		continue;
+	    if((queue_head + 1) % LCD_KEYPAD_QUEUE == queue_tail)
+		break; // full, drop the press
+	    queue[queue_head] = key;
+	    queue_head = (queue_head + 1) % LCD_KEYPAD_QUEUE;
+	}
+    }
+    last_raw = raw;
+
+    return time_us() - start;
+}
@@ -0,0 +1,90 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_keypad.h
+
+  @Summary
+    4x4 keypad sharing the LCD data pins
+
+  @Description
+    Scans a 4x4 key matrix whose columns are wired to D4-D7 of the LCD and
+    whose rows are on 4 extra pins. Scans are due at a fixed rate and run at
+    the first chance after their deadline: between LCD bytes, when both
+    nibbles are latched and enable is low, so the LCD never sees them, while
+    the LCD executes a clear, return home or wake up, and from
+    lcd_keypad_poll() when the LCD is quiet. lcd_keypad_poll() returns the
+    time to the next deadline, so an idle main loop can sleep until then.
+    Rows are left floating outside a scan so a held key can't fight the data
+    pins.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_KEYPAD_H
+#define LCD_KEYPAD_H
+
+// lcd_keypad_get() has no key for you
+#define LCD_KEYPAD_NONE 0xFF
+
+// key presses waiting to be read
+#define LCD_KEYPAD_QUEUE 8
+
+/*
+    @brief Keypad statistics
+*/
+typedef struct {
+    uint32_t scans; // scans done
+    uint32_t max_gap_us; // longest time between two scans, the worst case latency before a key is seen
+    uint32_t late; // scans that started more than one LCD byte after they were due, the main loop didn't poll
+    uint32_t stolen_us; // time LCD bytes waited for scans, the LCD throughput lost to the keypad
+    uint32_t free_scans; // scans done while the LCD executed a long instruction, they cost no throughput
+} lcd_keypad_stats_t;
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Set up the keypad and start scanning between LCD bytes
+
+    @note call it after lcd_init(), only for the 4 bit gpio bus
+
+    @param[in] rows Pin numbers of the 4 rows
+
+    @param[in] cols Pin numbers of the 4 columns, the same pins as D4-D7
+
+    @param[in] interval_us Time between scans, a key is seen within two intervals with debouncing
+*/
+void lcd_keypad_init(const uint32_t rows[4], const uint32_t cols[4], uint32_t interval_us);
+
+/*
+    @brief Scan the keypad if a scan is due
+
+    @note call it from the main loop, scans between LCD bytes and during long waits only happen while the LCD is
+	  being written
+
+    @return microseconds until the next scan is due, sleep no longer than that to keep the scan rate
+*/
+uint32_t lcd_keypad_poll(void);
+
+/*
+    @brief Read the next key press
+
+    @return key number, row * 4 + column, or LCD_KEYPAD_NONE
+*/
+uint8_t lcd_keypad_get(void);
+
+/*
+    @brief Read the keys held down
+
+    @return bit per key, debounced
+*/
+uint16_t lcd_keypad_state(void);
+
+/*
+    @brief Read and reset the keypad statistics
+
+    @param[out] stats Statistics since the last call
+*/
+void lcd_keypad_get_stats(lcd_keypad_stats_t * stats);
+
+#endif
@@ -0,0 +1,233 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_latency.c
+
+  @Summary
+    End to end update latency per request
+
+  @Description
+    Implements the request table, the per cell tags and the histograms
+******************************************************************************/
+
+#include "lcd_latency.h"
+#include "lcd_16x2.h"
+#include <inttypes.h>
+#include <string.h>
+
+#define NO_REQUEST 0xFF
+
+typedef struct {
+    uint16_t id;
+    uint8_t region;
+    uint8_t used;
+    uint8_t open; // lcd_request_end() not called yet
+    uint8_t pending; // cells not yet on the glass
+    uint8_t superseded_by; // request that overwrote the last pending cell, NO_REQUEST if none
+    uint32_t begin_us; // time of lcd_request_begin()
+    uint32_t shown_us; // time the last cell was shown
+} request_t;
+
+typedef struct {
+    uint32_t buckets[LCD_LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t coalesced;
+    uint32_t lost;
+    uint32_t max_us;
+} region_t;
+
+static request_t requests[LCD_LATENCY_REQUESTS];
+static uint8_t cell_request[LCD_DDRAM_SIZE]; // request waiting for each cell, 0 means none
+static uint8_t active = NO_REQUEST; // request tagging writes
+static region_t regions[LCD_LATENCY_REGIONS];
+
+static void request_done(uint8_t r, uint32_t when, uint8_t coalesced);
+static uint32_t bucket_edge(const region_t * reg, uint32_t rank);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Start a request, cells written from now on belong to it
+
+    @param[in] id Request number, shows up nowhere but lets the caller tell requests apart while debugging
+
+    @param[in] region Histogram the latency goes into, below LCD_LATENCY_REGIONS
+
+    @return 1 if the request is followed, 0 if every slot is in use
+*/
+uint8_t lcd_request_begin(uint16_t id, uint8_t region) {
+    uint8_t r;
+
+    if(active != NO_REQUEST)
+	lcd_request_end();
+
+    region %= LCD_LATENCY_REGIONS;
+
+    for(r = 0; r < LCD_LATENCY_REQUESTS; r++)
+	if(!requests[r].used)
+	    break;
+
+    if(r == LCD_LATENCY_REQUESTS) {
+	regions[region].lost++;
+	return 0;
+    }
+
+    memset(&requests[r], 0, sizeof(requests[r]));
+    requests[r].id = id;
+    requests[r].region = region;
+    requests[r].used = 1;
+    requests[r].open = 1;
+    requests[r].superseded_by = NO_REQUEST;
+    requests[r].begin_us = time_us();
+    active = r;
+    return 1;
+}
+
+/*
+    @brief End the current request
+
+    @note the request is done once all its cells are on the glass, that may already be the case
+*/
+void lcd_request_end(void) {
+    request_t * req;
+
+    if(active == NO_REQUEST)
+	return;
+
+    req = &requests[active];
+    req->open = 0;
+    if(req->pending == 0 && req->superseded_by == NO_REQUEST)
+	request_done(active, req->shown_us ? req->shown_us : time_us(), 0);
+    active = NO_REQUEST;
+}
+
+/*
+    @brief Read and reset the latency of a region
+
+    @param[in] region Region to read
+
+    @param[out] stats Latency since the last call
+*/
+void lcd_latency_get(uint8_t region, lcd_latency_stats_t * stats) {
+    region_t * reg = &regions[region % LCD_LATENCY_REGIONS];
+
+    stats->count = reg->count;
+    stats->coalesced = reg->coalesced;
+    stats->lost = reg->lost;
+    stats->max_us = reg->max_us;
+    stats->p50_us = bucket_edge(reg, (reg->count + 1) / 2);
+    stats->p99_us = bucket_edge(reg, reg->count - reg->count / 100);
+
+    memset(reg, 0, sizeof(*reg));
+}
+
+/*
+    @brief Driver hook, the application wrote a cell
+*/
+void lcd_latency_write(uint8_t cell) {
+    const uint8_t old = cell_request[cell] - 1;
+
+    if(active == NO_REQUEST || old == active)
+	return; // an untagged write leaves the cell with the request already waiting for it
+
+    if(cell_request[cell] != 0) {
+	// the older request won't see this cell, it is done when this one is
+	requests[old].pending--;
+	if(requests[old].pending == 0)
+	    requests[old].superseded_by = active;
+    }
+
+    cell_request[cell] = active + 1;
+    requests[active].pending++;
+}
+
+/*
+    @brief Driver hook, the glass shows what the application wrote to a cell
+*/
+void lcd_latency_shown(uint8_t cell) {
+    const uint8_t r = cell_request[cell] - 1;
+    request_t * req;
+
+    if(cell_request[cell] == 0)
+	return;
+
+    cell_request[cell] = 0;
+    req = &requests[r];
+    req->pending--;
+    req->shown_us = time_us();
+
+    if(req->pending == 0 && !req->open)
+	request_done(r, req->shown_us, 0);
+}
+
+/*
+    @brief Driver hook, a clear or an init dropped every pending cell
+
+    @note requests waiting for a cell are done now and counted as coalesced, the open one when it ends
+*/
+void lcd_latency_reset(void) {
+    const uint32_t now = time_us();
+    uint8_t r;
+
+    memset(cell_request, 0, sizeof(cell_request));
+
+    for(r = 0; r < LCD_LATENCY_REQUESTS; r++) {
+	if(!requests[r].used)
+	    continue;
+	if(requests[r].open) {
+	    requests[r].pending = 0;
+	    requests[r].shown_us = now;
+	}
+	else {
+	    request_done(r, now, 1); // also the requests waiting for it
+	}
+    }
+}
+
+/*
+    @brief Function for recording a finished request and the requests it overwrote
+*/
+static void request_done(uint8_t r, uint32_t when, uint8_t coalesced) {
+    region_t * reg = &regions[requests[r].region];
+    const uint32_t latency = when - requests[r].begin_us;
+    uint8_t bucket = 0;
+    uint8_t s;
+
+    while(bucket < LCD_LATENCY_BUCKETS - 1 && (latency >> bucket) != 0)
+	bucket++;
+
+    reg->buckets[bucket]++;
+    reg->count++;
+    if(coalesced)
+	reg->coalesced++;
+    if(latency > reg->max_us)
+	reg->max_us = latency;
+
+    requests[r].used = 0;
+
+    for(s = 0; s < LCD_LATENCY_REQUESTS; s++)
+	if(requests[s].used && requests[s].superseded_by == r)
+	    request_done(s, when, 1);
+}
+
+/*
+    @brief Function for finding the upper edge of the bucket holding a rank, capped at the maximum
+*/
+static uint32_t bucket_edge(const region_t * reg, uint32_t rank) {
+    uint32_t seen = 0;
+    uint32_t edge;
+    uint8_t bucket;
+
+    if(rank == 0)
+	return 0;
+
+    for(bucket = 0; bucket < LCD_LATENCY_BUCKETS; bucket++) {
+	seen += reg->buckets[bucket];
+	if(seen >= rank)
+	    break;
+    }
+
+    edge = (bucket >= 32) ? UINT32_MAX : (((uint32_t)1 << bucket) - 1);
+    return (edge > reg->max_us) ? reg->max_us : edge;
+}
@@ -0,0 +1,109 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_latency.h
+
+  @Summary
+    End to end update latency per request
+
+  @Description
+    Tags the cells written between lcd_request_begin() and lcd_request_end()
+    with a request and follows them through write combining and the flush
+    plan to the strobe that puts them on the glass. A request is done once
+    its last cell is shown, the time from lcd_request_begin() goes into a
+    log2 histogram per region. A request whose cells were all overwritten by
+    a later one before being sent is done when that later request is, and
+    so is one whose cells a clear or an init wiped before they were sent.
+
+    Build with -DLCD_LATENCY to turn the hooks in the driver on, without it
+    they compile to nothing.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_LATENCY_H
+#define LCD_LATENCY_H
+
+// requests that can be in flight at once
+#ifndef LCD_LATENCY_REQUESTS
+#define LCD_LATENCY_REQUESTS 16
+#endif
+
+// regions or priorities with their own histogram
+#ifndef LCD_LATENCY_REGIONS
+#define LCD_LATENCY_REGIONS 4
+#endif
+
+// histogram buckets, bucket n counts latencies of 2^(n-1) to 2^n - 1 microseconds
+#define LCD_LATENCY_BUCKETS 33
+
+/*
+    @brief Latency of one region
+*/
+typedef struct {
+    uint32_t count; // requests done
+    uint32_t coalesced; // requests done by a later request that overwrote them
+    uint32_t lost; // requests not followed, every slot was in use
+    uint32_t p50_us; // median, upper edge of its bucket
+    uint32_t p99_us; // 99th percentile, upper edge of its bucket
+    uint32_t max_us; // exact
+} lcd_latency_stats_t;
+
+#ifdef LCD_LATENCY
+#define LCD_LATENCY_WRITE(cell) lcd_latency_write(cell)
+#define LCD_LATENCY_SHOWN(cell) lcd_latency_shown(cell)
+#define LCD_LATENCY_RESET() lcd_latency_reset()
+#else
+#define LCD_LATENCY_WRITE(cell) do {} while(0)
+#define LCD_LATENCY_SHOWN(cell) do {} while(0)
+#define LCD_LATENCY_RESET() do {} while(0)
+#endif
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Start a request, cells written from now on belong to it
+
+    @param[in] id Request number, shows up nowhere but lets the caller tell requests apart while debugging
+
+    @param[in] region Histogram the latency goes into, below LCD_LATENCY_REGIONS
+
+    @return 1 if the request is followed, 0 if every slot is in use
+*/
+uint8_t lcd_request_begin(uint16_t id, uint8_t region);
+
+/*
+    @brief End the current request
+
+    @note the request is done once all its cells are on the glass, that may already be the case
+*/
+void lcd_request_end(void);
+
+/*
+    @brief Read and reset the latency of a region
+
+    @param[in] region Region to read
+
+    @param[out] stats Latency since the last call
+*/
+void lcd_latency_get(uint8_t region, lcd_latency_stats_t * stats);
+
+/*
+    @brief Driver hook, the application wrote a cell
+*/
+void lcd_latency_write(uint8_t cell);
+
+/*
+    @brief Driver hook, the glass shows what the application wrote to a cell
+*/
+void lcd_latency_shown(uint8_t cell);
+
+/*
+    @brief Driver hook, a clear or an init dropped every pending cell
+
+    @note requests waiting for a cell are done now and counted as coalesced, the open one when it ends
+*/
+void lcd_latency_reset(void);
+
+#endif
@@ -0,0 +1,112 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mcp23017.c
+
+  @Summary
+    MCP23017 I2C port expander transport for the 16x2 LCD
+
+  @Description
+    Implements the transport that drives the LCD in 8 bit mode through an MCP23017
+******************************************************************************/
+
+#include "lcd_mcp23017.h"
+#include "lcd_16x2.h"
+#include "lcd_i2c.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+static uint8_t mcp_address = 0x20; // I2C address of the expander
+static uint8_t rs_mask = 0; // register select bit on GPIOA
+static uint8_t en_mask = 0; // enable bit on GPIOA
+
+static uint8_t burst[2 + 4 * MCP23017_BURST_CHARS]; // register byte, register select, then B/A pairs
+
+static void mcp23017_send(uint8_t value, uint8_t mode);
+static void mcp23017_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode);
+
+static lcd_transport_t mcp23017_transport = {
+    mcp23017_send,
+    mcp23017_write_buffer,
+    90, // 4 bytes at 400kHz, set from the bus rate at init
+    NULL // every call is already one I2C transfer
+};
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Initialize the LCD behind an MCP23017
+
+    @note i2c_init() must be called first, runs the full LCD initialization through lcd_init_transport()
+
+    @param[in] address 7 bit I2C address of the expander (0x20-0x27)
+
+    @param[in] rs GPIOA bit number wired to register select
+
+    @param[in] en GPIOA bit number wired to enable
+*/
+void lcd_mcp23017_init(uint8_t address, uint8_t rs, uint8_t en) {
+    uint8_t config[3];
+
+    mcp_address = address;
+    rs_mask = 1 << rs;
+    en_mask = 1 << en;
+    mcp23017_transport.byte_us = (4 * 9 * 1000000 + i2c_frequency() - 1) / i2c_frequency(); // 9 clocks an I2C byte
+
+    // byte mode with BANK = 0, the address pointer toggles between the A and B register of a pair
+    config[0] = MCP23017_IOCON;
+    config[1] = MCP23017_IOCON_SEQOP;
+    i2c_write(mcp_address, config, 2);
+
+    // both ports are outputs, IODIRA then IODIRB thanks to the toggle
+    config[0] = MCP23017_IODIRA;
+    config[1] = 0x00;
+    config[2] = 0x00;
+    i2c_write(mcp_address, config, 3);
+
+    // park with enable low
+    config[0] = MCP23017_GPIOA;
+    config[1] = 0x00;
+    i2c_write(mcp_address, config, 2);
+
+    lcd_init_transport(&mcp23017_transport);
+}
+
+/*
+    @brief Function for sending a single byte through the expander
+*/
+static void mcp23017_send(uint8_t value, uint8_t mode) {
+    mcp23017_write_buffer(&value, 1, mode);
+}
+
+/*
+    @brief Function for sending a burst of bytes to one LCD register
+
+    @note the pointer starts at GPIOA to set register select, then data, enable high, data, enable low (latches) for every byte,
+	  each I2C byte takes longer than the 37us the LCD needs so no extra delay is required
+*/
+static void mcp23017_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode) {
+    const uint8_t rs = mode ? rs_mask : 0;
+    uint16_t chunk;
+    uint16_t i;
+    uint16_t pos;
+
+    while(length > 0) {
+	chunk = (length > MCP23017_BURST_CHARS) ? MCP23017_BURST_CHARS : length;
+
+	pos = 0;
+	burst[pos++] = MCP23017_GPIOA;
+	burst[pos++] = rs; // GPIOA, register select settles before the first enable edge
+	for(i = 0; i < chunk; i++) {
+	    burst[pos++] = data[i]; // GPIOB, data setup
+	    burst[pos++] = rs | en_mask; // GPIOA, enable high
+	    burst[pos++] = data[i]; // GPIOB, hold
+	    burst[pos++] = rs; // GPIOA, enable low latches the byte
+	}
+	i2c_write(mcp_address, burst, pos);
+
+	data += chunk;
+	length -= chunk;
+    }
+}
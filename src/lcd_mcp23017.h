@@ -0,0 +1,52 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_mcp23017.h
+
+  @Summary
+    MCP23017 I2C port expander transport for the 16x2 LCD
+
+  @Description
+    Drives the LCD in 8 bit mode through an MCP23017, D0-D7 on GPIOB and
+    RS/EN on GPIOA. The expander is put in byte mode so its address pointer
+    toggles between GPIOA and GPIOB, one I2C burst then carries the data and
+    both enable edges for many characters: 4 bytes per character plus the
+    device address, register byte and register select once per burst.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_MCP23017_H
+#define LCD_MCP23017_H
+
+// MCP23017 registers (IOCON.BANK = 0)
+#define MCP23017_IODIRA 0x00
+#define MCP23017_IODIRB 0x01
+#define MCP23017_IOCON 0x0A
+#define MCP23017_GPIOA 0x12
+#define MCP23017_GPIOB 0x13
+
+// flags for IOCON
+#define MCP23017_IOCON_BANK 0x80
+#define MCP23017_IOCON_SEQOP 0x20
+
+// characters sent per I2C burst, 4 bytes each plus 2 bytes of setup must fit in one transaction
+#define MCP23017_BURST_CHARS 60
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Initialize the LCD behind an MCP23017
+
+    @note i2c_init() must be called first, runs the full LCD initialization through lcd_init_transport()
+
+    @param[in] address 7 bit I2C address of the expander (0x20-0x27)
+
+    @param[in] rs GPIOA bit number wired to register select
+
+    @param[in] en GPIOA bit number wired to enable
+*/
+void lcd_mcp23017_init(uint8_t address, uint8_t rs, uint8_t en);
+
+#endif
@@ -0,0 +1,143 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_st7032.c
+
+  @Summary
+    ST7032/ST7036 serial controller transport for the 16x2 LCD
+
+  @Description
+    Implements the transport for ST7032/ST7036 modules over I2C
+******************************************************************************/
+
+#include "lcd_st7032.h"
+#include "lcd_16x2.h"
+#include "lcd_i2c.h"
+#include <inttypes.h>
+#include <string.h>
+
+static uint8_t st7032_address = ST7032_ADDRESS; // I2C address of the controller
+static uint8_t st7032_contrast = 0; // mirror of the 6 bit contrast setting
+static uint8_t st7032_power = 0; // mirror of the icon and booster flags
+
+static uint8_t burst[1 + ST7032_BURST]; // control byte followed by a run of bytes
+
+static void st7032_send(uint8_t value, uint8_t mode);
+static void st7032_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode);
+static void st7032_extended(void);
+
+static lcd_transport_t st7032_transport = {
+    st7032_send,
+    st7032_write_buffer,
+    36, // one byte at 250kHz, set from the bus rate at init
+    NULL // every call is already one I2C transfer
+};
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Initialize an ST7032/ST7036 module over I2C
+
+    @note i2c_init() must be called first, runs the LCD initialization through lcd_init_transport()
+	  and then sets up the internal oscillator, contrast, booster and voltage follower
+
+    @param[in] address 7 bit I2C address, ST7032_ADDRESS for the ST7032
+
+    @param[in] contrast Contrast setting (0-63)
+
+    @param[in] booster 1 to turn on the voltage booster (3.3V supply), 0 for 5V modules
+*/
+void lcd_st7032_init(uint8_t address, uint8_t contrast, uint8_t booster) {
+    uint8_t cmds[5];
+
+    st7032_address = address;
+    st7032_contrast = contrast & 0x3F;
+    st7032_power = booster ? ST7032_BOOSTERON : 0;
+    st7032_transport.byte_us = (9 * 1000000 + i2c_frequency() - 1) / i2c_frequency(); // 9 clocks an I2C byte
+
+    lcd_init_transport(&st7032_transport);
+
+    // extended set up according to the datasheet, straight to the controller since the driver would read the
+    // table 1 instructions as cursor shifts and CGRAM addresses
+    cmds[0] = LCD_FUNCTIONSET | LCD_8BITMODE | LCD_2LINE | ST7032_INSTRUCTION_SET;
+    cmds[1] = ST7032_BIASOSC | ST7032_BIAS_1_5 | ST7032_OSC_DEFAULT;
+    cmds[2] = ST7032_CONTRASTLOW | (st7032_contrast & 0x0F);
+    cmds[3] = ST7032_POWERICON | st7032_power | (st7032_contrast >> 4);
+    cmds[4] = ST7032_FOLLOWER | ST7032_FOLLOWERON | ST7032_FOLLOWER_GAIN;
+    st7032_write_buffer(cmds, sizeof(cmds), 0);
+    delay_ms(200); // wait for the follower output to stabilize
+
+    // back to the normal instruction table
+    cmds[0] = LCD_FUNCTIONSET | LCD_8BITMODE | LCD_2LINE;
+    st7032_write_buffer(cmds, 1, 0);
+}
+
+/*
+    @brief Set the display contrast
+
+    @note switches to the extended instruction table and back
+
+    @param[in] contrast Contrast setting (0-63)
+*/
+void lcd_st7032_set_contrast(uint8_t contrast) {
+    st7032_contrast = contrast & 0x3F;
+    st7032_extended();
+}
+
+/*
+    @brief Function for turning the voltage booster on or off
+
+    @param[in] booster 1 to turn on the booster, 0 to turn it off
+*/
+void lcd_st7032_set_booster(uint8_t booster) {
+    if(booster)
+	st7032_power |= ST7032_BOOSTERON;
+    else
+	st7032_power &= ~ST7032_BOOSTERON;
+    st7032_extended();
+}
+
+/*
+    @brief Function for writing the contrast and power mirrors to the controller
+
+    @note the three instructions go out behind a single control byte, past the driver so its register mirror never
+	  sees the extended table
+*/
+static void st7032_extended(void) {
+    uint8_t cmds[4];
+
+    cmds[0] = LCD_FUNCTIONSET | LCD_8BITMODE | LCD_2LINE | ST7032_INSTRUCTION_SET;
+    cmds[1] = ST7032_CONTRASTLOW | (st7032_contrast & 0x0F);
+    cmds[2] = ST7032_POWERICON | st7032_power | (st7032_contrast >> 4);
+    cmds[3] = LCD_FUNCTIONSET | LCD_8BITMODE | LCD_2LINE;
+    st7032_write_buffer(cmds, sizeof(cmds), 0);
+}
+
+/*
+    @brief Function for sending a single byte to the controller
+*/
+static void st7032_send(uint8_t value, uint8_t mode) {
+    st7032_write_buffer(&value, 1, mode);
+}
+
+/*
+    @brief Function for sending a run of bytes to one register
+
+    @note one control byte with Co cleared, every byte after it goes to the register picked by RS
+*/
+static void st7032_write_buffer(const uint8_t * data, uint16_t length, uint8_t mode) {
+    uint16_t chunk;
+
+    burst[0] = mode ? ST7032_CONTROL_DATA : 0x00;
+
+    while(length > 0) {
+	chunk = (length > ST7032_BURST) ? ST7032_BURST : length;
+
+	memcpy(&burst[1], data, chunk);
+	i2c_write(st7032_address, burst, chunk + 1);
+
+	data += chunk;
+	length -= chunk;
+    }
+}
@@ -0,0 +1,88 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_st7032.h
+
+  @Summary
+    ST7032/ST7036 serial controller transport for the 16x2 LCD
+
+  @Description
+    Drives COG character modules with an ST7032 or ST7036 controller over I2C.
+    These controllers take HD44780 instructions natively, a control byte marks
+    whether the following bytes are instructions or data so a whole string is
+    sent behind a single control byte with no nibble protocol.
+
+    Every I2C byte (9 clocks) must take longer than the 26.3us instruction
+    time, so run the bus at 300kHz or slower, i2c_init() with 0 picks 250kHz.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_ST7032_H
+#define LCD_ST7032_H
+
+#define ST7032_ADDRESS 0x3E // fixed 7 bit I2C address of the ST7032
+
+// control bytes
+#define ST7032_CONTROL_CONTINUE 0x80 // Co, another control byte follows the next data byte
+#define ST7032_CONTROL_DATA 0x40 // RS, the following bytes go to the data register
+
+// flag for function set, selects the extended instruction table
+#define ST7032_INSTRUCTION_SET 0x01
+
+// extended instructions (instruction table 1)
+#define ST7032_BIASOSC 0x10
+#define ST7032_POWERICON 0x50
+#define ST7032_FOLLOWER 0x60
+#define ST7032_CONTRASTLOW 0x70
+
+// flags for bias/osc, BS set selects 1/4
+#define ST7032_BIAS_1_5 0x00
+#define ST7032_BIAS_1_4 0x08
+#define ST7032_OSC_DEFAULT 0x04
+
+// flags for power/icon/contrast
+#define ST7032_ICONON 0x08
+#define ST7032_BOOSTERON 0x04
+
+// flags for follower control
+#define ST7032_FOLLOWERON 0x08
+#define ST7032_FOLLOWER_GAIN 0x04 // Rab2..0, amplifier ratio
+
+// bytes sent after the control byte in one I2C transaction
+#define ST7032_BURST 64
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Initialize an ST7032/ST7036 module over I2C
+
+    @note i2c_init() must be called first, runs the LCD initialization through lcd_init_transport()
+	  and then sets up the internal oscillator, contrast, booster and voltage follower
+
+    @param[in] address 7 bit I2C address, ST7032_ADDRESS for the ST7032
+
+    @param[in] contrast Contrast setting (0-63)
+
+    @param[in] booster 1 to turn on the voltage booster (3.3V supply), 0 for 5V modules
+*/
+void lcd_st7032_init(uint8_t address, uint8_t contrast, uint8_t booster);
+
+/*
+    @brief Set the display contrast
+
+    @note switches to the extended instruction table and back
+
+    @param[in] contrast Contrast setting (0-63)
+*/
+void lcd_st7032_set_contrast(uint8_t contrast);
+
+/*
+    @brief Function for turning the voltage booster on or off
+
+    @param[in] booster 1 to turn on the booster, 0 to turn it off
+*/
+void lcd_st7032_set_booster(uint8_t booster);
+
+#endif
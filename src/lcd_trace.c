@@ -0,0 +1,171 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_trace.c
+
+  @Summary
+    Event tracer for the LCD driver
+
+  @Description
+    Implements the trace ring buffer and the Chrome trace event JSON export.
+    Has no hardware dependencies so it can be compiled into host tools as well
+    as firmware.
+******************************************************************************/
+
+#include "lcd_trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_PID 1
+#define TRACE_API_TID 1 // API spans and instants
+#define TRACE_BUS_TID 10 // bus of panel 0, panel n is TRACE_BUS_TID + n
+
+lcd_trace_t lcd_trace_buffer;
+
+static const char * const api_names[LCD_TRACE_APIS] = {
+    "lcd_init",
+    "lcd_clear",
+    "lcd_write_string",
+    "lcd_write_buffer",
+    "lcd_create_char",
+    "lcd_flush",
+    "lcd_flush_poll",
+    "lcd_present_at",
+};
+
+static const char * const counter_names[LCD_TRACE_COUNTERS] = {
+    "plan depth",
+};
+
+static void trace_export_event(const lcd_trace_event_t * ev, lcd_trace_write_fn write);
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Record an event
+
+    @note not interrupt safe, trace from one context only
+
+    @param[in] type LCD_TRACE_EV_...
+
+    @param[in] id API, counter or panel mask
+
+    @param[in] value Duration or counter value, saturates at 65535
+
+    @param[in] time_us Time of the event
+*/
+void lcd_trace_event(uint8_t type, uint8_t id, uint32_t value, uint32_t time_us) {
+    lcd_trace_event_t * ev;
+
+    if(lcd_trace_buffer.magic != LCD_TRACE_MAGIC)
+	lcd_trace_clear();
+
+    ev = &lcd_trace_buffer.events[lcd_trace_buffer.head];
+    ev->time_us = time_us;
+    ev->type = type;
+    ev->id = id;
+    ev->value = (value > UINT16_MAX) ? UINT16_MAX : value;
+
+    lcd_trace_buffer.head = (lcd_trace_buffer.head + 1) % LCD_TRACE_SIZE;
+    if(lcd_trace_buffer.count < LCD_TRACE_SIZE)
+	lcd_trace_buffer.count++;
+    else
+	lcd_trace_buffer.lost++;
+}
+
+/*
+    @brief Forget every event
+*/
+void lcd_trace_clear(void) {
+    memset(&lcd_trace_buffer, 0, sizeof(lcd_trace_buffer));
+    lcd_trace_buffer.magic = LCD_TRACE_MAGIC;
+}
+
+/*
+    @brief Export a trace as Chrome trace event JSON
+
+    @note the events are written oldest first, the trace is left as it is
+
+    @param[in] trace Trace to export, &lcd_trace_buffer or a dump read from a target
+
+    @param[in] write Callback receiving the text
+
+    @return 0 if the trace is not valid
+*/
+uint8_t lcd_trace_export(const lcd_trace_t * trace, lcd_trace_write_fn write) {
+    char text[96];
+    uint16_t start;
+    uint16_t i;
+    uint8_t panel;
+
+    if(trace->magic != LCD_TRACE_MAGIC || trace->count > LCD_TRACE_SIZE || trace->head >= LCD_TRACE_SIZE)
+	return 0;
+
+    write("{\"traceEvents\":[\n");
+
+    // name the tracks
+    snprintf(text, sizeof(text), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"lcd api\"}}",
+	     TRACE_PID, TRACE_API_TID);
+    write(text);
+    for(panel = 0; panel < 8; panel++) {
+	snprintf(text, sizeof(text), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"bus panel %u\"}}",
+		 TRACE_PID, TRACE_BUS_TID + panel, panel);
+	write(text);
+    }
+
+    start = (trace->head + LCD_TRACE_SIZE - trace->count) % LCD_TRACE_SIZE;
+    for(i = 0; i < trace->count; i++)
+	trace_export_event(&trace->events[(start + i) % LCD_TRACE_SIZE], write);
+
+    snprintf(text, sizeof(text), "\n],\"otherData\":{\"lost_events\":%" PRIu32 "}}\n", trace->lost);
+    write(text);
+    return 1;
+}
+
+/*
+    @brief Function for writing one event as JSON, a bus event becomes one slice per panel
+
+    @note every event follows the track names, so each one starts with a separator
+*/
+static void trace_export_event(const lcd_trace_event_t * ev, lcd_trace_write_fn write) {
+    char text[160];
+    const char * sep = ",\n";
+    uint8_t panel;
+
+    switch(ev->type) {
+    case LCD_TRACE_EV_BEGIN:
+    case LCD_TRACE_EV_END:
+	snprintf(text, sizeof(text), "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%" PRIu32 ",\"pid\":%d,\"tid\":%d}", sep,
+		 (ev->id < LCD_TRACE_APIS) ? api_names[ev->id] : "?", (ev->type == LCD_TRACE_EV_BEGIN) ? "B" : "E",
+		 ev->time_us, TRACE_PID, TRACE_API_TID);
+	write(text);
+	break;
+
+    case LCD_TRACE_EV_BUS:
+	for(panel = 0; panel < 8; panel++) {
+	    if(!(ev->id & (1 << panel)))
+		continue;
+	    snprintf(text, sizeof(text), "%s{\"name\":\"byte\",\"ph\":\"X\",\"ts\":%" PRIu32 ",\"dur\":%u,\"pid\":%d,\"tid\":%d}",
+		     sep, ev->time_us, ev->value, TRACE_PID, TRACE_BUS_TID + panel);
+	    write(text);
+	}
+	break;
+
+    case LCD_TRACE_EV_COUNT:
+	snprintf(text, sizeof(text), "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%" PRIu32 ",\"pid\":%d,\"args\":{\"value\":%u}}", sep,
+		 (ev->id < LCD_TRACE_COUNTERS) ? counter_names[ev->id] : "?", ev->time_us, TRACE_PID, ev->value);
+	write(text);
+	break;
+
+    case LCD_TRACE_EV_DROP:
+	snprintf(text, sizeof(text), "%s{\"name\":\"dropped frame\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%" PRIu32 ",\"pid\":%d,\"tid\":%d}",
+		 sep, ev->time_us, TRACE_PID, TRACE_API_TID);
+	write(text);
+	break;
+
+    default:
+	break;
+    }
+}
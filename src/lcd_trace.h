@@ -0,0 +1,133 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_trace.h
+
+  @Summary
+    Event tracer for the LCD driver
+
+  @Description
+    Records API spans, bus activity per panel, flush plan depth and dropped
+    frames in a fixed ring buffer and exports them as Chrome trace event JSON,
+    which chrome://tracing and the Perfetto UI open directly.
+
+    Build with -DLCD_TRACE to turn the hooks in the driver on, without it they
+    compile to nothing. The buffer can also be dumped from a running target
+    and converted on the host with tools/lcd_trace_json.c.
+******************************************************************************/
+
+#include <inttypes.h>
+
+#ifndef LCD_TRACE_H
+#define LCD_TRACE_H
+
+// events kept, the oldest are overwritten
+#ifndef LCD_TRACE_SIZE
+#define LCD_TRACE_SIZE 256
+#endif
+
+#define LCD_TRACE_MAGIC 0x4C435452 // "LCTR"
+
+// event types
+#define LCD_TRACE_EV_BEGIN 0 // an API call starts, id is the API
+#define LCD_TRACE_EV_END 1 // an API call returns
+#define LCD_TRACE_EV_BUS 2 // a byte kept the bus busy for value microseconds, id is the panel mask
+#define LCD_TRACE_EV_COUNT 3 // counter id changed to value
+#define LCD_TRACE_EV_DROP 4 // a partly sent frame was merged into the next one
+
+// traced APIs
+#define LCD_TRACE_INIT 0
+#define LCD_TRACE_CLEAR 1
+#define LCD_TRACE_WRITE_STRING 2
+#define LCD_TRACE_WRITE_BUFFER 3
+#define LCD_TRACE_CREATE_CHAR 4
+#define LCD_TRACE_FLUSH 5
+#define LCD_TRACE_FLUSH_POLL 6
+#define LCD_TRACE_PRESENT 7
+#define LCD_TRACE_APIS 8
+
+// counters
+#define LCD_TRACE_PLAN_DEPTH 0 // bytes of the flush plan still to send
+#define LCD_TRACE_COUNTERS 1
+
+/*
+    @brief Trace event, 8 bytes
+*/
+typedef struct {
+    uint32_t time_us; // time_us() when the event happened, the start of the byte for bus events
+    uint8_t type; // LCD_TRACE_EV_...
+    uint8_t id; // API, counter or panel mask
+    uint16_t value; // duration or counter value
+} lcd_trace_event_t;
+
+/*
+    @brief Ring buffer of events
+
+    @note dump the whole struct from a target to convert it on the host
+*/
+typedef struct {
+    uint32_t magic;
+    uint16_t head; // next event written
+    uint16_t count; // events held, at most LCD_TRACE_SIZE
+    uint32_t lost; // events overwritten before they were exported
+    lcd_trace_event_t events[LCD_TRACE_SIZE];
+} lcd_trace_t;
+
+/*
+    @brief Callback receiving the exported text a piece at a time
+*/
+typedef void (*lcd_trace_write_fn)(const char * text);
+
+extern lcd_trace_t lcd_trace_buffer;
+
+#ifdef LCD_TRACE
+#define LCD_TRACE_BEGIN(api) lcd_trace_event(LCD_TRACE_EV_BEGIN, (api), 0, time_us())
+#define LCD_TRACE_END(api) lcd_trace_event(LCD_TRACE_EV_END, (api), 0, time_us())
+#define LCD_TRACE_BUS(panels, start) lcd_trace_event(LCD_TRACE_EV_BUS, (panels), time_us() - (start), (start))
+#define LCD_TRACE_COUNT(counter, value) lcd_trace_event(LCD_TRACE_EV_COUNT, (counter), (value), time_us())
+#define LCD_TRACE_DROP() lcd_trace_event(LCD_TRACE_EV_DROP, 0, 0, time_us())
+#else
+#define LCD_TRACE_BEGIN(api) do {} while(0)
+#define LCD_TRACE_END(api) do {} while(0)
+#define LCD_TRACE_BUS(panels, start) do {} while(0)
+#define LCD_TRACE_COUNT(counter, value) do {} while(0)
+#define LCD_TRACE_DROP() do {} while(0)
+#endif
+
+/*******************************[ High-Level Sensor Functions For General Use ]****************************************/
+
+/*
+    @brief Record an event
+
+    @note not interrupt safe, trace from one context only
+
+    @param[in] type LCD_TRACE_EV_...
+
+    @param[in] id API, counter or panel mask
+
+    @param[in] value Duration or counter value, saturates at 65535
+
+    @param[in] time_us Time of the event
+*/
+void lcd_trace_event(uint8_t type, uint8_t id, uint32_t value, uint32_t time_us);
+
+/*
+    @brief Forget every event
+*/
+void lcd_trace_clear(void);
+
+/*
+    @brief Export a trace as Chrome trace event JSON
+
+    @note the events are written oldest first, the trace is left as it is
+
+    @param[in] trace Trace to export, &lcd_trace_buffer or a dump read from a target
+
+    @param[in] write Callback receiving the text
+
+    @return 0 if the trace is not valid
+*/
+uint8_t lcd_trace_export(const lcd_trace_t * trace, lcd_trace_write_fn write);
+
+#endif
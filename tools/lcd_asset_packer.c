@@ -0,0 +1,204 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_asset_packer.c
+
+  @Summary
+    Host-side asset packer
+
+  @Description
+    Reads a screen description and writes packed assets as C arrays.
+
+    Build on the host with:
+      cc -I../src -o lcd_asset_packer lcd_asset_packer.c ../src/lcd_asset_pack.c
+
+    Usage:
+      lcd_asset_packer screens.txt > screens.c
+
+    Input format, one statement per line, '#' starts a comment:
+      screen <name>                 start a new asset called <name>
+      clear                         clear the display
+      glyph <slot> <r0> ... <r7>    load a CGRAM character, slot 0 to 7, rows 0 to 0x1F
+      text <col> <row> <text>       write text, everything after the row is printed
+      end                           finish the asset
+
+    In text, \xHH stands for the ROM code HH, e.g. \x01 for the character
+    loaded with glyph 1, and \\ for a backslash.
+
+    The packed and plain sizes of every asset are printed to stderr.
+******************************************************************************/
+
+#include "lcd_asset.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ASSET 4096 // largest packed asset
+#define MAX_LINE 256
+
+static uint8_t asset[MAX_ASSET];
+static uint16_t asset_len = 0;
+static uint32_t plain_len = 0; // size of the same screen stored as strings
+static char asset_name[MAX_LINE];
+
+/*
+    @brief Function for appending bytes returned by a packer call
+
+    @note exits if the asset outgrew the buffer
+*/
+static void append(uint16_t written, uint16_t wanted) {
+    if(written == 0 && wanted != 0) {
+	fprintf(stderr, "%s: asset too large\n", asset_name);
+	exit(1);
+    }
+    asset_len += written;
+}
+
+/*
+    @brief Function for turning the text of a statement into ROM codes
+
+    @return number of ROM codes, -1 if an escape is malformed or the text doesn't fit
+*/
+static int parse_text(const char * text, uint8_t * codes, uint16_t size) {
+    uint16_t length = 0;
+    unsigned int code;
+
+    while(*text != '\0') {
+	if(length == size)
+	    return -1;
+
+	if(text[0] != '\\') {
+	    codes[length++] = (uint8_t)*text++;
+	}
+	else if(text[1] == '\\') {
+	    codes[length++] = '\\';
+	    text += 2;
+	}
+	else if(text[1] == 'x' && isxdigit((unsigned char)text[2]) && isxdigit((unsigned char)text[3])) {
+	    sscanf(text + 2, "%2x", &code);
+	    codes[length++] = (uint8_t)code;
+	    text += 4;
+	}
+	else {
+	    return -1;
+	}
+    }
+
+    return length;
+}
+
+/*
+    @brief Function for writing the finished asset as a C array
+*/
+static void emit_asset(void) {
+    uint16_t i;
+
+    append(lcd_asset_pack_token(LCD_ASSET_END, &asset[asset_len], MAX_ASSET - asset_len), 1);
+
+    printf("const uint8_t %s[%u] = {", asset_name, asset_len);
+    for(i = 0; i < asset_len; i++)
+	printf("%s%s0x%02X", i ? "," : "", (i % 12) ? " " : "\n    ", asset[i]);
+    printf("\n};\n\n");
+
+    fprintf(stderr, "%-24s plain %5u bytes, packed %5u bytes, ratio %.2f\n",
+	    asset_name, plain_len, asset_len, asset_len ? (double)plain_len / asset_len : 0.0);
+}
+
+int main(int argc, char * argv[]) {
+    FILE * in;
+    char line[MAX_LINE];
+    uint8_t open = 0;
+
+    if(argc != 2) {
+	fprintf(stderr, "usage: %s <screens.txt>\n", argv[0]);
+	return 1;
+    }
+
+    in = fopen(argv[1], "r");
+    if(in == NULL) {
+	perror(argv[1]);
+	return 1;
+    }
+
+    printf("/* generated by lcd_asset_packer from %s, do not edit */\n\n#include <inttypes.h>\n\n", argv[1]);
+
+    while(fgets(line, sizeof(line), in) != NULL) {
+	char * cmd;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	cmd = line + strspn(line, " \t");
+	if(*cmd == '\0' || *cmd == '#')
+	    continue;
+
+	if(strncmp(cmd, "screen ", 7) == 0) {
+	    if(open)
+		emit_asset();
+	    sscanf(cmd + 7, "%255s", asset_name);
+	    asset_len = 0;
+	    plain_len = 0;
+	    open = 1;
+	}
+	else if(!open) {
+	    fprintf(stderr, "statement outside of a screen: %s\n", cmd);
+	    return 1;
+	}
+	else if(strcmp(cmd, "clear") == 0) {
+	    append(lcd_asset_pack_token(LCD_ASSET_CLEAR, &asset[asset_len], MAX_ASSET - asset_len), 1);
+	    plain_len += 1;
+	}
+	else if(strncmp(cmd, "glyph ", 6) == 0) {
+	    int slot, r[8];
+	    uint8_t rows[8];
+	    int i;
+
+	    // %i takes rows in hex, octal or decimal and needs an int, range checked here
+	    if(sscanf(cmd + 6, "%i %i %i %i %i %i %i %i %i", &slot, &r[0], &r[1], &r[2], &r[3], &r[4], &r[5], &r[6], &r[7]) != 9
+	       || slot < 0 || slot > 7) {
+		fprintf(stderr, "bad glyph: %s\n", cmd);
+		return 1;
+	    }
+	    for(i = 0; i < 8; i++) {
+		if(r[i] < 0 || r[i] > 0x1F) {
+		    fprintf(stderr, "bad glyph row, 5 pixels are 0 to 0x1F: %s\n", cmd);
+		    return 1;
+		}
+		rows[i] = r[i];
+	    }
+	    append(lcd_asset_pack_glyph(slot, rows, &asset[asset_len], MAX_ASSET - asset_len), 1);
+	    plain_len += 9;
+	}
+	else if(strncmp(cmd, "text ", 5) == 0) {
+	    unsigned int col, row;
+	    int skip = 0;
+	    uint8_t text[MAX_LINE];
+	    int len;
+
+	    if(sscanf(cmd + 5, "%u %u %n", &col, &row, &skip) != 2 || skip == 0
+	       || (len = parse_text(cmd + 5 + skip, text, sizeof(text))) < 0) {
+		fprintf(stderr, "bad text: %s\n", cmd);
+		return 1;
+	    }
+
+	    append(lcd_asset_pack_cursor(col, row, &asset[asset_len], MAX_ASSET - asset_len), 1);
+	    append(lcd_asset_pack_text(text, len, &asset[asset_len], MAX_ASSET - asset_len), len);
+	    plain_len += 2 + len + 1; // col, row and a null terminated string
+	}
+	else if(strcmp(cmd, "end") == 0) {
+	    emit_asset();
+	    open = 0;
+	}
+	else {
+	    fprintf(stderr, "unknown statement: %s\n", cmd);
+	    return 1;
+	}
+    }
+
+    if(open)
+	emit_asset();
+
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_trace_json.c
+
+  @Summary
+    Host-side trace converter
+
+  @Description
+    Reads a dump of lcd_trace_buffer taken from a target and writes it as
+    Chrome trace event JSON, open the output in chrome://tracing or the
+    Perfetto UI. The dump is the raw bytes of the lcd_trace_t, e.g. from
+    "dump binary memory trace.bin &lcd_trace_buffer (&lcd_trace_buffer + 1)"
+    in gdb. Build with the same LCD_TRACE_SIZE as the firmware.
+
+    Build on the host with:
+      cc -I../src -o lcd_trace_json lcd_trace_json.c ../src/lcd_trace.c
+
+    Usage:
+      lcd_trace_json trace.bin > trace.json
+******************************************************************************/
+
+#include "lcd_trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+static lcd_trace_t dump;
+
+static void write_stdout(const char * text) {
+    fputs(text, stdout);
+}
+
+int main(int argc, char * argv[]) {
+    FILE * in;
+
+    if(argc != 2) {
+	fprintf(stderr, "usage: %s <trace.bin>\n", argv[0]);
+	return 1;
+    }
+
+    in = fopen(argv[1], "rb");
+    if(in == NULL) {
+	perror(argv[1]);
+	return 1;
+    }
+
+    if(fread(&dump, sizeof(dump), 1, in) != 1) {
+	fprintf(stderr, "%s: short dump, expected %u bytes\n", argv[1], (unsigned)sizeof(dump));
+	fclose(in);
+	return 1;
+    }
+    fclose(in);
+
+    if(!lcd_trace_export(&dump, write_stdout)) {
+	fprintf(stderr, "%s: not a trace, or built with a different LCD_TRACE_SIZE\n", argv[1]);
+	return 1;
+    }
+
+    fprintf(stderr, "%u events, %" PRIu32 " lost\n", dump.count, dump.lost);
+    return 0;
+}
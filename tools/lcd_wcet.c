@@ -0,0 +1,90 @@
+/* ****************************************************************************/
+/** 16x2 Liquid Crystal Display Driver
+
+  @File Name
+    lcd_wcet.c
+
+  @Summary
+    Worst case cost table of the public API
+
+  @Description
+    Prints the worst case bytes, bus time and CPU wait of every public API as
+    a markdown table, for the 4 bit gpio bus or for a transport with the
+    given byte time. Build with the same timing profile (-DLCD_EXEC_US=...)
+    as the firmware.
+
+    Build on the host with:
+      cc -I../src -o lcd_wcet lcd_wcet.c ../src/lcd_cost.c
+
+    Usage:
+      lcd_wcet [transport byte_us [cpu byte_us]]
+******************************************************************************/
+
+#include "lcd_cost.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char * name;
+    uint8_t api;
+    uint16_t length;
+} wcet_row_t;
+
+static const wcet_row_t rows[] = {
+    {"lcd_init", LCD_COST_INIT, 0},
+    {"lcd_warm_init", LCD_COST_WARM_INIT, 0},
+    {"lcd_clear", LCD_COST_CLEAR, 0},
+    {"lcd_home", LCD_COST_HOME, 0},
+    {"lcd_set_cursor and other commands", LCD_COST_COMMAND, 0},
+    {"lcd_write_char", LCD_COST_WRITE_CHAR, 0},
+    {"lcd_write_string, 16 characters", LCD_COST_WRITE_STRING, 16},
+    {"lcd_write_buffer, 16 bytes", LCD_COST_WRITE_BUFFER, 16},
+    {"lcd_write_int", LCD_COST_WRITE_INT, 0},
+    {"lcd_write_int_right, 6 cells", LCD_COST_WRITE_INT_RIGHT, 6},
+    {"lcd_create_char", LCD_COST_CREATE_CHAR, 0},
+    {"lcd_flush, whole screen", LCD_COST_FLUSH, 0},
+    {"lcd_flush_poll, whole screen", LCD_COST_FLUSH_POLL, 0},
+    {"lcd_present_at, whole screen", LCD_COST_PRESENT_AT, 0},
+    {"lcd_write_float", LCD_COST_WRITE_FLOAT, 0},
+    {"lcd_set_attr, 16 blinking cells", LCD_COST_SET_ATTR, 16},
+    {"lcd_attr_tick, 16 blinking cells", LCD_COST_ATTR_TICK, 16},
+    {"lcd_flip_page", LCD_COST_FLIP_PAGE, 0},
+    {"lcd_select_panels", LCD_COST_SELECT_PANELS, 0},
+};
+
+int main(int argc, char * argv[]) {
+    lcd_cost_config_t config;
+    lcd_transport_t transport = {NULL, NULL, 0, NULL};
+    lcd_cost_t cost;
+    size_t i;
+
+    if(argc > 1) {
+	transport.byte_us = (uint16_t)strtoul(argv[1], NULL, 0);
+	if(transport.byte_us == 0) {
+	    fprintf(stderr, "usage: %s [transport byte_us [cpu byte_us]]\n", argv[0]);
+	    return 1;
+	}
+	lcd_cost_config_transport(&config, &transport);
+	if(argc > 2)
+	    config.cpu_byte_us = strtoul(argv[2], NULL, 0);
+	printf("transport, %" PRIu32 " us per byte, CPU waits %" PRIu32 " us per byte\n\n", config.byte_us,
+	       config.cpu_byte_us);
+    }
+    else {
+	lcd_cost_config_gpio(&config);
+	printf("4 bit gpio bus, %" PRIu32 " us per byte\n\n", config.byte_us);
+    }
+
+    printf("| API | bytes | bus us | CPU us |\n");
+    printf("|---|---|---|---|\n");
+    for(i = 0; i < sizeof(rows) / sizeof(*rows); i++) {
+	cost.bytes = 0;
+	cost.bus_us = 0;
+	cost.cpu_us = 0;
+	lcd_cost_api(&config, rows[i].api, rows[i].length, &cost);
+	printf("| %s | %" PRIu32 " | %" PRIu32 " | %" PRIu32 " |\n", rows[i].name, cost.bytes, cost.bus_us, cost.cpu_us);
+    }
+
+    return 0;
+}